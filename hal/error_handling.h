@@ -30,6 +30,8 @@ extern "C" {
 #endif /* __cplusplus */
 
 typedef enum {
+    UHAL_STATUS_I2C_DEVICE_NOT_PRESENT = -9,
+    UHAL_STATUS_I2C_TIMEOUT = -8,
     UHAL_STATUS_I2C_ARBSTATE_LOST = -7,
     UHAL_STATUS_I2C_LENERR = -6,
     UHAL_STATUS_I2C_BUSERR = -5,
@@ -0,0 +1,471 @@
+/**
+* \file            hal_coroutine.hpp
+* \brief           C++20 coroutine support for the SERCOM based host drivers
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef HAL_COROUTINE_HPP
+#define HAL_COROUTINE_HPP
+
+#if !defined(__cplusplus) || __cplusplus < 202002L
+#error "hal_coroutine.hpp requires C++20 or newer"
+#endif
+
+#include <coroutine>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "hal_dma.h"
+#include "hal_sercom.hpp"
+
+/**
+ * @brief The amount of coroutines which can be waiting to be resumed by an executor, has to be a power of two.
+ *        Every peripheral with an outstanding transfer and every yielding coroutine takes one entry.
+ */
+#ifndef UHAL_EXECUTOR_QUEUE_SIZE
+#define UHAL_EXECUTOR_QUEUE_SIZE 16
+#endif
+
+namespace uhal {
+
+static_assert((UHAL_EXECUTOR_QUEUE_SIZE & (UHAL_EXECUTOR_QUEUE_SIZE - 1)) == 0 && UHAL_EXECUTOR_QUEUE_SIZE <= 128,
+              "UHAL_EXECUTOR_QUEUE_SIZE has to be a power of two (up to 128)!");
+
+/**
+ * @brief Masks the interrupts for the lifetime of the object, restoring the previous mask so it can be nested.
+ */
+class CriticalSection {
+public:
+    CriticalSection() : primask(__get_PRIMASK()) {
+        __disable_irq();
+    }
+
+    ~CriticalSection() {
+        __set_PRIMASK(primask);
+    }
+
+    CriticalSection(const CriticalSection &) = delete;
+    CriticalSection &operator=(const CriticalSection &) = delete;
+
+private:
+    uint32_t primask;
+};
+
+/**
+ * @brief Return type of a coroutine which is run by an Executor. The coroutine starts when it is spawned
+ *        and its frame is freed when it returns.
+ */
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {
+        }
+
+        void unhandled_exception() {
+            for (;;) {
+            }
+        }
+    };
+
+    explicit Task(const std::coroutine_handle<> handle) : handle(handle) {
+    }
+
+    std::coroutine_handle<> handle;
+};
+
+/**
+ * @brief Single-threaded executor, resumes the coroutines which are ready to continue from the main loop.
+ *        post() can be called from interrupt handlers, poll() may only be called from one context.
+ */
+class Executor {
+public:
+    /**
+     * @brief Queues a coroutine to be resumed by the next poll().
+     * @return false when the queue is full
+     */
+    bool post(const std::coroutine_handle<> handle) {
+        CriticalSection critical_section;
+        if (free_entries() == 0) {
+            return false;
+        }
+        push(handle);
+        return true;
+    }
+
+    /**
+     * @brief Reserves a queue entry for a coroutine which is posted later with post_reserved(),
+     *        so a completion interrupt never finds the queue full.
+     * @return false when the queue is full
+     */
+    bool reserve() {
+        CriticalSection critical_section;
+        if (free_entries() == 0) {
+            return false;
+        }
+        reserved = reserved + 1;
+        return true;
+    }
+
+    /**
+     * @brief Gives back an entry taken by reserve() which isn't going to be used.
+     */
+    void release() {
+        CriticalSection critical_section;
+        reserved = reserved - 1;
+    }
+
+    /**
+     * @brief Queues a coroutine in an entry taken by reserve(), this can't fail.
+     */
+    void post_reserved(const std::coroutine_handle<> handle) {
+        CriticalSection critical_section;
+        reserved = reserved - 1;
+        push(handle);
+    }
+
+    /**
+     * @brief Starts a coroutine, it runs until its first co_await from the next poll().
+     */
+    uhal_status_t spawn(const Task task) {
+        if (!post(task.handle)) {
+            task.handle.destroy();
+            return UHAL_STATUS_ERROR;
+        }
+        return UHAL_STATUS_OK;
+    }
+
+    /**
+     * @brief Resumes every coroutine which was ready when poll() was called.
+     * @return The amount of resumed coroutines
+     */
+    size_t poll() {
+        const uint8_t end = tail;
+        size_t resumed = 0;
+        while (head != end) {
+            const std::coroutine_handle<> handle = ready[head];
+            __DMB();
+            head = (head + 1) & (UHAL_EXECUTOR_QUEUE_SIZE - 1);
+            handle.resume();
+            resumed++;
+        }
+        return resumed;
+    }
+
+    /**
+     * @brief Awaitable which lets the other ready coroutines run first, co_await executor.yield().
+     */
+    auto yield() {
+        struct YieldAwaitable {
+            Executor &executor;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            bool await_suspend(const std::coroutine_handle<> handle) {
+                return executor.post(handle);
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+        return YieldAwaitable{*this};
+    }
+
+private:
+    /**
+     * @brief The amount of entries which are neither queued nor reserved, one entry of the ring always stays empty.
+     */
+    uint8_t free_entries() const {
+        const uint8_t queued = (tail - head) & (UHAL_EXECUTOR_QUEUE_SIZE - 1);
+        return (UHAL_EXECUTOR_QUEUE_SIZE - 1) - queued - reserved;
+    }
+
+    void push(const std::coroutine_handle<> handle) {
+        ready[tail] = handle;
+        __DMB();
+        tail = (tail + 1) & (UHAL_EXECUTOR_QUEUE_SIZE - 1);
+    }
+
+    std::coroutine_handle<> ready[UHAL_EXECUTOR_QUEUE_SIZE];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+    volatile uint8_t reserved = 0;
+};
+
+/**
+ * @brief The coroutine waiting on a peripheral, handed to its executor by the completion interrupt.
+ */
+struct CompletionSlot {
+    std::coroutine_handle<> waiter;
+    Executor *executor;
+    uhal_status_t *result;
+
+    /**
+     * @brief Called from the completion interrupt, stores the status in the awaitable and queues the waiting coroutine
+     *        in the entry the awaitable reserved when it suspended.
+     */
+    void complete(const uhal_status_t status) {
+        if (!waiter) {
+            return;
+        }
+        *result = status;
+        const std::coroutine_handle<> handle = waiter;
+        waiter = nullptr;
+        executor->post_reserved(handle);
+    }
+};
+
+/**
+ * @brief Awaitable of a bus transfer. The transfer is started when the coroutine suspends,
+ *        co_await gives the status of the transfer, or UHAL_STATUS_ERROR when the executor queue is full.
+ * @tparam StartFunc Callable which starts the transfer and returns its uhal_status_t
+ */
+template<typename StartFunc>
+class BusTransfer {
+public:
+    BusTransfer(CompletionSlot &slot, Executor &executor, StartFunc start)
+            : slot(slot), executor(executor), start(start) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend(const std::coroutine_handle<> handle) {
+        {
+            CriticalSection critical_section;
+            if (slot.waiter) {
+                status = UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+                return false;
+            }
+            if (!executor.reserve()) {
+                status = UHAL_STATUS_ERROR;
+                return false;
+            }
+            slot.executor = &executor;
+            slot.result = &status;
+            slot.waiter = handle;
+        }
+        const uhal_status_t start_status = start();
+        if (start_status == UHAL_STATUS_OK) {
+            return true;
+        }
+        /* A transfer which ran in the calling context (polling mode) completed the slot already */
+        CriticalSection critical_section;
+        if (!slot.waiter) {
+            return true;
+        }
+        slot.waiter = nullptr;
+        executor.release();
+        status = start_status;
+        return false;
+    }
+
+    uhal_status_t await_resume() const noexcept {
+        return status;
+    }
+
+private:
+    CompletionSlot &slot;
+    Executor &executor;
+    StartFunc start;
+    uhal_status_t status = UHAL_STATUS_OK;
+};
+
+#ifndef DISABLE_I2C_HOST_MODULE
+
+/**
+ * @brief I2C host with awaitable transfers, resumed from the SERCOM interrupt through i2c_host_set_transaction_done_callback.
+ *        Only one transfer can be outstanding per peripheral, a second co_await gives UHAL_STATUS_PERIPHERAL_IN_USE_WARNING.
+ * @tparam I2cNum The I2C peripheral to use
+ */
+template<i2c_periph_inst_t I2cNum>
+class AsyncI2cHost : public I2cHost<I2cNum> {
+public:
+    explicit AsyncI2cHost(Executor &executor) : executor(executor) {
+        i2c_host_set_transaction_done_callback(I2cNum, on_transaction_done);
+    }
+
+    auto write(const uint16_t addr, const uint8_t *write_buff, const size_t size, const i2c_stop_bit_t stop_bit = I2C_STOP_BIT) {
+        return make_transfer([=] {
+            return i2c_host_write_non_blocking(I2cNum, addr, write_buff, size, stop_bit);
+        });
+    }
+
+    auto read(const uint16_t addr, uint8_t *read_buff, const size_t size) {
+        return make_transfer([=] {
+            return i2c_host_read_non_blocking(I2cNum, addr, read_buff, size);
+        });
+    }
+
+    auto write_read(const uint16_t addr, const uint8_t *write_buff, const size_t write_size, uint8_t *read_buff, const size_t read_size) {
+        return make_transfer([=] {
+            return i2c_host_write_read_non_blocking(I2cNum, addr, write_buff, write_size, read_buff, read_size);
+        });
+    }
+
+    /**
+     * @brief Register read shorthand: writes the register address and reads the register contents back.
+     */
+    template<size_t ReadSize>
+    auto write_read(const uint16_t addr, const uint8_t &reg, uint8_t (&read_buff)[ReadSize]) {
+        return write_read(addr, &reg, 1, read_buff, ReadSize);
+    }
+
+private:
+    static inline CompletionSlot slot{};
+
+    static void on_transaction_done(const i2c_periph_inst_t i2c_peripheral_num, const uhal_status_t status) {
+        slot.complete(status);
+    }
+
+    template<typename StartFunc>
+    BusTransfer<StartFunc> make_transfer(StartFunc start) {
+        return BusTransfer<StartFunc>(slot, executor, start);
+    }
+
+    Executor &executor;
+};
+
+#endif /* DISABLE_I2C_HOST_MODULE */
+
+#if !defined(DISABLE_SPI_HOST_MODULE) && !defined(DISABLE_DMA_MODULE)
+
+/**
+ * @brief SPI host with awaitable transfers moved by two DMA channels, resumed from the DMA interrupt.
+ *        The DMA controller has to be initialized with dma_init first. The chip select is still driven with
+ *        start_transaction/end_transaction, the synchronous functions of SpiHost can be used in between.
+ * @tparam SpiNum The SPI peripheral to use
+ * @tparam RxChannel The DMA channel which moves the received bytes to memory
+ * @tparam TxChannel The DMA channel which feeds the bytes to send to the SERCOM
+ * @tparam BusOpt The bus options given to init, only 8-bit characters are supported
+ */
+template<spi_host_inst_t SpiNum, dma_channel_t RxChannel, dma_channel_t TxChannel, spi_bus_opt_t BusOpt = SPI_BUS_OPT_USE_DEFAULT>
+class AsyncSpiHost : public SpiHost<SpiNum, static_cast<spi_bus_opt_t>(BusOpt | SPI_BUS_OPT_DATA32_DISABLE)> {
+    static_assert(!(BusOpt & SPI_BUS_OPT_CHAR_SIZE_10_BIT), "AsyncSpiHost: the DMA transfers only support 8-bit characters!");
+    static_assert(RxChannel != TxChannel, "AsyncSpiHost: the RX and TX transfers need their own DMA channel!");
+
+public:
+    using traits = SercomTraits<SpiNum>;
+
+    /**
+     * @brief The largest transfer, the block transfer count of a DMA descriptor is 16 bits.
+     */
+    static constexpr size_t max_transfer_size = 0xFFFF;
+
+    explicit AsyncSpiHost(Executor &executor) : executor(executor) {
+    }
+
+    auto write(const unsigned char *write_buff, const size_t size) {
+        return make_transfer([=] {
+            return start_transfer(write_buff, nullptr, size);
+        });
+    }
+
+    /**
+     * @brief Reads size bytes, zeros are sent while reading.
+     */
+    auto read(unsigned char *read_buff, const size_t size) {
+        return make_transfer([=] {
+            return start_transfer(nullptr, read_buff, size);
+        });
+    }
+
+    /**
+     * @brief Full-duplex transfer, write_buff and read_buff may be the same buffer.
+     */
+    auto transfer(const unsigned char *write_buff, unsigned char *read_buff, const size_t size) {
+        return make_transfer([=] {
+            return start_transfer(write_buff, read_buff, size);
+        });
+    }
+
+private:
+    static inline CompletionSlot slot{};
+
+    static void rx_done(const dma_channel_t dma_channel, const uhal_status_t status) {
+        slot.complete(status);
+    }
+
+    /**
+     * @brief A write without read ends when the TX channel is done and the SERCOM shifted out the last byte,
+     *        the bytes received in the meantime are dropped.
+     */
+    static void tx_done(const dma_channel_t dma_channel, const uhal_status_t status) {
+        Sercom *const sercom = traits::hw();
+        while (!(sercom->SPI.INTFLAG.reg & SERCOM_SPI_INTFLAG_TXC));
+        while (sercom->SPI.INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC) {
+            (void) sercom->SPI.DATA.reg;
+        }
+        sercom->SPI.STATUS.reg = SERCOM_SPI_STATUS_BUFOVF;
+        sercom->SPI.INTFLAG.reg = SERCOM_SPI_INTFLAG_ERROR;
+        slot.complete(status);
+    }
+
+    static uhal_status_t start_transfer(const unsigned char *write_buff, unsigned char *read_buff, const size_t size) {
+        if (size == 0 || size > max_transfer_size) {
+            return UHAL_STATUS_INVALID_PARAMETERS;
+        }
+        const dma_peripheral_location_t location = static_cast<dma_peripheral_location_t>(SpiNum);
+        if (write_buff == nullptr) {
+            /* The receive buffer doubles as the source of the zeros, every byte is sent before it is overwritten */
+            memset(read_buff, 0, size);
+            write_buff = read_buff;
+        }
+        if (read_buff != nullptr) {
+            dma_set_transfer_done_callback(DMA_PERIPHERAL_0, TxChannel, nullptr);
+            dma_set_transfer_done_callback(DMA_PERIPHERAL_0, RxChannel, rx_done);
+            /* The RX channel has to be armed before the TX channel starts the SERCOM */
+            dma_set_transfer_peripheral_to_mem(DMA_PERIPHERAL_0, RxChannel, location, read_buff, size, DMA_OPT_IRQ_TRANSFER_COMPLETE);
+        } else {
+            dma_set_transfer_done_callback(DMA_PERIPHERAL_0, RxChannel, nullptr);
+            dma_set_transfer_done_callback(DMA_PERIPHERAL_0, TxChannel, tx_done);
+        }
+        dma_set_transfer_mem_to_peripheral(DMA_PERIPHERAL_0, TxChannel, write_buff, location, size, DMA_OPT_IRQ_TRANSFER_COMPLETE);
+        return UHAL_STATUS_OK;
+    }
+
+    template<typename StartFunc>
+    BusTransfer<StartFunc> make_transfer(StartFunc start) {
+        return BusTransfer<StartFunc>(slot, executor, start);
+    }
+
+    Executor &executor;
+};
+
+#endif /* DISABLE_SPI_HOST_MODULE && DISABLE_DMA_MODULE */
+
+}
+
+#endif //HAL_COROUTINE_HPP
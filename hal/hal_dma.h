@@ -143,6 +143,45 @@ uhal_status_t dma_reset_trigger(const dma_peripheral_t dma_peripheral, const dma
         dma_reset_trigger(dma_peripheral, dma_channel, trigger);                                                                                     \
     } while (0);
 
+/**
+ * @brief Function to set a callback which gets called (from the DMA ISR) when a transfer on given channel completes or fails
+ * @param dma_peripheral The DMA peripheral instance to use (some devices have multiple DMA peripherals)
+ * @param dma_channel The DMA peripheral channel to use
+ * @param transfer_done_cb The callback to call, NULL removes the callback
+ * @return UHAL_STATUS_OK when no errors have occurred
+ * @note The callback is only called when the default dma_irq_handler is used
+ */
+uhal_status_t dma_set_transfer_done_callback(const dma_peripheral_t dma_peripheral, const dma_channel_t dma_channel,
+                                             const dma_transfer_done_cb_t transfer_done_cb);
+
+#define DMA_SET_TRANSFER_DONE_CALLBACK(dma_peripheral, dma_channel, transfer_done_cb)                                                                \
+    do {                                                                                                                                             \
+        DMA_CHANNEL_FUNC_PARAMETER_CHECK(dma_peripheral, dma_channel);                                                                               \
+        dma_set_transfer_done_callback(dma_peripheral, dma_channel, transfer_done_cb);                                                               \
+    } while (0);
+
+/**
+ * @brief Function to abort (disable) the transfer on given channel
+ * @param dma_peripheral The DMA peripheral instance to use (some devices have multiple DMA peripherals)
+ * @param dma_channel The DMA peripheral channel to stop
+ * @return UHAL_STATUS_OK when no errors have occurred
+ */
+uhal_status_t dma_abort_transfer(const dma_peripheral_t dma_peripheral, const dma_channel_t dma_channel);
+
+#define DMA_ABORT_TRANSFER(dma_peripheral, dma_channel)                                                                                              \
+    do {                                                                                                                                             \
+        DMA_CHANNEL_FUNC_PARAMETER_CHECK(dma_peripheral, dma_channel);                                                                               \
+        dma_abort_transfer(dma_peripheral, dma_channel);                                                                                             \
+    } while (0);
+
+/**
+ * @brief Function to get the amount of elements which were not transferred by the last transfer on given channel
+ * @param dma_peripheral The DMA peripheral instance to use (some devices have multiple DMA peripherals)
+ * @param dma_channel The DMA peripheral channel to read
+ * @return The amount of elements left. Only valid after the transfer has been completed or aborted.
+ */
+size_t dma_get_remaining_transfer_count(const dma_peripheral_t dma_peripheral, const dma_channel_t dma_channel);
+
 /**
  * @brief Function to de-initialize a given DMA peripheral
  * @param dma_peripheral The DMA peripheral to de-initialize
@@ -40,6 +40,35 @@ typedef enum {
     I2C_STOP_BIT
 } i2c_stop_bit_t;
 
+/**
+ * @brief Flags of the errors which occurred during a transaction, see i2c_transaction_info_t.error_mask
+ */
+typedef enum {
+    I2C_ERROR_FLAG_ADDR_NACK = 0x01,
+    I2C_ERROR_FLAG_DATA_NACK = 0x02,
+    I2C_ERROR_FLAG_BUSERR = 0x04,
+    I2C_ERROR_FLAG_ARBLOST = 0x08,
+    I2C_ERROR_FLAG_LENERR = 0x10,
+    I2C_ERROR_FLAG_TIMEOUT = 0x20
+} i2c_error_flag_t;
+
+/**
+ * @brief Information about the last transaction on an i2c peripheral.
+ *        status: The result of the transaction, which is the first error of the last attempt when errors occurred
+ *        first_error/last_error: The first and last error which occurred during the transaction
+ *        error_mask: All errors which occurred during the transaction (i2c_error_flag_t flags OR-ed together)
+ *        nack_offset: The offset of the data byte which was NACKed by the client (only valid with I2C_ERROR_FLAG_DATA_NACK)
+ *        retry_cnt: The amount of times the transaction has been retried
+ */
+typedef struct {
+    uhal_status_t status;
+    uhal_status_t first_error;
+    uhal_status_t last_error;
+    uint8_t error_mask;
+    size_t nack_offset;
+    uint8_t retry_cnt;
+} i2c_transaction_info_t;
+
 /**
  * @brief Function to initialize the specified HW peripheral with I2C host functionality.
  *        To ensure platform compatibility use the default option as much as possible for each hw peripheral.
@@ -138,6 +167,57 @@ I2C_HOST_READ_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, read_buff, size); \
 i2c_host_read_blocking(i2c_peripheral_num, addr, read_buff, size);             \
 }while(0);
 
+/**
+ * @brief Function to write bytes to a client device and read its answer back in one transaction, joined by a repeated start.
+ *        Typically used to read a register: the register address is written and the register contents are read back.
+ *        This function does only work in host-mode.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @param addr The I2C address of the client device
+ * @param write_buff Pointer to the bytes to write before the repeated start
+ * @param write_size The amount of bytes to write
+ * @param read_buff Pointer to the read buffer where all read bytes will be written
+ * @param read_size The amount of bytes which have to be read
+ * @return The status of the transaction, see i2c_host_get_transaction_info for the details
+ */
+uhal_status_t i2c_host_write_read_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                           const uint16_t addr,
+                                           const uint8_t *write_buff,
+                                           const size_t write_size,
+                                           uint8_t *read_buff,
+                                           const size_t read_size);
+
+#define I2C_HOST_WRITE_READ_BLOCKING(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size) \
+do {                                                                                                       \
+I2C_HOST_WRITE_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, write_buff, write_size, I2C_NO_STOP_BIT);   \
+I2C_HOST_READ_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, read_buff, read_size);                       \
+i2c_host_write_read_blocking(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size);     \
+}while(0);
+
+/**
+ * @brief Non-blocking version of i2c_host_write_read_blocking, the read is started by the driver as soon as the write finished.
+ *        Use i2c_host_set_transaction_done_callback to get notified when the read finished.
+ *        This function does only work in host-mode.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @param addr The I2C address of the client device
+ * @param write_buff Pointer to the bytes to write before the repeated start
+ * @param write_size The amount of bytes to write
+ * @param read_buff Pointer to the read buffer where all read bytes will be written
+ * @param read_size The amount of bytes which have to be read
+ */
+uhal_status_t i2c_host_write_read_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t *write_buff,
+                                               const size_t write_size,
+                                               uint8_t *read_buff,
+                                               const size_t read_size);
+
+#define I2C_HOST_WRITE_READ_NON_BLOCKING(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size) \
+do {                                                                                                           \
+I2C_HOST_WRITE_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, write_buff, write_size, I2C_NO_STOP_BIT);       \
+I2C_HOST_READ_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, read_buff, read_size);                           \
+i2c_host_write_read_non_blocking(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size);     \
+}while(0);
+
 /**
  * @brief Function to execute a read non-blocking transaction (non-blocking means it will not wait till the transaction is finished and stack the transactions in to a buffer)
  *        This function does only work in host-mode.
@@ -157,6 +237,139 @@ I2C_HOST_READ_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, read_buff, size); \
 i2c_host_read_non_blocking(i2c_peripheral_num, addr, read_buff, size);             \
 }while(0);
 
+/**
+ * @brief Function to set the pins used for the bus recovery sequence.
+ *        When set, the driver automatically recovers the bus when a transaction ends with a timeout or bus error
+ *        and the bus doesn't return to idle.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @param scl_pin The pin used as SCL by the i2c peripheral
+ * @param sda_pin The pin used as SDA by the i2c peripheral
+ */
+uhal_status_t i2c_host_set_bus_recovery_pins(const i2c_periph_inst_t i2c_peripheral_num, const gpio_pin_t scl_pin, const gpio_pin_t sda_pin);
+
+#define I2C_HOST_SET_BUS_RECOVERY_PINS(i2c_peripheral_num, scl_pin, sda_pin) \
+do {                                                                      \
+I2C_HOST_SET_BUS_RECOVERY_PINS_FUNC_PARAMETER_CHECK(i2c_peripheral_num, scl_pin, sda_pin); \
+i2c_host_set_bus_recovery_pins(i2c_peripheral_num, scl_pin, sda_pin);             \
+}while(0);
+
+/**
+ * @brief Function to free a bus which is held low by a stuck client device.
+ *        Clocks SCL (up to) nine times using GPIO until the client releases SDA, generates a STOP condition
+ *        and forces the bus-state of the peripheral back to idle.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @return UHAL_STATUS_OK when the bus is free again, UHAL_STATUS_I2C_TIMEOUT when SDA is still held low
+ *         and UHAL_STATUS_INVALID_PARAMETERS when no recovery pins were set.
+ */
+uhal_status_t i2c_host_recover_bus(const i2c_periph_inst_t i2c_peripheral_num);
+
+#define I2C_HOST_RECOVER_BUS(i2c_peripheral_num) \
+do {                                        \
+I2C_HOST_RECOVER_BUS_FUNC_PARAMETER_CHECK(i2c_peripheral_num);    \
+i2c_host_recover_bus(i2c_peripheral_num);\
+}while(0);
+
+/**
+ * @brief Function to get detailed information about the last (or currently running) transaction.
+ *        Useful to find the real cause of a failed transaction, e.g. an address NACK versus a NACK halfway a write.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @return The information about the transaction
+ */
+i2c_transaction_info_t i2c_host_get_transaction_info(const i2c_periph_inst_t i2c_peripheral_num);
+
+/**
+ * @brief Callback which gets called when a transaction on an i2c peripheral has finished (after its last retry).
+ * @param i2c_peripheral_num The i2c peripheral on which the transaction finished
+ * @param status The status of the transaction, see i2c_host_get_transaction_info for the details
+ */
+typedef void (*i2c_host_transaction_done_cb_t)(const i2c_periph_inst_t i2c_peripheral_num, const uhal_status_t status);
+
+/**
+ * @brief Function to set a callback which gets called when a transaction on an i2c peripheral has finished.
+ *        See the platform documentation for the context the callback is called from.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @param transaction_done_cb The callback to call, NULL removes the callback
+ */
+uhal_status_t i2c_host_set_transaction_done_callback(const i2c_periph_inst_t i2c_peripheral_num,
+                                                     const i2c_host_transaction_done_cb_t transaction_done_cb);
+
+/**
+ * @brief Function to set the retry policy used for all transactions on an i2c peripheral.
+ *        Failed transactions are restarted by the ISR, so the blocking functions only return after the last attempt.
+ *        Before each retry the driver waits backoff_scl_periods SCL periods, doubling the backoff every retry.
+ * @param i2c_peripheral_num The i2c peripheral to use (has to be initialized with i2c_host_init first)
+ * @param max_retries The maximum amount of retries, 0 disables retrying
+ * @param backoff_scl_periods The backoff before the first retry in SCL periods
+ * @param retry_on The errors which are retried (I2C_ERROR_FLAG_ADDR_NACK, I2C_ERROR_FLAG_DATA_NACK and/or I2C_ERROR_FLAG_ARBLOST)
+ * @return UHAL_STATUS_OK, or UHAL_STATUS_INVALID_PARAMETERS for a backoff on a platform which can't time it
+ *         (the SAMD platforms without I2C_HOST_RETRY_TIMER)
+ */
+uhal_status_t i2c_host_set_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                        const uint8_t max_retries,
+                                        const uint16_t backoff_scl_periods,
+                                        const uint8_t retry_on);
+
+#define I2C_HOST_SET_RETRY_POLICY(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on) \
+do {                                                                                         \
+I2C_HOST_SET_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on); \
+i2c_host_set_retry_policy(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on);               \
+}while(0);
+
+/**
+ * @brief Function to set a retry policy for transactions to one specific device, overriding the policy of the peripheral.
+ * @param i2c_peripheral_num The i2c peripheral to use (has to be initialized with i2c_host_init first)
+ * @param addr The address of the device
+ * @param max_retries The maximum amount of retries, 0 disables retrying for this device
+ * @param backoff_scl_periods The backoff before the first retry in SCL periods
+ * @param retry_on The errors which are retried (I2C_ERROR_FLAG_ADDR_NACK, I2C_ERROR_FLAG_DATA_NACK and/or I2C_ERROR_FLAG_ARBLOST)
+ * @return UHAL_STATUS_OK, UHAL_STATUS_ERROR when all device policy slots are in use,
+ *         or UHAL_STATUS_INVALID_PARAMETERS for a backoff on a platform which can't time it
+ */
+uhal_status_t i2c_host_set_device_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t max_retries,
+                                               const uint16_t backoff_scl_periods,
+                                               const uint8_t retry_on);
+
+#define I2C_HOST_SET_DEVICE_RETRY_POLICY(i2c_peripheral_num, addr, max_retries, backoff_scl_periods, retry_on) \
+do {                                                                                                      \
+I2C_HOST_SET_DEVICE_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, max_retries, backoff_scl_periods, retry_on); \
+i2c_host_set_device_retry_policy(i2c_peripheral_num, addr, max_retries, backoff_scl_periods, retry_on);                \
+}while(0);
+
+/**
+ * @brief Function to scan the bus for devices, non-blocking.
+ *        Every (non-reserved) 7-bit address from 0x08 to 0x77 is probed with an address-only write by the ISR.
+ *        The results are stored in the device-presence cache, after which transactions to absent devices
+ *        fail straight away with UHAL_STATUS_I2C_DEVICE_NOT_PRESENT instead of waiting for a NACK.
+ *        Transactions started during the scan wait for the scan to finish.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @return UHAL_STATUS_OK when the scan was started, UHAL_STATUS_I2C_TIMEOUT when the bus didn't become idle
+ */
+uhal_status_t i2c_host_scan(const i2c_periph_inst_t i2c_peripheral_num);
+
+#define I2C_HOST_SCAN(i2c_peripheral_num) \
+do {                                 \
+I2C_HOST_SCAN_FUNC_PARAMETER_CHECK(i2c_peripheral_num); \
+i2c_host_scan(i2c_peripheral_num);         \
+}while(0);
+
+/**
+ * @brief Function to get the results of the last bus scan.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @param presence_bitmap Buffer of 16 bytes, bit (addr % 8) of byte (addr / 8) is set when a device ACKed on that address
+ * @return UHAL_STATUS_OK, or UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when the scan is still running (the bitmap is then incomplete)
+ */
+uhal_status_t i2c_host_get_scan_results(const i2c_periph_inst_t i2c_peripheral_num, uint8_t *presence_bitmap);
+
+/**
+ * @brief Function to clear the device-presence cache, e.g. after a sensor board has been (un)plugged.
+ *        Transactions to every address are attempted again until the next scan.
+ * @param i2c_peripheral_num The i2c peripheral to use
+ * @return UHAL_STATUS_OK
+ */
+uhal_status_t i2c_host_invalidate_presence_cache(const i2c_periph_inst_t i2c_peripheral_num);
+
 /**
  * @brief IRQ handler for I2C host data receive interrupt.
  *        Gets run when a host read action is executed.
@@ -183,6 +396,30 @@ void i2c_host_data_recv_irq(const void *hw, volatile bustransaction_t *transacti
  */
 void i2c_host_data_send_irq(const void *hw, volatile bustransaction_t *transaction) __attribute__((weak));
 
+/**
+ * @brief IRQ handler for I2C host error interrupt.
+ *        Gets run when a bus error, arbitration loss or one of the (optional) hardware timeouts occurs.
+ *        By defining this function inside a source file outside the Universal HALL, the default IRQ handler will be overridden
+ *        and the compiler will automatically link your own custom implementation.
+ * @param hw Handle to the HW peripheral on which the I2C bus is ran
+ * @param transaction I2C transaction info about the current initialized transaction on the HW peripheral.
+ *
+ * @note Using your own custom IRQ handler might break the error reporting of the write and read functions listed above
+ */
+void i2c_host_error_irq(const void *hw, volatile bustransaction_t *transaction) __attribute__((weak));
+
+/**
+ * @brief IRQ handler for the I2C host bus scanner.
+ *        Gets run for every probed address while a scan started with i2c_host_scan is running.
+ *        By defining this function inside a source file outside the Universal HALL, the default IRQ handler will be overridden
+ *        and the compiler will automatically link your own custom implementation.
+ * @param hw Handle to the HW peripheral on which the I2C bus is ran
+ * @param transaction I2C transaction info about the current initialized transaction on the HW peripheral.
+ *
+ * @note Using your own custom IRQ handler might break the device-presence cache
+ */
+void i2c_host_scan_irq(const void *hw, volatile bustransaction_t *transaction) __attribute__((weak));
+
 #endif /* IFNDEF DISABLE_I2C_HOST_MODULE*/
 
 #ifdef __cplusplus
@@ -27,6 +27,7 @@
 
 #ifndef DISABLE_I2C_SLAVE_MODULE
 
+#include "assert.h"
 #include "i2c_common/i2c_platform_specific.h"
 
 /* Extern c for compiling with c++*/
@@ -67,6 +68,142 @@ uhal_status_t i2c_slave_deinit(const i2c_periph_inst_t i2c_peripheral_num);
         retval;                                                                                                                                      \
     })
 
+/**
+ * @brief Put the i2c slave driver in register-map emulation mode.
+ *        The first byte written by the host sets the register pointer, every following byte is written into the
+ *        register at the pointer (only the bits set in the write mask are changed) after which the pointer is incremented.
+ *        Reads return the register at the pointer and also auto-increment. The pointer wraps around at amount_of_regs.
+ * @param i2c_peripheral_num The i2c peripheral to couple the register map to
+ * @param registers Pointer to the memory which is exposed as registers on the bus (NULL disables register-map mode)
+ * @param write_masks Pointer to an array (amount_of_regs long) with a bitmask of host-writable bits for each register.
+ *                    When NULL is given, every bit in every register is writable.
+ * @param amount_of_regs The amount of registers in the map (max 256)
+ * @param reg_change_cb Callback which gets called from the ISR on STOP when the host has written to the map (can be NULL)
+ *
+ * @note Only call this function while the bus is idle, preferably before i2c_slave_init.
+ */
+uhal_status_t i2c_slave_set_register_map(const i2c_periph_inst_t i2c_peripheral_num, volatile uint8_t *registers,
+                                         const uint8_t *write_masks, const uint16_t amount_of_regs,
+                                         const i2c_slave_reg_change_cb_t reg_change_cb);
+
+#define I2C_SLAVE_SET_REGISTER_MAP(i2c_peripheral_num, registers, write_masks, amount_of_regs, reg_change_cb)                                       \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_SET_REGISTER_MAP_PARAMETER_CHECK(i2c_peripheral_num, registers, write_masks, amount_of_regs, reg_change_cb);                       \
+        retval = i2c_slave_set_register_map(i2c_peripheral_num, registers, write_masks, amount_of_regs, reg_change_cb);                              \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Configure the addresses the i2c slave responds to, so one peripheral can emulate multiple devices.
+ *        Should be called after i2c_slave_init, the peripheral is shortly disabled while changing the configuration.
+ * @param i2c_peripheral_num The i2c peripheral to configure
+ * @param addr_mode I2C_SLAVE_ADDR_MODE_MASK: slave_addr is matched, ignoring the bits set in second_addr_or_mask
+ *                  I2C_SLAVE_ADDR_MODE_TWO_ADDRESSES: both slave_addr and second_addr_or_mask are matched
+ *                  I2C_SLAVE_ADDR_MODE_RANGE: every address from slave_addr up to and including second_addr_or_mask is matched
+ * @param slave_addr The (first) address to respond to
+ * @param second_addr_or_mask The address mask, second address or upper address limit depending on addr_mode
+ * @param addr_opt I2C_SLAVE_ADDR_OPT_GENERAL_CALL also responds to the general call address (0)
+ * @return UHAL_STATUS_INVALID_PARAMETERS for an invalid mode or range, or a 10-bit address which isn't used as single address
+ */
+uhal_status_t i2c_slave_set_addressing(const i2c_periph_inst_t i2c_peripheral_num, const i2c_slave_addr_mode_t addr_mode,
+                                       const uint16_t slave_addr, const uint16_t second_addr_or_mask, const i2c_slave_addr_opt_t addr_opt);
+
+#define I2C_SLAVE_SET_ADDRESSING(i2c_peripheral_num, addr_mode, slave_addr, second_addr_or_mask, addr_opt)                                          \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_SET_ADDRESSING_PARAMETER_CHECK(i2c_peripheral_num, addr_mode, slave_addr, second_addr_or_mask, addr_opt);                          \
+        retval = i2c_slave_set_addressing(i2c_peripheral_num, addr_mode, slave_addr, second_addr_or_mask, addr_opt);                                 \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Couple a handler to one of the addresses the i2c slave responds to.
+ *        The handler is called on address match with the matched address, and decides whether the address is ACKed.
+ * @param i2c_peripheral_num The i2c peripheral the address belongs to
+ * @param slave_addr The address to couple the handler to
+ * @param addr_handler The handler to call, NULL removes the handler
+ * @return UHAL_STATUS_ERROR when all I2C_SLAVE_MAX_ADDRESS_HANDLERS slots are in use
+ */
+uhal_status_t i2c_slave_set_address_handler(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t slave_addr,
+                                            const i2c_slave_addr_handler_t addr_handler);
+
+#define I2C_SLAVE_SET_ADDRESS_HANDLER(i2c_peripheral_num, slave_addr, addr_handler)                                                                  \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_SET_ADDRESS_HANDLER_PARAMETER_CHECK(i2c_peripheral_num, slave_addr);                                                               \
+        retval = i2c_slave_set_address_handler(i2c_peripheral_num, slave_addr, addr_handler);                                                        \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Same as i2c_slave_set_register_map, but the register map is only used for transactions on given address.
+ *        Transactions on addresses without their own register map use the map set by i2c_slave_set_register_map.
+ * @param i2c_peripheral_num The i2c peripheral the address belongs to
+ * @param slave_addr The address to couple the register map to
+ * @param registers Pointer to the memory which is exposed as registers on the bus (NULL removes the register map)
+ * @param write_masks Pointer to an array with a bitmask of host-writable bits for each register (NULL makes all bits writable)
+ * @param amount_of_regs The amount of registers in the map (max 256)
+ * @param reg_change_cb Callback which gets called from the ISR on STOP when the host has written to the map (can be NULL)
+ * @return UHAL_STATUS_ERROR when all I2C_SLAVE_MAX_ADDRESS_HANDLERS slots are in use
+ */
+uhal_status_t i2c_slave_set_address_register_map(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t slave_addr,
+                                                 volatile uint8_t *registers, const uint8_t *write_masks, const uint16_t amount_of_regs,
+                                                 const i2c_slave_reg_change_cb_t reg_change_cb);
+
+#define I2C_SLAVE_SET_ADDRESS_REGISTER_MAP(i2c_peripheral_num, slave_addr, registers, write_masks, amount_of_regs, reg_change_cb)                   \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_SET_ADDRESS_HANDLER_PARAMETER_CHECK(i2c_peripheral_num, slave_addr);                                                               \
+        I2C_SLAVE_SET_REGISTER_MAP_PARAMETER_CHECK(i2c_peripheral_num, registers, write_masks, amount_of_regs, reg_change_cb);                       \
+        retval = i2c_slave_set_address_register_map(i2c_peripheral_num, slave_addr, registers, write_masks, amount_of_regs, reg_change_cb);          \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Put the i2c slave driver in DMA mode.
+ *        Received bytes are moved to rx_buffer and transmitted bytes are taken from tx_buffer by the DMA controller,
+ *        smart mode takes care of the acknowledgements. Only the address match and stop interrupts reach the CPU,
+ *        the transfer_done_cb is called when a transfer has been ended by a STOP or repeated START condition.
+ *        Bytes written by the host after rx_buffer is full are NACKed, reads past the end of tx_buffer return 0xFF.
+ * @param i2c_peripheral_num The i2c peripheral to use DMA on
+ * @param rx_channel The DMA channel to use for receiving data from the host
+ * @param rx_buffer The buffer to store data written by the host in (NULL NACKs every write)
+ * @param rx_size The size of the rx buffer in bytes
+ * @param tx_channel The DMA channel to use for transmitting data to the host
+ * @param tx_buffer The buffer with data to send when the host reads (NULL sends 0xFF on every read)
+ * @param tx_size The size of the tx buffer in bytes
+ * @param transfer_done_cb Callback which gets called from the ISR when a transfer has finished (can be NULL)
+ *
+ * @note The DMA peripheral has to be initialized with dma_init before using this function.
+ * @note DMA mode takes precedence over the register-map mode.
+ */
+uhal_status_t i2c_slave_set_dma(const i2c_periph_inst_t i2c_peripheral_num, const dma_channel_t rx_channel, uint8_t *rx_buffer,
+                                const size_t rx_size, const dma_channel_t tx_channel, const uint8_t *tx_buffer, const size_t tx_size,
+                                const i2c_slave_dma_done_cb_t transfer_done_cb);
+
+#define I2C_SLAVE_SET_DMA(i2c_peripheral_num, rx_channel, rx_buffer, rx_size, tx_channel, tx_buffer, tx_size, transfer_done_cb)                      \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_SET_DMA_PARAMETER_CHECK(i2c_peripheral_num, rx_channel, rx_buffer, rx_size, tx_channel, tx_buffer, tx_size, transfer_done_cb);     \
+        retval = i2c_slave_set_dma(i2c_peripheral_num, rx_channel, rx_buffer, rx_size, tx_channel, tx_buffer, tx_size, transfer_done_cb);            \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Take the i2c slave driver out of DMA mode.
+ * @param i2c_peripheral_num The i2c peripheral to stop using DMA on
+ */
+uhal_status_t i2c_slave_disable_dma(const i2c_periph_inst_t i2c_peripheral_num);
+
+#define I2C_SLAVE_DISABLE_DMA(i2c_peripheral_num)                                                                                                    \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        I2C_SLAVE_DISABLE_DMA_PARAMETER_CHECK(i2c_peripheral_num);                                                                                   \
+        retval = i2c_slave_disable_dma(i2c_peripheral_num);                                                                                          \
+        retval;                                                                                                                                      \
+    })
+
 /**
  * @brief IRQ handler for I2C Client address match interrupt.
  *        Gets run when a start condition with valid slave address is detected.
@@ -0,0 +1,110 @@
+/**
+* \file            hal_multicore.h
+* \brief           Multicore service module include file
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_MULTICORE_H
+#define HAL_MULTICORE_H
+
+#ifndef DISABLE_MULTICORE_MODULE
+
+#include <stddef.h>
+#include "error_handling.h"
+#include "multicore/multicore_platform_specific.h"
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Function to start the multicore service on the second core.
+ *        The service core sleeps until work is posted, executes the work in posting order and hands the completions back.
+ *
+ * @return UHAL_STATUS_OK, or UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when the service is already running
+ */
+uhal_status_t multicore_service_init(void);
+
+/**
+ * @brief Function to stop the multicore service, the second core is reset and all queued work and completions are dropped.
+ *        Interrupts which were enabled by work on the service core have to be disabled by the application first.
+ *
+ * @return UHAL_STATUS_OK
+ */
+uhal_status_t multicore_service_deinit(void);
+
+/**
+ * @brief Function to post work to the service core without waiting for it.
+ *        The work is queued in a lock-free ring in shared SRAM and the service core is woken up through the inter-core FIFO.
+ *        When done is not NULL it is called with the same argument by multicore_process_completions on the posting core,
+ *        after the work has finished. Work posted from the service core itself is executed straight away.
+ *
+ * @param work The function to execute on the service core
+ * @param arg The argument passed to work and done
+ * @param done The function called on the posting core after the work has finished (can be NULL)
+ * @return UHAL_STATUS_OK, UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when the ring is full (the work is not posted)
+ *         or UHAL_STATUS_ERROR when the service isn't running
+ */
+uhal_status_t multicore_post_work(const multicore_work_func_t work, void *arg, const multicore_done_func_t done);
+
+#define MULTICORE_POST_WORK(work, arg, done)                                                                                                         \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        MULTICORE_POST_WORK_PARAMETER_CHECK(work, arg, done);                                                                                        \
+        retval = multicore_post_work(work, arg, done);                                                                                               \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to execute work on the service core and wait until it has finished.
+ *        Used to initialize drivers on the service core, interrupts enabled by a driver init are then handled by the service core.
+ *        The calling core sleeps (WFE) while waiting. Work run from the service core itself is executed straight away.
+ *
+ * @param work The function to execute on the service core
+ * @param arg The argument passed to work
+ * @return UHAL_STATUS_OK, UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when the ring is full
+ *         or UHAL_STATUS_ERROR when the service isn't running
+ */
+uhal_status_t multicore_run_blocking(const multicore_work_func_t work, void *arg);
+
+#define MULTICORE_RUN_BLOCKING(work, arg)                                                                                                            \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        MULTICORE_POST_WORK_PARAMETER_CHECK(work, arg, NULL);                                                                                        \
+        retval = multicore_run_blocking(work, arg);                                                                                                  \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to call the done functions of the finished work, has to be called regularly (e.g. from the main loop).
+ *        Completions are never delivered from an interrupt, so the timing of the posting core isn't disturbed.
+ *
+ * @return The amount of done functions called
+ */
+size_t multicore_process_completions(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DISABLE_MULTICORE_MODULE */
+#endif /* HAL_MULTICORE_H */
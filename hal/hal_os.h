@@ -0,0 +1,111 @@
+/**
+* \file            hal_os.h
+* \brief           Optional operating system hooks used by the blocking driver functions
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_OS_H
+#define HAL_OS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief The amount of busses which get a mutex and a completion event.
+ *        On the SAMD platforms SERCOMn is bus n, on the RP2040 i2cN is bus N and spiN is bus 2 + N.
+ */
+#define UHAL_OS_BUS_COUNT 8
+
+#define UHAL_OS_BUS_SERCOM(sercom_num)  (sercom_num)
+#define UHAL_OS_BUS_RP2040_I2C(i2c_num) (i2c_num)
+#define UHAL_OS_BUS_RP2040_SPI(spi_num) (2 + (spi_num))
+
+#ifdef UHAL_OS_HOOKS
+
+/**
+ * @brief Creates the mutex and the completion event of a bus, called by the init function of the driver which uses the bus.
+ *        Calling it again for the same bus has no effect.
+ *
+ * @param bus The bus number (UHAL_OS_BUS_*)
+ */
+void uhal_os_bus_init(const uint8_t bus);
+
+/**
+ * @brief Takes the mutex of a bus, the calling task sleeps while another task owns the bus.
+ *        The mutex is not recursive. It is not taken before the scheduler runs or from an interrupt handler.
+ *
+ * @param bus The bus number (UHAL_OS_BUS_*)
+ */
+void uhal_os_bus_lock(const uint8_t bus);
+
+/**
+ * @brief Gives the mutex of a bus back.
+ *
+ * @param bus The bus number (UHAL_OS_BUS_*)
+ */
+void uhal_os_bus_unlock(const uint8_t bus);
+
+/**
+ * @brief Sleeps the calling task until the completion event of the bus is notified or the timeout passed.
+ *        A notification which came in before the call ends the wait straight away. The drivers re-check
+ *        their transaction state afterwards, so a stale notification only costs one extra check.
+ *
+ * @param bus The bus number (UHAL_OS_BUS_*)
+ * @param timeout_ms The maximum time to sleep
+ * @return true when the task was woken by a notification, false on a timeout or when the caller can't sleep
+ *         (no scheduler running, called from an interrupt handler). The driver then falls back to busy-waiting.
+ */
+bool uhal_os_bus_wait(const uint8_t bus, const uint32_t timeout_ms);
+
+/**
+ * @brief Notifies the completion event of a bus, called from the completion interrupt of the driver.
+ *
+ * @param bus The bus number (UHAL_OS_BUS_*)
+ */
+void uhal_os_bus_notify_from_isr(const uint8_t bus);
+
+#define UHAL_OS_BUS_INIT(bus)              uhal_os_bus_init(bus)
+#define UHAL_OS_BUS_LOCK(bus)              uhal_os_bus_lock(bus)
+#define UHAL_OS_BUS_UNLOCK(bus)            uhal_os_bus_unlock(bus)
+#define UHAL_OS_BUS_WAIT(bus, timeout_ms)  uhal_os_bus_wait(bus, timeout_ms)
+#define UHAL_OS_BUS_NOTIFY_FROM_ISR(bus)   uhal_os_bus_notify_from_isr(bus)
+
+#else
+
+/* Without UHAL_OS_HOOKS the hooks compile to nothing and the blocking functions busy-wait */
+#define UHAL_OS_BUS_INIT(bus)              do {} while (0)
+#define UHAL_OS_BUS_LOCK(bus)              do {} while (0)
+#define UHAL_OS_BUS_UNLOCK(bus)            do {} while (0)
+#define UHAL_OS_BUS_WAIT(bus, timeout_ms)  false
+#define UHAL_OS_BUS_NOTIFY_FROM_ISR(bus)   do {} while (0)
+
+#endif /* UHAL_OS_HOOKS */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HAL_OS_H */
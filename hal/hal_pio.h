@@ -0,0 +1,142 @@
+/**
+* \file            hal_pio.h
+* \brief           PIO engine module include file
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef HAL_PIO_H
+#define HAL_PIO_H
+
+#ifndef DISABLE_PIO_MODULE
+
+#include "hal_gpio.h"
+#include "pio/pio_platform_specific.h"
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Function to load a bit-stream program on a PIO state machine and start it.
+ *        Programs are shared between the state machines of one PIO block, so a program is only loaded once per block.
+ *
+ * @param pio_engine_num The state machine to run the program on
+ * @param program The program to run
+ * @param pins The pins used by the program (see the platform documentation for the pins each program uses)
+ * @param frequency The bit rate, byte rate or sample rate of the program (depends on the program), 0 runs the state machine at full speed
+ * @param pio_engine_opt Extra configuration options for the PIO engine
+ */
+uhal_status_t pio_engine_init(const pio_engine_inst_t pio_engine_num, const pio_engine_program_t program, const pio_engine_pins_t pins,
+                              const uint32_t frequency, const pio_engine_opt_t pio_engine_opt);
+
+#define PIO_ENGINE_INIT(pio_engine_num, program, pins, frequency, pio_engine_opt)                                                                   \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        PIO_ENGINE_INIT_PARAMETER_CHECK(pio_engine_num, program, frequency, pio_engine_opt);                                                         \
+        retval = pio_engine_init(pio_engine_num, program, pins, frequency, pio_engine_opt);                                                          \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to stop the state machine and release its program and DMA channels.
+ *
+ * @param pio_engine_num The state machine to stop
+ */
+uhal_status_t pio_engine_deinit(const pio_engine_inst_t pio_engine_num);
+
+#define PIO_ENGINE_DEINIT(pio_engine_num)                                                                                                            \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        PIO_ENGINE_DEINIT_PARAMETER_CHECK(pio_engine_num);                                                                                           \
+        retval = pio_engine_deinit(pio_engine_num);                                                                                                  \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to stream a buffer into the state machine, waits till the last byte is taken by the state machine.
+ *
+ * @param pio_engine_num The state machine to write to
+ * @param write_buff Pointer to a buffer containing the data to write
+ * @param size The amount of bytes to write
+ */
+uhal_status_t pio_engine_write_blocking(const pio_engine_inst_t pio_engine_num, const unsigned char *write_buff, const size_t size);
+
+#define PIO_ENGINE_WRITE_BLOCKING(pio_engine_num, write_buff, size)                                                                                  \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        PIO_ENGINE_WRITE_PARAMETER_CHECK(pio_engine_num, write_buff, size);                                                                          \
+        retval = pio_engine_write_blocking(pio_engine_num, write_buff, size);                                                                        \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to start streaming a buffer into the state machine, returns directly after the DMA transfer is started.
+ *        The buffer has to stay valid till the next call on the same state machine.
+ *
+ * @param pio_engine_num The state machine to write to
+ * @param write_buff Pointer to a buffer containing the data to write
+ * @param size The amount of bytes to write
+ */
+uhal_status_t pio_engine_write_non_blocking(const pio_engine_inst_t pio_engine_num, const unsigned char *write_buff, const size_t size);
+
+#define PIO_ENGINE_WRITE_NON_BLOCKING(pio_engine_num, write_buff, size)                                                                              \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        PIO_ENGINE_WRITE_PARAMETER_CHECK(pio_engine_num, write_buff, size);                                                                          \
+        retval = pio_engine_write_non_blocking(pio_engine_num, write_buff, size);                                                                    \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to read bytes from a state machine which samples its input pins (SPI program).
+ *        Zeros are shifted out while reading.
+ *
+ * @param pio_engine_num The state machine to read from
+ * @param read_buff Pointer to a read buffer
+ * @param amount_of_bytes The amount of bytes to read
+ */
+uhal_status_t pio_engine_read_blocking(const pio_engine_inst_t pio_engine_num, unsigned char *read_buff, const size_t amount_of_bytes);
+
+#define PIO_ENGINE_READ_BLOCKING(pio_engine_num, read_buff, amount_of_bytes)                                                                         \
+    ({                                                                                                                                               \
+        int retval;                                                                                                                                  \
+        PIO_ENGINE_READ_PARAMETER_CHECK(pio_engine_num, read_buff, amount_of_bytes);                                                                 \
+        retval = pio_engine_read_blocking(pio_engine_num, read_buff, amount_of_bytes);                                                               \
+        retval;                                                                                                                                      \
+    })
+
+/**
+ * @brief Function to get the position of a quadrature encoder counted by the quadrature program.
+ *        The state machine keeps the count itself, so no transitions are lost between calls.
+ *        The function drains the stale counts from the RX FIFO and waits for the next sample.
+ *
+ * @param pio_engine_num The state machine running the quadrature program
+ * @param position Pointer to which the position in counts (4 per encoder cycle) is written
+ */
+uhal_status_t pio_engine_quadrature_get_position(const pio_engine_inst_t pio_engine_num, int32_t *position);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DISABLE_PIO_MODULE */
+
+#endif /* HAL_PIO_H */
@@ -0,0 +1,64 @@
+/**
+* \file            hal_power.h
+* \brief           Power module include file
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_POWER_H
+#define HAL_POWER_H
+
+#ifndef DISABLE_POWER_MODULE
+
+#include "error_handling.h"
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Function to check whether the device can enter standby without breaking a running transfer.
+ *        A SERCOM with a transaction in flight (including a pending I2C retry or a running scan) has to be
+ *        initialized with the RUN_IN_STANDBY option, an enabled DMA channel has to be started with DMA_OPT_RUN_IN_STANDBY.
+ *        Idle peripherals don't block standby.
+ *
+ * @return UHAL_STATUS_OK when standby can be entered,
+ *         UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when a transfer is running on a peripheral which stops in standby
+ */
+uhal_status_t power_check_standby(void);
+
+/**
+ * @brief Function to put the device in standby, it returns after an interrupt woke the device up.
+ *        The check of power_check_standby and the entry are done with the interrupts masked, an interrupt which comes in
+ *        in between keeps pending and wakes the device straight away. The handler runs before the function returns.
+ *        Peripherals keep running in standby only when their generic clock generator has CLK_GEN_OPT_RUN_IN_STANDBY set.
+ *
+ * @return UHAL_STATUS_OK after waking up,
+ *         UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when a transfer would break (standby is not entered)
+ */
+uhal_status_t power_enter_standby(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* DISABLE_POWER_MODULE */
+#endif /* HAL_POWER_H */
@@ -0,0 +1,253 @@
+/**
+* \file            hal_sercom.hpp
+* \brief           C++ driver templates for the SERCOM based host drivers
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef HAL_SERCOM_HPP
+#define HAL_SERCOM_HPP
+
+#if !defined(__cplusplus) || __cplusplus < 201703L
+#error "hal_sercom.hpp requires C++17 or newer"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hal_gpio.h"
+#include "hal_i2c_host.h"
+#include "hal_spi_host.h"
+#include "sercom/sercom_traits.hpp"
+
+namespace uhal {
+
+#ifndef DISABLE_SPI_HOST_MODULE
+
+/**
+ * @brief SPI host driver bound to one SERCOM at compile time.
+ *        The data path accesses the registers of the SERCOM directly, the configuration and transaction boundaries
+ *        are handled by the C driver (spi_host_*), so both APIs can be mixed on the same peripheral.
+ * @tparam SpiNum The SPI peripheral to use
+ * @tparam BusOpt The bus options given to init, the character size selects the data path at compile time
+ */
+template<spi_host_inst_t SpiNum, spi_bus_opt_t BusOpt = SPI_BUS_OPT_USE_DEFAULT>
+class SpiHost {
+public:
+    using traits = SercomTraits<SpiNum>;
+
+    static constexpr IRQn_Type irqn = traits::first_irqn;
+    static constexpr dma_trigger_t dma_trigger_rx = traits::dma_trigger_rx;
+    static constexpr dma_trigger_t dma_trigger_tx = traits::dma_trigger_tx;
+
+    /**
+     * @brief Initializes the SPI peripheral, the arguments are checked at compile time like SPI_HOST_INIT does.
+     * @tparam ClockSource The clock source to use for configuring the SPI peripheral
+     * @tparam ClockFreq The frequency of the clock source
+     * @tparam BusFreq The frequency/baud rate to use for the SPI communication
+     */
+    template<uint32_t ClockSource, uint32_t ClockFreq, unsigned long BusFreq>
+    static uhal_status_t init() {
+        SPI_HOST_INIT_PARAMETER_CHECK(SpiNum, ClockSource, ClockFreq, BusFreq, BusOpt);
+        return spi_host_init(SpiNum, ClockSource, ClockFreq, BusFreq, BusOpt);
+    }
+
+    static uhal_status_t deinit() {
+        return spi_host_deinit(SpiNum);
+    }
+
+    static uhal_status_t start_transaction(const gpio_pin_t chip_select_pin,
+                                           const spi_extra_dev_opt_t device_specific_config_opt = SPI_EXTRA_OPT_USE_DEFAULT) {
+        return spi_host_start_transaction(SpiNum, chip_select_pin, device_specific_config_opt);
+    }
+
+    static uhal_status_t end_transaction(const gpio_pin_t chip_select_pin) {
+        return spi_host_end_transaction(SpiNum, chip_select_pin);
+    }
+
+    /**
+     * @brief Shifts one character out and returns the character shifted in.
+     */
+    static inline uint16_t transfer(const uint16_t data) {
+        Sercom *const sercom = traits::hw();
+        sercom->SPI.DATA.reg = data;
+        while (sercom->SPI.INTFLAG.bit.RXC == 0) {
+            // Waiting Complete Reception
+        }
+        return sercom->SPI.DATA.reg;
+    }
+
+    static inline uhal_status_t write(const unsigned char *write_buff, const size_t size) {
+        transfer_buffer(write_buff, nullptr, size);
+        return UHAL_STATUS_OK;
+    }
+
+    static inline uhal_status_t read(unsigned char *read_buff, const size_t size) {
+        transfer_buffer(nullptr, read_buff, size);
+        return UHAL_STATUS_OK;
+    }
+
+    /**
+     * @brief Full-duplex transfer, write_buff and read_buff may be the same buffer.
+     */
+    static inline uhal_status_t transfer(const unsigned char *write_buff, unsigned char *read_buff, const size_t size) {
+        transfer_buffer(write_buff, read_buff, size);
+        return UHAL_STATUS_OK;
+    }
+
+private:
+    static inline void transfer_buffer(const unsigned char *write_buff, unsigned char *read_buff, size_t size) {
+        Sercom *const sercom = traits::hw();
+#ifdef __SAMD51__
+        /* spi_host_init enables CTRLC.DATA32B for 8-bit characters */
+        if constexpr (!(BusOpt & (SPI_BUS_OPT_CHAR_SIZE_10_BIT | SPI_BUS_OPT_DATA32_DISABLE))) {
+            while (size > 0) {
+                const uint8_t chunk = (size > SPI_HOST_DATA32_MAX_CHUNK) ? SPI_HOST_DATA32_MAX_CHUNK : size;
+                sercom->SPI.LENGTH.reg = SERCOM_SPI_LENGTH_LENEN | SERCOM_SPI_LENGTH_LEN(chunk);
+                while (sercom->SPI.SYNCBUSY.reg & SERCOM_SPI_SYNCBUSY_LENGTH);
+                for (uint8_t offset = 0; offset < chunk; offset += 4) {
+                    const uint8_t word_bytes = (chunk - offset < 4) ? (chunk - offset) : 4;
+                    uint32_t word = 0;
+                    for (uint8_t byte = 0; write_buff != nullptr && byte < word_bytes; byte++) {
+                        word |= (uint32_t) write_buff[offset + byte] << (8 * byte);
+                    }
+                    sercom->SPI.DATA.reg = word;
+                    while (sercom->SPI.INTFLAG.bit.RXC == 0);
+                    word = sercom->SPI.DATA.reg;
+                    for (uint8_t byte = 0; read_buff != nullptr && byte < word_bytes; byte++) {
+                        read_buff[offset + byte] = (word >> (8 * byte)) & 0xFF;
+                    }
+                }
+                write_buff = (write_buff != nullptr) ? write_buff + chunk : nullptr;
+                read_buff = (read_buff != nullptr) ? read_buff + chunk : nullptr;
+                size -= chunk;
+            }
+            return;
+        }
+#endif
+        for (size_t i = 0; i < size; i++) {
+            sercom->SPI.DATA.reg = (write_buff != nullptr) ? write_buff[i] : 0x00;
+            while (sercom->SPI.INTFLAG.bit.RXC == 0);
+            const uint8_t data = sercom->SPI.DATA.reg;
+            if (read_buff != nullptr) {
+                read_buff[i] = data;
+            }
+        }
+    }
+};
+
+#endif /* DISABLE_SPI_HOST_MODULE */
+
+#ifndef DISABLE_I2C_HOST_MODULE
+
+/**
+ * @brief I2C host driver bound to one SERCOM at compile time.
+ *        The transactions are run by the interrupt driven C driver (i2c_host_*), called with a constant peripheral number.
+ *        The bus state and transaction state are read from the SERCOM and the transaction buffer directly.
+ * @tparam I2cNum The I2C peripheral to use
+ */
+template<i2c_periph_inst_t I2cNum>
+class I2cHost {
+public:
+    using traits = SercomTraits<I2cNum>;
+
+    static constexpr IRQn_Type irqn = traits::first_irqn;
+    static constexpr dma_trigger_t dma_trigger_rx = traits::dma_trigger_rx;
+    static constexpr dma_trigger_t dma_trigger_tx = traits::dma_trigger_tx;
+
+    /**
+     * @brief Initializes the I2C peripheral, the arguments are checked at compile time like I2C_HOST_INIT does.
+     * @tparam ClockSources The clock source(s) to use
+     * @tparam ClockFreq The clock frequency of the peripheral
+     * @tparam BaudRate The I2C clock frequency
+     * @tparam ExtraOpt The extra configuration options
+     */
+    template<i2c_clock_sources_t ClockSources, uint32_t ClockFreq, uint32_t BaudRate, i2c_extra_opt_t ExtraOpt = I2C_EXTRA_OPT_NONE>
+    static uhal_status_t init() {
+        I2C_HOST_INIT_FUNC_PARAMETER_CHECK(I2cNum, ClockSources, ClockFreq, BaudRate, ExtraOpt);
+        return i2c_host_init(I2cNum, ClockSources, ClockFreq, BaudRate, ExtraOpt);
+    }
+
+    static uhal_status_t deinit() {
+        return i2c_host_deinit(I2cNum);
+    }
+
+    static uhal_status_t write_blocking(const uint16_t addr, const uint8_t *write_buff, const size_t size,
+                                        const i2c_stop_bit_t stop_bit = I2C_STOP_BIT) {
+        return i2c_host_write_blocking(I2cNum, addr, write_buff, size, stop_bit);
+    }
+
+    static uhal_status_t write_non_blocking(const uint16_t addr, const uint8_t *write_buff, const size_t size,
+                                            const i2c_stop_bit_t stop_bit = I2C_STOP_BIT) {
+        return i2c_host_write_non_blocking(I2cNum, addr, write_buff, size, stop_bit);
+    }
+
+    static uhal_status_t read_blocking(const uint16_t addr, uint8_t *read_buff, const size_t size) {
+        return i2c_host_read_blocking(I2cNum, addr, read_buff, size);
+    }
+
+    static uhal_status_t read_non_blocking(const uint16_t addr, uint8_t *read_buff, const size_t size) {
+        return i2c_host_read_non_blocking(I2cNum, addr, read_buff, size);
+    }
+
+    static uhal_status_t write_read_blocking(const uint16_t addr, const uint8_t *write_buff, const size_t write_size,
+                                             uint8_t *read_buff, const size_t read_size) {
+        return i2c_host_write_read_blocking(I2cNum, addr, write_buff, write_size, read_buff, read_size);
+    }
+
+    static uhal_status_t set_bus_recovery_pins(const gpio_pin_t scl_pin, const gpio_pin_t sda_pin) {
+        return i2c_host_set_bus_recovery_pins(I2cNum, scl_pin, sda_pin);
+    }
+
+    static uhal_status_t recover_bus() {
+        return i2c_host_recover_bus(I2cNum);
+    }
+
+    static i2c_transaction_info_t transaction_info() {
+        return i2c_host_get_transaction_info(I2cNum);
+    }
+
+    static uhal_status_t scan() {
+        return i2c_host_scan(I2cNum);
+    }
+
+    static uhal_status_t get_scan_results(uint8_t *presence_bitmap) {
+        return i2c_host_get_scan_results(I2cNum, presence_bitmap);
+    }
+
+    /**
+     * @brief Whether the driver has finished the last transaction (the interrupt handler set the SERCOM back to idle).
+     */
+    static inline bool transaction_done() {
+        return traits::bustransaction().transaction_type == SERCOMACT_IDLE_I2CM;
+    }
+
+    /**
+     * @brief The BUSSTATE field of the SERCOM (0 = unknown, 1 = idle, 2 = owner, 3 = busy).
+     */
+    static inline uint8_t bus_state() {
+        return (traits::hw()->I2CM.STATUS.reg & SERCOM_I2CM_STATUS_BUSSTATE_Msk) >> SERCOM_I2CM_STATUS_BUSSTATE_Pos;
+    }
+};
+
+#endif /* DISABLE_I2C_HOST_MODULE */
+
+}
+
+#endif //HAL_SERCOM_HPP
@@ -0,0 +1,106 @@
+/**
+* \file            os_freertos.c
+* \brief           FreeRTOS implementation of the operating system hooks
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifdef UHAL_OS_HOOKS
+
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#include "hal_os.h"
+
+#if configSUPPORT_STATIC_ALLOCATION != 1
+#error "The FreeRTOS hooks of the Universal hal need configSUPPORT_STATIC_ALLOCATION"
+#endif
+
+/**
+ * @brief The mutexes and completion events of the busses, statically allocated by uhal_os_bus_init.
+ */
+static StaticSemaphore_t bus_mutex_buffers[UHAL_OS_BUS_COUNT];
+static StaticSemaphore_t bus_event_buffers[UHAL_OS_BUS_COUNT];
+static SemaphoreHandle_t bus_mutexes[UHAL_OS_BUS_COUNT];
+static SemaphoreHandle_t bus_events[UHAL_OS_BUS_COUNT];
+
+/**
+ * @brief The task which took the mutex of a bus, NULL when uhal_os_bus_lock didn't take it.
+ *        The scheduler state can change between locking and unlocking, so uhal_os_bus_unlock checks this instead of can_block.
+ */
+static TaskHandle_t bus_owners[UHAL_OS_BUS_COUNT];
+
+/**
+ * @brief Helper function which returns whether the caller runs in an interrupt handler (IPSR holds the exception number).
+ */
+static inline bool in_isr(void) {
+    uint32_t ipsr;
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    return ipsr != 0;
+}
+
+/**
+ * @brief Helper function which returns whether the caller is a task which is allowed to block.
+ */
+static inline bool can_block(void) {
+    return !in_isr() && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+void uhal_os_bus_init(const uint8_t bus) {
+    if (bus_mutexes[bus] == NULL) {
+        bus_mutexes[bus] = xSemaphoreCreateMutexStatic(&bus_mutex_buffers[bus]);
+    }
+    if (bus_events[bus] == NULL) {
+        bus_events[bus] = xSemaphoreCreateBinaryStatic(&bus_event_buffers[bus]);
+    }
+}
+
+void uhal_os_bus_lock(const uint8_t bus) {
+    if (bus_mutexes[bus] != NULL && can_block() && xSemaphoreTake(bus_mutexes[bus], portMAX_DELAY) == pdTRUE) {
+        bus_owners[bus] = xTaskGetCurrentTaskHandle();
+    }
+}
+
+void uhal_os_bus_unlock(const uint8_t bus) {
+    if (!in_isr() && bus_owners[bus] != NULL && bus_owners[bus] == xTaskGetCurrentTaskHandle()) {
+        bus_owners[bus] = NULL;
+        xSemaphoreGive(bus_mutexes[bus]);
+    }
+}
+
+bool uhal_os_bus_wait(const uint8_t bus, const uint32_t timeout_ms) {
+    if (bus_events[bus] == NULL || !can_block()) {
+        return false;
+    }
+    const TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    return xSemaphoreTake(bus_events[bus], timeout_ticks ? timeout_ticks : 1) == pdTRUE;
+}
+
+void uhal_os_bus_notify_from_isr(const uint8_t bus) {
+    if (bus_events[bus] == NULL) {
+        return;
+    }
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(bus_events[bus], &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+#endif /* UHAL_OS_HOOKS */
@@ -1,6 +1,6 @@
 /**
-* \file            spi.c
-* \brief           Source file which implements the standard SPI API functions
+* \file            os_hooks.c
+* \brief           Default (bare-metal) implementation of the operating system hooks
 */
 /*
 *  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
@@ -22,29 +22,29 @@
 * Author:          Victor Hogeweij <hogeweyv@gmail.com>
 */
 
-#include <hal_spi_host.h>
-#include <stddef.h>
+#ifdef UHAL_OS_HOOKS
 
-void spi_host_init(const spi_dev_t *spi_instance, unsigned long baud_rate) {
+#include "hal_os.h"
 
-}
-
-void spi_host_deinit(const spi_dev_t *spi_instance) {
+/*
+ * The hooks are weak, an adapter (or the application) overrides the ones it implements.
+ * Without an override the bus isn't locked and the blocking functions busy-wait.
+ */
 
+__attribute__((weak)) void uhal_os_bus_init(const uint8_t bus) {
 }
 
-void spi_write_blocking(const spi_dev_t *spi_instance, const unsigned char *write_buff, size_t size) {
-
+__attribute__((weak)) void uhal_os_bus_lock(const uint8_t bus) {
 }
 
-void spi_write_non_blocking(const spi_dev_t *spi_instance, const unsigned char *write_buff, size_t size) {
-
+__attribute__((weak)) void uhal_os_bus_unlock(const uint8_t bus) {
 }
 
-void spi_read_blocking(const spi_dev_t *spi_instance, unsigned char *read_buff, size_t amount_of_bytes) {
-
+__attribute__((weak)) bool uhal_os_bus_wait(const uint8_t bus, const uint32_t timeout_ms) {
+    return false;
 }
 
-void spi_read_non_blocking(const spi_dev_t *spi_instance, unsigned char *read_buff, size_t amount_of_bytes) {
+__attribute__((weak)) void uhal_os_bus_notify_from_isr(const uint8_t bus) {
+}
 
-}
\ No newline at end of file
+#endif /* UHAL_OS_HOOKS */
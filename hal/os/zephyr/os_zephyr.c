@@ -0,0 +1,79 @@
+/**
+* \file            os_zephyr.c
+* \brief           Zephyr implementation of the operating system hooks
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifdef UHAL_OS_HOOKS
+
+#include <zephyr/kernel.h>
+#include "hal_os.h"
+
+/**
+ * @brief The mutexes and completion events of the busses, initialized by uhal_os_bus_init.
+ */
+static struct k_mutex bus_mutexes[UHAL_OS_BUS_COUNT];
+static struct k_sem bus_events[UHAL_OS_BUS_COUNT];
+static bool bus_initialized[UHAL_OS_BUS_COUNT];
+
+/**
+ * @brief Helper function which returns whether the caller is a thread which is allowed to block.
+ */
+static inline bool can_block(const uint8_t bus) {
+    return bus_initialized[bus] && !k_is_in_isr() && !k_is_pre_kernel();
+}
+
+void uhal_os_bus_init(const uint8_t bus) {
+    if (bus_initialized[bus]) {
+        return;
+    }
+    k_mutex_init(&bus_mutexes[bus]);
+    k_sem_init(&bus_events[bus], 0, 1);
+    bus_initialized[bus] = true;
+}
+
+void uhal_os_bus_lock(const uint8_t bus) {
+    if (can_block(bus)) {
+        k_mutex_lock(&bus_mutexes[bus], K_FOREVER);
+    }
+}
+
+void uhal_os_bus_unlock(const uint8_t bus) {
+    /* The mutex records its owner, so it is only unlocked when this thread took it in uhal_os_bus_lock */
+    if (bus_initialized[bus] && !k_is_in_isr() && bus_mutexes[bus].owner == k_current_get()) {
+        k_mutex_unlock(&bus_mutexes[bus]);
+    }
+}
+
+bool uhal_os_bus_wait(const uint8_t bus, const uint32_t timeout_ms) {
+    if (!can_block(bus)) {
+        return false;
+    }
+    return k_sem_take(&bus_events[bus], K_MSEC(timeout_ms)) == 0;
+}
+
+void uhal_os_bus_notify_from_isr(const uint8_t bus) {
+    if (bus_initialized[bus]) {
+        k_sem_give(&bus_events[bus]);
+    }
+}
+
+#endif /* UHAL_OS_HOOKS */
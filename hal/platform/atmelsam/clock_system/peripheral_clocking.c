@@ -0,0 +1,504 @@
+/**
+* \file            peripheral_clocking.c
+* \brief           Source file of the clock system, which keeps track of the generator frequencies and peripheral clock routing
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+#include <sam.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "clock_system/peripheral_clocking.h"
+#include "irq/sercom_stuff.h"
+
+#define CLK_ROUTING_UNKNOWN        0xFF
+#define CLK_ROUTING_DISABLED       0xFE
+#define CLK_OSC8M_FREQ             8000000
+#define CLK_DFLL48M_FREQ           48000000
+#define CLK_32K_FREQ               32768
+#define CLK_DFLL48M_MAX_REF_FREQ   33000
+#define CLK_DFLL48M_COARSE_STEP    (0x1F / 4)
+#define CLK_DFLL48M_FINE_STEP      (0xFF / 4)
+
+/**
+ * @brief The amount of status register reads after which an oscillator is considered broken.
+ */
+#define CLK_READY_TIMEOUT_LOOPS    (65535 * 4)
+#define CLK_GEN1_DIV_BITS          16
+#define CLK_GEN_DIV_BITS           8
+#ifdef __SAMD51__
+#define CLK_GEN2_DIV_BITS          CLK_GEN_DIV_BITS
+#define CLK_OSC_STATUS_REG         (OSCCTRL->STATUS.reg)
+#define CLK_DFLL_READY             OSCCTRL_STATUS_DFLLRDY
+#define CLK_DFLL_LOCKED            (OSCCTRL_STATUS_DFLLLCKC | OSCCTRL_STATUS_DFLLLCKF)
+#else
+#define CLK_GEN2_DIV_BITS          5
+#define CLK_OSC_STATUS_REG         (SYSCTRL->PCLKSR.reg)
+#define CLK_DFLL_READY             SYSCTRL_PCLKSR_DFLLRDY
+#define CLK_DFLL_LOCKED            (SYSCTRL_PCLKSR_DFLLLCKC | SYSCTRL_PCLKSR_DFLLLCKF)
+#endif
+
+/**
+ * @brief The frequency of every clock source, the OSC8M entry is unused as its prescaler is read back.
+ */
+static uint32_t clk_source_freq[CLK_NUM_SOURCES] = {
+        [CLK_SOURCE_OSCULP32K] = CLK_32K_FREQ,
+#ifndef __SAMD51__
+        [CLK_SOURCE_OSC32K] = CLK_32K_FREQ,
+#endif
+        [CLK_SOURCE_XOSC32K] = CLK_32K_FREQ,
+        [CLK_SOURCE_DFLL48M] = CLK_DFLL48M_FREQ
+};
+
+/**
+ * @brief The cached generator frequencies, valid when the corresponding bit in clk_generator_freq_valid is set.
+ */
+static uint32_t clk_generator_freq[CLK_NUM_GENERATORS];
+static uint16_t clk_generator_freq_valid;
+
+#define CLK_ALL_GENERATORS         ((1 << CLK_NUM_GENERATORS) - 1)
+
+/**
+ * @brief The drivers which want to know when the frequency of a generator changes.
+ */
+static clk_freq_change_handler_t clk_freq_change_handlers[CLK_MAX_FREQ_CHANGE_HANDLERS];
+
+/**
+ * @brief The generator each peripheral channel is routed to, CLK_ROUTING_UNKNOWN until the channel is first written or read back.
+ */
+static uint8_t clk_channel_routing[CLK_NUM_PERIPHERAL_CHANNELS] = {
+        [0 ... CLK_NUM_PERIPHERAL_CHANNELS - 1] = CLK_ROUTING_UNKNOWN
+};
+
+#ifdef __SAMD51__
+static inline void clk_wait_for_sync(void) {
+    while (GCLK->SYNCBUSY.reg);
+}
+#else
+static inline void clk_wait_for_sync(void) {
+    while (GCLK->STATUS.bit.SYNCBUSY);
+}
+
+/**
+ * @brief Helper function which reads back the GENCTRL or GENDIV register of a generator,
+ *        by writing the ID to its first byte and reading the whole register afterwards.
+ */
+static inline uint32_t clk_read_indirect_register(volatile uint32_t *reg, const uint8_t id) {
+    *((volatile uint8_t *) reg) = id;
+    clk_wait_for_sync();
+    return *reg;
+}
+#endif
+
+/**
+ * @brief Helper function which reads back the frequency of a generator from its GENCTRL and GENDIV registers.
+ *        The SAMD51 has a GENCTRL register per generator, which holds the divider as well.
+ */
+static uint32_t clk_read_generator_freq(const clk_gen_num_t clk_gen) {
+#ifdef __SAMD51__
+    const uint32_t genctrl = GCLK->GENCTRL[clk_gen].reg;
+#else
+    const uint32_t genctrl = clk_read_indirect_register(&GCLK->GENCTRL.reg, clk_gen);
+#endif
+    if (!(genctrl & GCLK_GENCTRL_GENEN)) {
+        return 0;
+    }
+    const uint8_t source = (genctrl >> GCLK_GENCTRL_SRC_Pos) & 0x1F;
+    const uint32_t source_freq = (source == CLK_SOURCE_GCLKGEN1 && clk_gen == CLKGEN_1) ? 0 : clk_get_source_freq(source);
+#ifdef __SAMD51__
+    const uint32_t divider = (genctrl & GCLK_GENCTRL_DIV_Msk) >> GCLK_GENCTRL_DIV_Pos;
+#else
+    const uint32_t divider = clk_read_indirect_register(&GCLK->GENDIV.reg, clk_gen) >> 8;
+#endif
+    if (genctrl & GCLK_GENCTRL_DIVSEL) {
+        return source_freq >> (divider + 1);
+    }
+    return divider > 1 ? source_freq / divider : source_freq;
+}
+
+/**
+ * @brief Helper function which spins until the given PCLKSR (OSCCTRL STATUS on the SAMD51) flags are set.
+ */
+static inline uhal_status_t clk_wait_for_oscillator(const uint32_t pclksr_flags) {
+    uint32_t timeout = CLK_READY_TIMEOUT_LOOPS;
+    while ((CLK_OSC_STATUS_REG & pclksr_flags) != pclksr_flags) {
+        if (--timeout == 0) {
+            return UHAL_STATUS_PERIPHERAL_CLOCK_ERROR;
+        }
+    }
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Helper function which reads back the frequency of the cached generators in the mask,
+ *        and notifies the registered handlers of every generator of which the frequency changed.
+ *        All generators are invalidated before reading, as they can be fed from each other through generator 1.
+ */
+static void clk_refresh_generators(const uint16_t gen_mask) {
+    uint32_t old_freq[CLK_NUM_GENERATORS];
+    const uint16_t refresh_mask = clk_generator_freq_valid & gen_mask;
+    for (uint8_t gen = 0; gen < CLK_NUM_GENERATORS; gen++) {
+        old_freq[gen] = clk_generator_freq[gen];
+    }
+    clk_generator_freq_valid &= ~gen_mask;
+    for (uint8_t gen = 0; gen < CLK_NUM_GENERATORS; gen++) {
+        if (!(refresh_mask & (1 << gen))) {
+            continue;
+        }
+        const uint32_t new_freq = clk_get_generator_freq(gen);
+        if (new_freq == old_freq[gen]) {
+            continue;
+        }
+        for (uint8_t slot = 0; slot < CLK_MAX_FREQ_CHANGE_HANDLERS; slot++) {
+            if (clk_freq_change_handlers[slot] != NULL) {
+                clk_freq_change_handlers[slot](gen, new_freq);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Helper function which returns whether any SERCOM has a transaction in flight.
+ *        The drivers only recalculate their BAUD register between transactions, so a generator isn't changed under a running transfer.
+ */
+static bool clk_sercom_transaction_in_flight(void) {
+    for (uint8_t sercom_num = 0; sercom_num < 6; sercom_num++) {
+        if (sercom_transaction_in_flight(sercom_num)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Helper function which sets the flash wait states needed for the given CPU frequency.
+ *        The SAMD51 NVM controller does this by itself (CTRLA.AUTOWS is set at reset).
+ */
+static inline void clk_set_nvm_wait_states(const uint32_t cpu_freq) {
+#ifdef __SAMD51__
+    (void) cpu_freq;
+#else
+    const uint32_t wait_states = (cpu_freq > CLK_NVM_ZERO_WAIT_STATE_MAX_FREQ) ? 1 : 0;
+    NVMCTRL->CTRLB.reg = (NVMCTRL->CTRLB.reg & ~NVMCTRL_CTRLB_RWS_Msk) | NVMCTRL_CTRLB_RWS(wait_states);
+#endif
+}
+
+/**
+ * @brief Helper function which translates a divider to the GENDIV.DIV value, and whether GENCTRL.DIVSEL has to be set.
+ * @return false when the divider can't be set on the generator
+ */
+static bool clk_get_divider_fields(const clk_gen_num_t clk_gen, const uint32_t divider, uint32_t *div_val, bool *divsel) {
+    const uint8_t div_bits = (clk_gen == CLKGEN_1) ? CLK_GEN1_DIV_BITS
+                                                   : ((clk_gen == CLKGEN_2) ? CLK_GEN2_DIV_BITS : CLK_GEN_DIV_BITS);
+    if (divider < (1UL << div_bits)) {
+        *div_val = divider;
+        *divsel = false;
+        return true;
+    }
+    /* With DIVSEL the generator divides by 2^(DIV+1) */
+    const bool power_of_two = (divider & (divider - 1)) == 0;
+    uint32_t exponent = 0;
+    while ((1UL << (exponent + 1)) < divider) {
+        exponent++;
+    }
+    if (!power_of_two || exponent >= (1UL << div_bits)) {
+        return false;
+    }
+    *div_val = exponent;
+    *divsel = true;
+    return true;
+}
+
+uint32_t clk_get_source_freq(const clk_source_t source) {
+#ifndef __SAMD51__
+    if (source == CLK_SOURCE_OSC8M) {
+        const uint8_t prescaler = (SYSCTRL->OSC8M.reg & SYSCTRL_OSC8M_PRESC_Msk) >> SYSCTRL_OSC8M_PRESC_Pos;
+        return CLK_OSC8M_FREQ >> prescaler;
+    }
+#endif
+    if (source == CLK_SOURCE_GCLKGEN1) {
+        return clk_get_generator_freq(CLKGEN_1);
+    }
+    return (source < CLK_NUM_SOURCES) ? clk_source_freq[source] : 0;
+}
+
+uhal_status_t clk_configure_generator(const clk_gen_num_t clk_gen, const clk_source_t source, const uint32_t divider,
+                                      const clk_gen_opt_t gen_opt) {
+    uint32_t div_val;
+    bool divsel;
+    const bool invalid_source = (source >= CLK_NUM_SOURCES) || (source == CLK_SOURCE_GCLKGEN1 && clk_gen == CLKGEN_1);
+    if (clk_gen >= CLK_NUM_GENERATORS || invalid_source || !clk_get_divider_fields(clk_gen, divider, &div_val, &divsel)) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (clk_sercom_transaction_in_flight()) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+    const uint32_t source_freq = clk_get_source_freq(source);
+    const uint32_t new_freq = divsel ? (source_freq >> (div_val + 1)) : (div_val > 1 ? source_freq / div_val : source_freq);
+    const bool cpu_speeds_up = (clk_gen == CLKGEN_0) && (new_freq > clk_get_generator_freq(CLKGEN_0));
+    if (cpu_speeds_up) {
+        clk_set_nvm_wait_states(new_freq);
+    }
+    const uint32_t genctrl = GCLK_GENCTRL_SRC(source) | GCLK_GENCTRL_GENEN
+                             | (divsel ? GCLK_GENCTRL_DIVSEL : 0)
+                             | ((gen_opt & CLK_GEN_OPT_RUN_IN_STANDBY) ? GCLK_GENCTRL_RUNSTDBY : 0)
+                             | ((gen_opt & CLK_GEN_OPT_OUTPUT_ENABLE) ? GCLK_GENCTRL_OE : 0)
+                             | ((gen_opt & CLK_GEN_OPT_IMPROVE_DUTY_CYCLE) ? GCLK_GENCTRL_IDC : 0);
+#ifdef __SAMD51__
+    GCLK->GENCTRL[clk_gen].reg = genctrl | GCLK_GENCTRL_DIV(div_val);
+#else
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(clk_gen) | GCLK_GENDIV_DIV(div_val);
+    clk_wait_for_sync();
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(clk_gen) | genctrl;
+#endif
+    clk_wait_for_sync();
+    if (clk_gen == CLKGEN_0 && !cpu_speeds_up) {
+        clk_set_nvm_wait_states(new_freq);
+    }
+    clk_refresh_generators((clk_gen == CLKGEN_1) ? CLK_ALL_GENERATORS : (1 << clk_gen));
+    return UHAL_STATUS_OK;
+}
+
+#ifndef __SAMD51__
+uhal_status_t clk_configure_osc8m(const clk_osc8m_prescaler_t prescaler) {
+    if (prescaler > CLK_OSC8M_PRESCALER_DIV_8) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (clk_sercom_transaction_in_flight()) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+    SYSCTRL->OSC8M.reg = (SYSCTRL->OSC8M.reg & ~SYSCTRL_OSC8M_PRESC_Msk) | SYSCTRL_OSC8M_PRESC(prescaler) | SYSCTRL_OSC8M_ENABLE;
+    const uhal_status_t status = clk_wait_for_oscillator(SYSCTRL_PCLKSR_OSC8MRDY);
+    /* Every generator could be fed from the OSC8M, directly or through generator 1 */
+    clk_refresh_generators(CLK_ALL_GENERATORS);
+    return status;
+}
+#endif
+
+#ifdef __SAMD51__
+/**
+ * @brief Helper function which enables the DFLL in open-loop mode with ONDEMAND cleared,
+ *        so the other DFLL registers can be written.
+ */
+static inline uhal_status_t clk_prepare_dfll48m(void) {
+    OSCCTRL->DFLLCTRLB.reg = 0;
+    while (OSCCTRL->DFLLSYNC.reg & OSCCTRL_DFLLSYNC_DFLLCTRLB);
+    OSCCTRL->DFLLCTRLA.reg = OSCCTRL_DFLLCTRLA_ENABLE;
+    while (OSCCTRL->DFLLSYNC.reg & OSCCTRL_DFLLSYNC_ENABLE);
+    return clk_wait_for_oscillator(CLK_DFLL_READY);
+}
+#else
+/**
+ * @brief Helper function which enables the DFLL with ONDEMAND cleared,
+ *        writing the other DFLL registers while ONDEMAND is set can freeze the device (see the SAMD21 errata).
+ */
+static inline uhal_status_t clk_prepare_dfll48m(void) {
+    SYSCTRL->DFLLCTRL.reg = SYSCTRL_DFLLCTRL_ENABLE;
+    return clk_wait_for_oscillator(CLK_DFLL_READY);
+}
+#endif
+
+uhal_status_t clk_enable_dfll48m_open_loop(void) {
+    uhal_status_t status = clk_prepare_dfll48m();
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+#ifndef __SAMD51__
+    const uint32_t coarse = (*((const uint32_t *) FUSES_DFLL48M_COARSE_CAL_ADDR) & FUSES_DFLL48M_COARSE_CAL_Msk)
+                            >> FUSES_DFLL48M_COARSE_CAL_Pos;
+    SYSCTRL->DFLLVAL.reg = SYSCTRL_DFLLVAL_COARSE(coarse) | SYSCTRL_DFLLVAL_FINE(0x200);
+    status = clk_wait_for_oscillator(CLK_DFLL_READY);
+#endif
+    clk_source_freq[CLK_SOURCE_DFLL48M] = CLK_DFLL48M_FREQ;
+    clk_refresh_generators(CLK_ALL_GENERATORS);
+    return status;
+}
+
+uhal_status_t clk_enable_dfll48m_closed_loop(const clk_gen_num_t reference_gen) {
+    const uint32_t reference_freq = clk_get_generator_freq(reference_gen);
+    if (reference_freq == 0 || reference_freq > CLK_DFLL48M_MAX_REF_FREQ) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    uhal_status_t status = clk_route_generator(CLK_CHANNEL_DFLL48M, reference_gen);
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+    status = clk_prepare_dfll48m();
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+    const uint32_t multiplier = (CLK_DFLL48M_FREQ + reference_freq / 2) / reference_freq;
+#ifdef __SAMD51__
+    OSCCTRL->DFLLMUL.reg = OSCCTRL_DFLLMUL_CSTEP(CLK_DFLL48M_COARSE_STEP) | OSCCTRL_DFLLMUL_FSTEP(CLK_DFLL48M_FINE_STEP)
+                           | OSCCTRL_DFLLMUL_MUL(multiplier);
+    while (OSCCTRL->DFLLSYNC.reg & OSCCTRL_DFLLSYNC_DFLLMUL);
+    OSCCTRL->DFLLCTRLB.reg = OSCCTRL_DFLLCTRLB_MODE | OSCCTRL_DFLLCTRLB_WAITLOCK;
+    while (OSCCTRL->DFLLSYNC.reg & OSCCTRL_DFLLSYNC_DFLLCTRLB);
+#else
+    SYSCTRL->DFLLMUL.reg = SYSCTRL_DFLLMUL_CSTEP(CLK_DFLL48M_COARSE_STEP) | SYSCTRL_DFLLMUL_FSTEP(CLK_DFLL48M_FINE_STEP)
+                           | SYSCTRL_DFLLMUL_MUL(multiplier);
+    status = clk_wait_for_oscillator(CLK_DFLL_READY);
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+    SYSCTRL->DFLLCTRL.reg = SYSCTRL_DFLLCTRL_ENABLE | SYSCTRL_DFLLCTRL_MODE | SYSCTRL_DFLLCTRL_WAITLOCK;
+#endif
+    status = clk_wait_for_oscillator(CLK_DFLL_READY | CLK_DFLL_LOCKED);
+    clk_source_freq[CLK_SOURCE_DFLL48M] = multiplier * reference_freq;
+    clk_refresh_generators(CLK_ALL_GENERATORS);
+    return status;
+}
+
+uhal_status_t clk_set_source_freq(const clk_source_t source, const uint32_t freq) {
+    if (source >= CLK_NUM_SOURCES) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    clk_source_freq[source] = freq;
+    /* Any generator could be fed from this source */
+    clk_refresh_generators(CLK_ALL_GENERATORS);
+    return UHAL_STATUS_OK;
+}
+
+uint32_t clk_get_generator_freq(const clk_gen_num_t clk_gen) {
+    if (clk_gen >= CLK_NUM_GENERATORS) {
+        return 0;
+    }
+    if (!(clk_generator_freq_valid & (1 << clk_gen))) {
+        clk_generator_freq[clk_gen] = clk_read_generator_freq(clk_gen);
+        clk_generator_freq_valid |= (1 << clk_gen);
+    }
+    return clk_generator_freq[clk_gen];
+}
+
+void clk_invalidate_generator(const clk_gen_num_t clk_gen) {
+    /* Generator 1 can feed the other generators, so those have to be read back again as well */
+    clk_generator_freq_valid &= (clk_gen == CLKGEN_1) ? 0 : ~(1 << clk_gen);
+}
+
+uhal_status_t clk_route_generator(const uint8_t channel_id, const clk_gen_num_t clk_gen) {
+    if (channel_id >= CLK_NUM_PERIPHERAL_CHANNELS || clk_gen >= CLK_NUM_GENERATORS) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (clk_channel_routing[channel_id] == clk_gen) {
+        return UHAL_STATUS_OK;
+    }
+#ifdef __SAMD51__
+    /* The generator of a channel may only be changed while the channel is disabled */
+    GCLK->PCHCTRL[channel_id].reg = 0;
+    while (GCLK->PCHCTRL[channel_id].reg & GCLK_PCHCTRL_CHEN);
+    GCLK->PCHCTRL[channel_id].reg = GCLK_PCHCTRL_GEN(clk_gen) | GCLK_PCHCTRL_CHEN;
+    while (!(GCLK->PCHCTRL[channel_id].reg & GCLK_PCHCTRL_CHEN));
+#else
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen) | GCLK_CLKCTRL_ID(channel_id) | GCLK_CLKCTRL_CLKEN;
+    clk_wait_for_sync();
+#endif
+    clk_channel_routing[channel_id] = clk_gen;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t clk_enable_sercom_clocks(const uint8_t sercom_num, const clk_gen_num_t clk_gen_fast,
+                                       const clk_gen_num_t clk_gen_slow) {
+    if (sercom_num > 5) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+#ifdef __SAMD51__
+    /* The SERCOMs are spread over the APBA (0 and 1), APBB (2 and 3) and APBD (4 and up) bridges */
+    if (sercom_num < 2) {
+        MCLK->APBAMASK.reg |= 1 << (MCLK_APBAMASK_SERCOM0_Pos + sercom_num);
+    } else if (sercom_num < 4) {
+        MCLK->APBBMASK.reg |= 1 << (MCLK_APBBMASK_SERCOM2_Pos + sercom_num - 2);
+    } else {
+        MCLK->APBDMASK.reg |= 1 << (MCLK_APBDMASK_SERCOM4_Pos + sercom_num - 4);
+    }
+#else
+    PM->APBCMASK.reg |= 1 << (PM_APBCMASK_SERCOM0_Pos + sercom_num);
+#endif
+    const uhal_status_t slow_status = clk_route_generator(CLK_CHANNEL_SERCOMX_SLOW, clk_gen_slow);
+    if (slow_status != UHAL_STATUS_OK) {
+        return slow_status;
+    }
+    return clk_route_generator(CLK_CHANNEL_SERCOM_CORE(sercom_num), clk_gen_fast);
+}
+
+uint32_t clk_get_peripheral_freq(const uint8_t channel_id) {
+    if (channel_id >= CLK_NUM_PERIPHERAL_CHANNELS) {
+        return 0;
+    }
+    if (clk_channel_routing[channel_id] == CLK_ROUTING_UNKNOWN) {
+        /* Routed before the clock system was used (e.g. by the startup code), read it back once */
+#ifdef __SAMD51__
+        const uint32_t pchctrl = GCLK->PCHCTRL[channel_id].reg;
+        const bool enabled = (pchctrl & GCLK_PCHCTRL_CHEN) != 0;
+        clk_channel_routing[channel_id] = enabled ? ((pchctrl >> GCLK_PCHCTRL_GEN_Pos) & 0xF) : CLK_ROUTING_DISABLED;
+#else
+        *((volatile uint8_t *) &GCLK->CLKCTRL.reg) = channel_id;
+        clk_wait_for_sync();
+        const uint16_t clkctrl = GCLK->CLKCTRL.reg;
+        const bool enabled = (clkctrl & GCLK_CLKCTRL_CLKEN) != 0;
+        clk_channel_routing[channel_id] = enabled ? ((clkctrl >> GCLK_CLKCTRL_GEN_Pos) & 0xF) : CLK_ROUTING_DISABLED;
+#endif
+    }
+    if (clk_channel_routing[channel_id] == CLK_ROUTING_DISABLED) {
+        return 0;
+    }
+    return clk_get_generator_freq(clk_channel_routing[channel_id]);
+}
+
+uhal_status_t clk_register_freq_change_handler(const clk_freq_change_handler_t handler) {
+    clk_freq_change_handler_t *free_slot = NULL;
+    for (uint8_t slot = 0; slot < CLK_MAX_FREQ_CHANGE_HANDLERS; slot++) {
+        if (clk_freq_change_handlers[slot] == handler) {
+            return UHAL_STATUS_OK;
+        }
+        if (clk_freq_change_handlers[slot] == NULL && free_slot == NULL) {
+            free_slot = &clk_freq_change_handlers[slot];
+        }
+    }
+    if (handler == NULL || free_slot == NULL) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    *free_slot = handler;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t clk_set_performance_mode(const clk_perf_mode_t perf_mode) {
+    if (clk_sercom_transaction_in_flight()) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+    if (perf_mode == CLK_PERF_MODE_HIGH_PERFORMANCE) {
+#ifdef __SAMD51__
+        const bool dfll_running = (OSCCTRL->DFLLCTRLA.reg & OSCCTRL_DFLLCTRLA_ENABLE) != 0;
+#else
+        const bool dfll_running = (SYSCTRL->DFLLCTRL.reg & SYSCTRL_DFLLCTRL_ENABLE) != 0;
+#endif
+        if (CLK_PERF_HIGH_PERFORMANCE_SOURCE == CLK_SOURCE_DFLL48M && !dfll_running) {
+            const uhal_status_t status = clk_enable_dfll48m_open_loop();
+            if (status != UHAL_STATUS_OK) {
+                return status;
+            }
+        }
+        return clk_configure_generator(CLKGEN_0, CLK_PERF_HIGH_PERFORMANCE_SOURCE, CLK_PERF_HIGH_PERFORMANCE_DIVIDER,
+                                       CLK_GEN_OPT_IMPROVE_DUTY_CYCLE);
+    }
+    if (perf_mode == CLK_PERF_MODE_LOW_POWER) {
+        return clk_configure_generator(CLKGEN_0, CLK_PERF_LOW_POWER_SOURCE, CLK_PERF_LOW_POWER_DIVIDER,
+                                       CLK_GEN_OPT_IMPROVE_DUTY_CYCLE);
+    }
+    return UHAL_STATUS_INVALID_PARAMETERS;
+}
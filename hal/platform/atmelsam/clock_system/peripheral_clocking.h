@@ -24,9 +24,255 @@
 
 #ifndef ATMELSAMD21_PERIPHERAL_CLOCKING_H
 #define ATMELSAMD21_PERIPHERAL_CLOCKING_H
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
 
+#include <stdint.h>
+#include "error_handling.h"
+
+#ifdef __SAMD51__
+typedef enum {
+    CLKGEN_0, CLKGEN_1, CLKGEN_2, CLKGEN_3, CLKGEN_4, CLKGEN_5, CLKGEN_6, CLKGEN_7, CLKGEN_8, CLKGEN_9, CLKGEN_10, CLKGEN_11
+} clk_gen_num_t;
+
+/**
+ * @brief The clock sources a generator can be fed from, the values match the GENCTRL.SRC field.
+ */
+typedef enum {
+    CLK_SOURCE_XOSC0 = 0,
+    CLK_SOURCE_XOSC1 = 1,
+    CLK_SOURCE_GCLKIN = 2,
+    CLK_SOURCE_GCLKGEN1 = 3,
+    CLK_SOURCE_OSCULP32K = 4,
+    CLK_SOURCE_XOSC32K = 5,
+    CLK_SOURCE_DFLL48M = 6,
+    CLK_SOURCE_FDPLL0 = 7,
+    CLK_SOURCE_FDPLL1 = 8
+} clk_source_t;
+#else
 typedef enum {
     CLKGEN_0, CLKGEN_1, CLKGEN_2, CLKGEN_3, CLKGEN_4, CLKGEN_5, CLKGEN_6, CLKGEN_7, CLKGEN_8
 } clk_gen_num_t;
 
+/**
+ * @brief The clock sources a generator can be fed from, the values match the GENCTRL.SRC field.
+ */
+typedef enum {
+    CLK_SOURCE_XOSC = 0,
+    CLK_SOURCE_GCLKIN = 1,
+    CLK_SOURCE_GCLKGEN1 = 2,
+    CLK_SOURCE_OSCULP32K = 3,
+    CLK_SOURCE_OSC32K = 4,
+    CLK_SOURCE_XOSC32K = 5,
+    CLK_SOURCE_OSC8M = 6,
+    CLK_SOURCE_DFLL48M = 7,
+    CLK_SOURCE_FDPLL96M = 8
+} clk_source_t;
+#endif
+
+/**
+ * @brief Extra generator options, which can be OR-ed together.
+ */
+typedef enum {
+    CLK_GEN_OPT_NONE = 0,
+    CLK_GEN_OPT_RUN_IN_STANDBY = 0x01,
+    CLK_GEN_OPT_OUTPUT_ENABLE = 0x02,
+    CLK_GEN_OPT_IMPROVE_DUTY_CYCLE = 0x04
+} clk_gen_opt_t;
+
+typedef enum {
+    CLK_OSC8M_PRESCALER_DIV_1,
+    CLK_OSC8M_PRESCALER_DIV_2,
+    CLK_OSC8M_PRESCALER_DIV_4,
+    CLK_OSC8M_PRESCALER_DIV_8
+} clk_osc8m_prescaler_t;
+
+typedef enum {
+    CLK_PERF_MODE_LOW_POWER,
+    CLK_PERF_MODE_HIGH_PERFORMANCE
+} clk_perf_mode_t;
+
+/**
+ * @brief Called after the frequency of a generator changed, with the new frequency (0 when it is unknown).
+ *        Drivers use it to recalculate their BAUD register at the next transaction boundary.
+ */
+typedef void (*clk_freq_change_handler_t)(const clk_gen_num_t clk_gen, const uint32_t new_freq);
+
+#ifdef __SAMD51__
+#define CLK_NUM_GENERATORS             12
+#else
+#define CLK_NUM_GENERATORS             9
+#endif
+#define CLK_NUM_SOURCES                9
+
+/**
+ * @brief Highest CPU (generator 0) frequency at which the flash is read without wait states, at 3.3V.
+ *        Only used on the SAMD21, the SAMD51 NVM controller sets its wait states automatically.
+ */
+#define CLK_NVM_ZERO_WAIT_STATE_MAX_FREQ 24000000
+
+/**
+ * @brief The amount of drivers which can register a frequency change handler.
+ */
+#ifndef CLK_MAX_FREQ_CHANGE_HANDLERS
+#define CLK_MAX_FREQ_CHANGE_HANDLERS   4
+#endif
+
+/**
+ * @brief Generator 0 settings of the performance modes, these can be overridden by defining them before this file is included.
+ *        The low power mode runs at 8 MHz (on the SAMD21 when the OSC8M prescaler is 1).
+ *        Boards which configured the FDPLL0 of the SAMD51 can use it as high performance source instead.
+ */
+#ifndef CLK_PERF_LOW_POWER_SOURCE
+#ifdef __SAMD51__
+#define CLK_PERF_LOW_POWER_SOURCE            CLK_SOURCE_DFLL48M
+#define CLK_PERF_LOW_POWER_DIVIDER           6
+#else
+#define CLK_PERF_LOW_POWER_SOURCE            CLK_SOURCE_OSC8M
+#define CLK_PERF_LOW_POWER_DIVIDER           1
+#endif
+#endif
+#ifndef CLK_PERF_HIGH_PERFORMANCE_SOURCE
+#define CLK_PERF_HIGH_PERFORMANCE_SOURCE     CLK_SOURCE_DFLL48M
+#define CLK_PERF_HIGH_PERFORMANCE_DIVIDER    1
+#endif
+
+#ifdef __SAMD51__
+/**
+ * @brief The peripheral channels of the PCHCTRL registers. The SERCOM core channels aren't contiguous on the SAMD51.
+ */
+#define CLK_NUM_PERIPHERAL_CHANNELS    48
+#define CLK_CHANNEL_DFLL48M            0
+#define CLK_CHANNEL_EIC                4
+#define CLK_CHANNEL_SERCOMX_SLOW       3
+#define CLK_CHANNEL_SERCOM_CORE(n)     ((n) < 2 ? (7 + (n)) : ((n) < 4 ? (21 + (n)) : (30 + (n))))
+#else
+/**
+ * @brief The peripheral channels of the CLKCTRL register (GCLK_DFLL48M up to GCLK_I2S_1).
+ */
+#define CLK_NUM_PERIPHERAL_CHANNELS    0x25
+#define CLK_CHANNEL_DFLL48M            0x00
+#define CLK_CHANNEL_EIC                0x05
+#define CLK_CHANNEL_SERCOMX_SLOW       0x13
+#define CLK_CHANNEL_SERCOM_CORE(n)     (0x14 + (n))
+#endif
+
+/**
+ * @brief Sets the frequency of a clock source which can't be read back from the hardware,
+ *        like the external crystals (XOSC), the GCLK_IO input or the FDPLLs.
+ *        The internal 32KHz oscillators default to 32768 Hz and the DFLL48M to 48 MHz, the OSC8M is always read back.
+ * @param source The clock source of which the frequency is set
+ * @param freq The frequency of the source in Hz
+ * @return UHAL_STATUS_INVALID_PARAMETERS when the source doesn't exist, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_set_source_freq(const clk_source_t source, const uint32_t freq);
+
+/**
+ * @brief Gets the frequency of a clock source as known to the clock system.
+ * @param source The clock source of which the frequency is read
+ * @return The frequency in Hz, 0 when it is unknown
+ */
+uint32_t clk_get_source_freq(const clk_source_t source);
+
+/**
+ * @brief Configures and enables a generator. The divider field of generator 1 is 16 bits wide, of generator 2 5 bits and
+ *        8 bits for the others (8 bits for generator 2 as well on the SAMD51). Larger dividers are possible when they are a power of two.
+ *        The flash wait states are raised before generator 0 is sped up above CLK_NVM_ZERO_WAIT_STATE_MAX_FREQ,
+ *        and lowered again after it is slowed down.
+ * @param clk_gen The generator to configure
+ * @param source The clock source the generator is fed from, the source has to be running
+ * @param divider The division factor, 0 and 1 both mean undivided
+ * @param gen_opt Extra generator options
+ * @return UHAL_STATUS_INVALID_PARAMETERS when the divider can't be set on the generator,
+ *         UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when a SERCOM has a transaction in flight, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_configure_generator(const clk_gen_num_t clk_gen, const clk_source_t source, const uint32_t divider,
+                                      const clk_gen_opt_t gen_opt);
+
+#ifndef __SAMD51__
+/**
+ * @brief Sets the prescaler of the internal 8MHz oscillator, the generators fed from it change frequency straight away.
+ * @return UHAL_STATUS_PERIPHERAL_CLOCK_ERROR when the oscillator didn't become ready,
+ *         UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when a SERCOM has a transaction in flight, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_configure_osc8m(const clk_osc8m_prescaler_t prescaler);
+#endif
+
+/**
+ * @brief Enables the DFLL48M in open-loop mode, using the coarse calibration value from the NVM software calibration area
+ *        (the SAMD51 loads its calibration at reset). The frequency is then 48 MHz within the accuracy of the calibration.
+ * @return UHAL_STATUS_PERIPHERAL_CLOCK_ERROR when the DFLL didn't become ready, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_enable_dfll48m_open_loop(void);
+
+/**
+ * @brief Enables the DFLL48M in closed-loop mode, locked onto a reference generator (usually the 32.768KHz crystal).
+ *        The multiplication factor is chosen to get as close to 48 MHz as possible.
+ * @param reference_gen The generator used as reference, its frequency has to be known to the clock system
+ * @return UHAL_STATUS_INVALID_PARAMETERS when the reference frequency is unknown or too high,
+ *         UHAL_STATUS_PERIPHERAL_CLOCK_ERROR when the DFLL didn't lock, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_enable_dfll48m_closed_loop(const clk_gen_num_t reference_gen);
+
+/**
+ * @brief Gets the output frequency of a generator. The source and divider are read back from the hardware once,
+ *        after which the result is cached until the generator is invalidated.
+ * @param clk_gen The generator of which the frequency is read
+ * @return The frequency in Hz, 0 when the generator is disabled or its source frequency is unknown
+ */
+uint32_t clk_get_generator_freq(const clk_gen_num_t clk_gen);
+
+/**
+ * @brief Drops the cached frequency of a generator, call this after changing the generator configuration outside the clock system.
+ */
+void clk_invalidate_generator(const clk_gen_num_t clk_gen);
+
+/**
+ * @brief Routes a generator to a peripheral channel. The routing is cached, the register write
+ *        (and the wait for synchronisation) is skipped when the channel is already routed to the generator.
+ * @param channel_id The CLKCTRL ID (PCHCTRL index on the SAMD51) of the peripheral channel
+ * @param clk_gen The generator to route to the channel
+ * @return UHAL_STATUS_INVALID_PARAMETERS when the channel or generator doesn't exist, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_route_generator(const uint8_t channel_id, const clk_gen_num_t clk_gen);
+
+/**
+ * @brief Enables the bus clock (PM on the SAMD21, MCLK on the SAMD51) of a SERCOM and routes the generators to its core and the shared slow channel.
+ * @param sercom_num The SERCOM instance (0 to 5)
+ * @param clk_gen_fast The generator used for the core clock of the SERCOM
+ * @param clk_gen_slow The generator used for the SERCOMx slow clock, which is shared by all SERCOMs
+ * @return UHAL_STATUS_INVALID_PARAMETERS when one of the parameters is out of range, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_enable_sercom_clocks(const uint8_t sercom_num, const clk_gen_num_t clk_gen_fast,
+                                       const clk_gen_num_t clk_gen_slow);
+
+/**
+ * @brief Gets the frequency a peripheral channel is actually clocked at.
+ * @param channel_id The CLKCTRL ID (PCHCTRL index on the SAMD51) of the peripheral channel
+ * @return The frequency in Hz, 0 when the channel is disabled or the frequency of its generator is unknown
+ */
+uint32_t clk_get_peripheral_freq(const uint8_t channel_id);
+
+/**
+ * @brief Registers a handler which is called every time the frequency of a generator changes through the clock system.
+ *        Registering the same handler twice has no effect.
+ * @return UHAL_STATUS_INVALID_PARAMETERS when no handler is given or all slots are in use, otherwise UHAL_STATUS_OK
+ */
+uhal_status_t clk_register_freq_change_handler(const clk_freq_change_handler_t handler);
+
+/**
+ * @brief Switches the CPU (generator 0) between the low power and high performance clock.
+ *        The DFLL48M is enabled in open-loop mode when it isn't running yet. The flash wait states are adjusted and the
+ *        drivers clocked from generator 0 recalculate their BAUD register before their next transaction.
+ * @return UHAL_STATUS_OK when the switch succeeded, UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when a SERCOM has a transaction
+ *         in flight (nothing is changed then, try again after the transaction)
+ */
+uhal_status_t clk_set_performance_mode(const clk_perf_mode_t perf_mode);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
 #endif //ATMELSAMD21_PERIPHERAL_CLOCKING_H
@@ -34,6 +34,22 @@
 
 #define DEFAULT_IRQ_PRIORITY 2
 
+/*
+ * The SAMD21 DMAC has one set of channel registers which is pointed to a channel through CHID,
+ * the SAMD51 DMAC has a set per channel and keeps the trigger settings in CHCTRLA instead of CHCTRLB.
+ */
+#ifdef __SAMD51__
+#define DMA_SELECT_CHANNEL(dma_channel)   ((void) 0)
+#define DMA_CH(dma_channel)               (DMAC->Channel[dma_channel])
+#define DMA_TRIGACT_REG(dma_channel)      (DMAC->Channel[dma_channel].CHCTRLA.reg)
+#define DMA_TRIGACT(trigger)              DMAC_CHCTRLA_TRIGACT(trigger)
+#else
+#define DMA_SELECT_CHANNEL(dma_channel)   (DMAC->CHID.reg = DMAC_CHID_ID(dma_channel))
+#define DMA_CH(dma_channel)               (*DMAC)
+#define DMA_TRIGACT_REG(dma_channel)      (DMAC->CHCTRLB.reg)
+#define DMA_TRIGACT(trigger)              DMAC_CHCTRLB_TRIGACT(trigger)
+#endif
+
 
 volatile void *peripheral_loc[6] = {&(SERCOM0->I2CM.DATA),
                                     &(SERCOM1->I2CM.DATA),
@@ -50,15 +66,26 @@ struct dmac_descriptor {
     uint32_t descaddr;
 };
 
-// 12 channels
-volatile struct dmac_descriptor wrb[12] __attribute__ ((aligned (16)));
-struct dmac_descriptor descriptor_section[12] __attribute__ ((aligned (16)));
+volatile struct dmac_descriptor wrb[DMA_NUM_CHANNELS] __attribute__ ((aligned (16)));
+struct dmac_descriptor descriptor_section[DMA_NUM_CHANNELS] __attribute__ ((aligned (16)));
+
+/**
+ * @brief Per channel callbacks, called by the default DMA IRQ handler when a transfer completes or fails.
+ */
+volatile dma_transfer_done_cb_t dma_transfer_done_callbacks[DMA_NUM_CHANNELS];
 
 static inline uint8_t get_step_size(dma_opt_t dma_options) {
     uint16_t step_size = (BITMASK_COMPARE(dma_options, DMA_OPT_STEP_SIZE_128)) >> 6;
     return step_size;
 }
 
+/**
+ * @brief Helper function which returns the CHCTRLA.RUNSTDBY bit for the options, the channel then keeps moving data in standby.
+ */
+static inline uint32_t get_run_in_standby(const dma_opt_t dma_options) {
+    return BITMASK_COMPARE(dma_options, DMA_OPT_RUN_IN_STANDBY) ? DMAC_CHCTRLA_RUNSTDBY : 0;
+}
+
 static inline uint32_t calculate_addr(const void* addr, const uint8_t beat_size, const size_t size, const uint8_t step_size) {
     uint32_t res;
     if(step_size) {
@@ -69,6 +96,24 @@ static inline uint32_t calculate_addr(const void* addr, const uint8_t beat_size,
     return res;
 }
 
+/**
+ * @brief Helper function which resets the selected channel and lets it move one beat per request of the peripheral trigger.
+ */
+static inline void reset_channel_with_trigger(const dma_channel_t dma_channel, const uint8_t trigger_source) {
+    DMA_CH(dma_channel).CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    DMA_CH(dma_channel).CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    while (DMA_CH(dma_channel).CHCTRLA.reg & DMAC_CHCTRLA_SWRST);
+#ifdef __SAMD51__
+    DMA_CH(dma_channel).CHPRILVL.reg = 0;
+    DMA_CH(dma_channel).CHCTRLA.reg = DMAC_CHCTRLA_TRIGSRC(trigger_source) | DMAC_CHCTRLA_TRIGACT_BURST
+                                      | DMAC_CHCTRLA_BURSTLEN_SINGLE;
+#else
+    DMAC->CHCTRLB.reg =  DMAC_CHCTRLB_LVL(0) |
+                         DMAC_CHCTRLB_TRIGSRC(trigger_source) | DMAC_CHCTRLB_TRIGACT_BEAT;
+#endif
+    DMA_CH(dma_channel).CHINTENSET.reg = DMAC_CHINTENSET_MASK ; // enable all 3 interrupts
+}
+
 static inline uint8_t get_irq_priority(dma_init_opt_t dma_init_opt) {
     uint8_t res = BITMASK_COMPARE(dma_init_opt, 0x70) >> 4;
     return res ? res-1 : DEFAULT_IRQ_PRIORITY;
@@ -77,16 +122,20 @@ static inline uint8_t get_irq_priority(dma_init_opt_t dma_init_opt) {
 uhal_status_t dma_init(dma_peripheral_t dma_peripheral,
                        dma_init_opt_t dma_init_options) {
 
+#ifdef __SAMD51__
+    MCLK->AHBMASK.reg |= MCLK_AHBMASK_DMAC;
+#else
     PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
     PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
     while (GCLK->STATUS.bit.SYNCBUSY);
+#endif
 
     DMAC->BASEADDR.reg = (uint32_t)descriptor_section;
     DMAC->WRBADDR.reg = (uint32_t)wrb;
     const uint8_t lvlen = (dma_init_options != DMA_INIT_OPT_USE_DEFAULT) ? dma_init_options : 0xf;
     DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(lvlen);
     const uint8_t irq_prio = get_irq_priority(dma_init_options);
-    enable_irq_handler(DMAC_IRQn, irq_prio);
+    enable_irq_handlers(DMAC_FIRST_IRQn, DMAC_IRQ_LINES, irq_prio);
     return UHAL_STATUS_OK;
 }
 
@@ -99,7 +148,7 @@ uhal_status_t dma_set_transfer_mem(const dma_peripheral_t peripheral,
                                    const uint8_t do_software_trigger) {
 
     struct dmac_descriptor descriptor __attribute__ ((aligned (16)));
-    DMAC->CHID.reg = DMAC_CHID_ID(dma_channel);
+    DMA_SELECT_CHANNEL(dma_channel);
     descriptor.descaddr = 0;
 
     const uint8_t beat_size_opt = BITMASK_COMPARE(dma_options, DMA_OPT_BEAT_SIZE_32_BITS);
@@ -129,9 +178,10 @@ uhal_status_t dma_set_transfer_mem(const dma_peripheral_t peripheral,
     const uint32_t event_output = SHIFT_EVENT_OUTPUT_TO_BTCTRL_POS(dma_options);
     descriptor.btctrl = DMAC_BTCTRL_BEATSIZE(beat_size-1) |src_incr_en | dst_incr_en | DMAC_BTCTRL_VALID | DMAC_BTCTRL_STEPSIZE(step_size) | src_step_size_en | block_act | event_output;
     memcpy(&descriptor_section[dma_channel],&descriptor, sizeof(struct dmac_descriptor));
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    DMA_CH(dma_channel).CHCTRLA.reg = (DMA_CH(dma_channel).CHCTRLA.reg & ~DMAC_CHCTRLA_RUNSTDBY)
+                                      | get_run_in_standby(dma_options) | DMAC_CHCTRLA_ENABLE;
 
-    DMAC->CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
+    DMA_CH(dma_channel).CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_TRANSFER_COMPLETE_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_ERROR_IRQ_TO_CHINTENSET_POS(dma_options);
 
@@ -147,16 +197,16 @@ uhal_status_t dma_set_trigger(const dma_peripheral_t dma_peripheral,
                               const dma_channel_t dma_channel,
                               const dma_trigger_t trigger) {
 
-    DMAC->CHID.reg = DMAC_CHID_ID(dma_channel);
-    DMAC->CHCTRLB.reg |= (DMAC_CHCTRLB_TRIGACT(trigger));
+    DMA_SELECT_CHANNEL(dma_channel);
+    DMA_TRIGACT_REG(dma_channel) |= DMA_TRIGACT(trigger);
     return UHAL_STATUS_OK;
 }
 
 uhal_status_t dma_reset_trigger(const dma_peripheral_t dma_peripheral,
                                 const dma_channel_t dma_channel,
                                 const dma_trigger_t trigger) {
-    DMAC->CHID.reg = DMAC_CHID_ID(dma_channel);
-    DMAC->CHCTRLB.reg &= ~(DMAC_CHCTRLB_TRIGACT(trigger));
+    DMA_SELECT_CHANNEL(dma_channel);
+    DMA_TRIGACT_REG(dma_channel) &= ~DMA_TRIGACT(trigger);
     return UHAL_STATUS_OK;
 }
 
@@ -167,21 +217,19 @@ uhal_status_t dma_set_transfer_peripheral_to_mem(const dma_peripheral_t dma_peri
                                                  const size_t size,
                                                  const dma_opt_t dma_options) {
     struct dmac_descriptor descriptor __attribute__ ((aligned (16)));
-    DMAC->CHID.reg = DMAC_CHID_ID(dma_channel);
-    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
-    DMAC->CHCTRLB.reg =  DMAC_CHCTRLB_LVL(0) |
-                         DMAC_CHCTRLB_TRIGSRC((SERCOM0_DMAC_ID_TX + (src*2))) | DMAC_CHCTRLB_TRIGACT_BEAT;
-    DMAC->CHINTENSET.reg = DMAC_CHINTENSET_MASK ; // enable all 3 interrupts
+    DMA_SELECT_CHANNEL(dma_channel);
+    reset_channel_with_trigger(dma_channel, SERCOM0_DMAC_ID_RX + (src*2));
     descriptor.srcaddr = (uint32_t) peripheral_loc[src]; // The data register of any SERCOM is just one byte
-    descriptor.dstaddr = (uint32_t) dst;
+    /* The DMAC expects the end address of an incrementing buffer */
+    descriptor.dstaddr = (uint32_t) dst + size;
+    descriptor.descaddr = 0;
     descriptor.btcnt = size;
-    descriptor.btctrl = DMAC_BTCTRL_VALID;
+    descriptor.btctrl = DMAC_BTCTRL_VALID | DMAC_BTCTRL_DSTINC;
     DMAC->SWTRIGCTRL.reg &= (uint32_t)(~(1 << dma_channel));
     memcpy(&descriptor_section[dma_channel],&descriptor, sizeof(struct dmac_descriptor));
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    DMA_CH(dma_channel).CHCTRLA.reg |= get_run_in_standby(dma_options) | DMAC_CHCTRLA_ENABLE;
 
-    DMAC->CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
+    DMA_CH(dma_channel).CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_TRANSFER_COMPLETE_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_ERROR_IRQ_TO_CHINTENSET_POS(dma_options);
     return UHAL_STATUS_OK;
@@ -191,33 +239,53 @@ uhal_status_t dma_set_transfer_mem_to_peripheral(const dma_peripheral_t dma_peri
                                                  const void *src, const dma_peripheral_location_t dst,
                                                  const size_t size, const dma_opt_t dma_options) {
     struct dmac_descriptor descriptor __attribute__ ((aligned (16)));
-    DMAC->CHID.reg = DMAC_CHID_ID(dma_channel);;
-    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
-    DMAC->CHCTRLB.reg =  DMAC_CHCTRLB_LVL(0) |
-                         DMAC_CHCTRLB_TRIGSRC((SERCOM0_DMAC_ID_RX + (2 *dst))) | DMAC_CHCTRLB_TRIGACT_BEAT;
-    DMAC->CHINTENSET.reg = DMAC_CHINTENSET_MASK ; // enable all 3 interrupts
+    DMA_SELECT_CHANNEL(dma_channel);
+    reset_channel_with_trigger(dma_channel, SERCOM0_DMAC_ID_TX + (2 *dst));
     descriptor.dstaddr = (uint32_t) peripheral_loc[dst]; // The data register of any SERCOM is just one byte
-    descriptor.srcaddr = (uint32_t) src;
+    /* The DMAC expects the end address of an incrementing buffer */
+    descriptor.srcaddr = (uint32_t) src + size;
+    descriptor.descaddr = 0;
     descriptor.btcnt = size;
-    descriptor.btctrl = DMAC_BTCTRL_VALID;
+    descriptor.btctrl = DMAC_BTCTRL_VALID | DMAC_BTCTRL_SRCINC;
     DMAC->SWTRIGCTRL.reg &= (uint32_t)(~(1 << dma_channel));
     memcpy(&descriptor_section[dma_channel],&descriptor, sizeof(struct dmac_descriptor));
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    DMA_CH(dma_channel).CHCTRLA.reg |= get_run_in_standby(dma_options) | DMAC_CHCTRLA_ENABLE;
 
-    DMAC->CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
+    DMA_CH(dma_channel).CHINTENSET.reg |= SHIFT_SUSPEND_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_TRANSFER_COMPLETE_IRQ_TO_CHINTENSET_POS(dma_options) |
                             SHIFT_ERROR_IRQ_TO_CHINTENSET_POS(dma_options);
     return UHAL_STATUS_OK;
 }
 
+uhal_status_t dma_set_transfer_done_callback(const dma_peripheral_t dma_peripheral,
+                                             const dma_channel_t dma_channel,
+                                             const dma_transfer_done_cb_t transfer_done_cb) {
+    dma_transfer_done_callbacks[dma_channel] = transfer_done_cb;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t dma_abort_transfer(const dma_peripheral_t dma_peripheral, const dma_channel_t dma_channel) {
+    DMA_SELECT_CHANNEL(dma_channel);
+    DMA_CH(dma_channel).CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    /* The write-back descriptor is only valid after the channel has been disabled */
+    while (DMA_CH(dma_channel).CHCTRLA.reg & DMAC_CHCTRLA_ENABLE);
+    return UHAL_STATUS_OK;
+}
+
+size_t dma_get_remaining_transfer_count(const dma_peripheral_t dma_peripheral, const dma_channel_t dma_channel) {
+    return wrb[dma_channel].btcnt;
+}
+
 uhal_status_t dma_deinit(const dma_peripheral_t dma_peripheral) {
+#ifdef __SAMD51__
+    MCLK->AHBMASK.reg &= ~MCLK_AHBMASK_DMAC;
+#else
     PM->AHBMASK.reg &= ~PM_AHBMASK_DMAC;
     PM->APBBMASK.reg &= ~PM_APBBMASK_DMAC;
     while (GCLK->STATUS.bit.SYNCBUSY);
+#endif
 
     DMAC->CTRL.reg &= ~DMAC_CTRL_DMAENABLE;
-    NVIC_ClearPendingIRQ(DMAC_IRQn);
-    NVIC_DisableIRQ(DMAC_IRQn);
+    disable_irq_handlers(DMAC_FIRST_IRQn, DMAC_IRQ_LINES);
     return UHAL_STATUS_OK;
 }
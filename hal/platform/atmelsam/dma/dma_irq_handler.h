@@ -21,9 +21,32 @@
 *
 * Author:          Victor Hogeweij <hogeweyv@gmail.com>
 */
+#include <stdbool.h>
+#include <stddef.h>
 #include <sam.h>
+#include "error_handling.h"
+#include "dma/dma_platform_specific.h"
 
 void dma_irq_handler(const void *const hw) {
     Dmac *dma_inst = (Dmac*) hw;
-    dma_inst->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
+#ifndef __SAMD51__
+    /* The handler can interrupt code which selected a channel through CHID, so the selection is restored afterwards */
+    const uint8_t previous_channel_id = dma_inst->CHID.reg;
+#endif
+    while (dma_inst->INTSTATUS.reg) {
+        const uint16_t int_pend = dma_inst->INTPEND.reg;
+        const uint8_t dma_channel = int_pend & DMAC_INTPEND_ID_Msk;
+        const uint16_t channel_flags = int_pend & (DMAC_INTPEND_TERR | DMAC_INTPEND_TCMPL | DMAC_INTPEND_SUSP);
+        /* Writing the flags back together with the channel id clears them */
+        dma_inst->INTPEND.reg = DMAC_INTPEND_ID(dma_channel) | channel_flags;
+        const bool transfer_done = channel_flags & (DMAC_INTPEND_TERR | DMAC_INTPEND_TCMPL);
+        const dma_transfer_done_cb_t transfer_done_cb = dma_transfer_done_callbacks[dma_channel];
+        if (transfer_done && transfer_done_cb != NULL) {
+            const uhal_status_t status = (channel_flags & DMAC_INTPEND_TERR) ? UHAL_STATUS_ERROR : UHAL_STATUS_OK;
+            transfer_done_cb((dma_channel_t) dma_channel, status);
+        }
+    }
+#ifndef __SAMD51__
+    dma_inst->CHID.reg = previous_channel_id;
+#endif
 }
\ No newline at end of file
@@ -24,11 +24,21 @@
 #ifndef ATMELSAMD21_DMA_PLATFORM_SPECIFIC_H
 #define ATMELSAMD21_DMA_PLATFORM_SPECIFIC_H
 #include <sam.h>
+#include "error_handling.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
+/**
+ * @brief The SAMD51 DMAC has 32 channels, the SAMD21 DMAC 12.
+ */
+#ifdef __SAMD51__
+#define DMA_NUM_CHANNELS 32
+#else
+#define DMA_NUM_CHANNELS 12
+#endif
+
 typedef enum {
     DMA_CHANNEL_0,
     DMA_CHANNEL_1,
@@ -42,6 +52,28 @@ typedef enum {
     DMA_CHANNEL_9,
     DMA_CHANNEL_10,
     DMA_CHANNEL_11,
+#ifdef __SAMD51__
+    DMA_CHANNEL_12,
+    DMA_CHANNEL_13,
+    DMA_CHANNEL_14,
+    DMA_CHANNEL_15,
+    DMA_CHANNEL_16,
+    DMA_CHANNEL_17,
+    DMA_CHANNEL_18,
+    DMA_CHANNEL_19,
+    DMA_CHANNEL_20,
+    DMA_CHANNEL_21,
+    DMA_CHANNEL_22,
+    DMA_CHANNEL_23,
+    DMA_CHANNEL_24,
+    DMA_CHANNEL_25,
+    DMA_CHANNEL_26,
+    DMA_CHANNEL_27,
+    DMA_CHANNEL_28,
+    DMA_CHANNEL_29,
+    DMA_CHANNEL_30,
+    DMA_CHANNEL_31,
+#endif
 } dma_channel_t;
 
 typedef enum {
@@ -69,6 +101,7 @@ typedef enum {
     DMA_OPT_BLOCKACT_BOTH = 12292,
     DMA_OPT_EVENT_OUTPUT_BLOCK = 16384,
     DMA_OPT_EVENT_OUTPUT_BEAT = 32768,
+    DMA_OPT_RUN_IN_STANDBY = 65536,
 } dma_opt_t;
 
 typedef enum {
@@ -173,6 +206,15 @@ typedef enum {
     DMA_PERIPHERAL_LOCATION_UART_5 = 5
 } dma_peripheral_location_t;
 
+/**
+ * @brief Callback which gets called by the default DMA IRQ handler when a transfer on a channel has finished.
+ * @param dma_channel The channel on which the transfer finished
+ * @param status UHAL_STATUS_OK when the transfer completed, UHAL_STATUS_ERROR on a transfer error
+ */
+typedef void (*dma_transfer_done_cb_t)(const dma_channel_t dma_channel, const uhal_status_t status);
+
+extern volatile dma_transfer_done_cb_t dma_transfer_done_callbacks[DMA_NUM_CHANNELS];
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -197,6 +239,10 @@ typedef enum {
     do {                                                                                                                                             \
     } while (0);
 
+#define DMA_CHANNEL_FUNC_PARAMETER_CHECK(dma_peripheral, dma_channel)                                                                                \
+    do {                                                                                                                                             \
+    } while (0);
+
 #define DMA_DEINIT_FUNC_PARAMETER_CHECK(dma_peripheral)                                                                                              \
     do {                                                                                                                                             \
     } while (0);
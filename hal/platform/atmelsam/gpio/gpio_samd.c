@@ -37,6 +37,19 @@
 #define GPIO_PIN_GROUP(pin) ((pin >> 8) - 1)
 #define GPIO_PIN(pin) (pin & 0xFF)
 
+/*
+ * The SAMD51 EIC renamed CTRL to CTRLA and moved SYNCBUSY into its own register.
+ */
+#ifdef __SAMD51__
+#define EIC_CTRL_REG          (EIC->CTRLA.reg)
+#define EIC_CTRL_ENABLE_BIT   EIC_CTRLA_ENABLE
+#define EIC_IS_SYNCING()      (EIC->SYNCBUSY.reg)
+#else
+#define EIC_CTRL_REG          (EIC->CTRL.reg)
+#define EIC_CTRL_ENABLE_BIT   EIC_CTRL_ENABLE
+#define EIC_IS_SYNCING()      (EIC->STATUS.bit.SYNCBUSY)
+#endif
+
 uhal_status_t gpio_set_pin_lvl(const gpio_pin_t pin, gpio_level_t level) {
 
     if (level) {
@@ -227,7 +240,7 @@ gpio_opt_t gpio_get_pin_options(const gpio_pin_t pin) {
 static inline uhal_status_t wait_for_eic_gclk_sync() {
     int timeout = 65535;
     int timeout_attempt = 4;
-    while (EIC->STATUS.bit.SYNCBUSY) {
+    while (EIC_IS_SYNCING()) {
         timeout--;
         if (timeout <= 0) {
             if (--timeout_attempt) {
@@ -258,7 +271,7 @@ uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq
     /*
      * Set the clock of EIC to the system_clk on the given CLK_GEN
      */
-    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_ID_EIC | GCLK_CLKCTRL_GEN(irq_opt.irq_clk_generator);
+    clk_route_generator(CLK_CHANNEL_EIC, irq_opt.irq_clk_generator);
 
     /*
      * Wait for the peripheral to apply changes..
@@ -268,6 +281,17 @@ uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq
         return status;
     }
 
+#ifdef __SAMD51__
+    /*
+     * The CONFIG registers of the SAMD51 are enable-protected, so the EIC is disabled while they are written.
+     */
+    EIC_CTRL_REG &= ~EIC_CTRL_ENABLE_BIT;
+    status = wait_for_eic_gclk_sync();
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+#endif
+
     /*
      * EIC is divided within two sections: GPIO_CONFIG0 AND GPIO_CONFIG1 because the system is limited to 32-bit register sizes.
      * Therefore, we need to decide on the basis of the channel selected which CONFIG register to write.
@@ -293,11 +317,14 @@ uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq
         EIC->NMICTRL.reg = filter_mask | trigger_mask;
     }
 
+#ifndef __SAMD51__
+    /* Every enabled EIC interrupt wakes up the SAMD51, it has no WAKEUP register */
     if (BITMASK_COMPARE(irq_opt.irq_extra_opt, GPIO_IRQ_WAKE_FROM_SLEEP)) {
         EIC->WAKEUP.reg |= SHIFT_ONE_LEFT_BY_N(irq_opt.irq_channel);
     } else {
         EIC->WAKEUP.reg &= ~(SHIFT_ONE_LEFT_BY_N(irq_opt.irq_channel));
     }
+#endif
     /*
      * Check whether to use interrupts or events,
      * if events configure as little as possible to make it working :)
@@ -306,7 +333,7 @@ uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq
         EIC->INTENCLR.reg = SHIFT_ONE_LEFT_BY_N(irq_opt.irq_channel);
         EIC->EVCTRL.reg |= SHIFT_ONE_LEFT_BY_N(irq_opt.irq_channel);
     } else {
-        enable_irq_handler(EIC_IRQn, 2);
+        enable_irq_handlers(EIC_FIRST_IRQn, EIC_IRQ_LINES, 2);
         /*
          * Set the interrupt for this specific pin.
          */
@@ -315,7 +342,7 @@ uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq
     /*
      * Enable the peripheral
      */
-    EIC->CTRL.reg |= EIC_CTRL_ENABLE;
+    EIC_CTRL_REG |= EIC_CTRL_ENABLE_BIT;
 
     /*
      * Wait for the peripheral to apply changes..
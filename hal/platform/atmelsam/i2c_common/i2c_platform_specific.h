@@ -34,6 +34,8 @@ extern "C" {
 #include "clock_system/peripheral_clocking.h"
 #include "error_handling.h"
 #include "irq/sercom_stuff.h"
+#include "dma/dma_platform_specific.h"
+#include "gpio/gpio_platform_specific.h"
 
 typedef enum {
     I2C_PERIPHERAL_0,
@@ -67,17 +69,334 @@ typedef enum {
 typedef enum {
     I2C_EXTRA_OPT_NONE = 0,
     I2C_EXTRA_OPT_4_WIRE_MODE = 1,
+    I2C_EXTRA_OPT_LOW_TIMEOUT = 0x02,
+    I2C_EXTRA_OPT_INACTIVE_TIMEOUT_55US = 0x04,
+    I2C_EXTRA_OPT_INACTIVE_TIMEOUT_105US = 0x08,
+    I2C_EXTRA_OPT_INACTIVE_TIMEOUT_205US = 0x0C,
+    I2C_EXTRA_OPT_MASTER_EXT_TIMEOUT = 0x10,
+    I2C_EXTRA_OPT_SLAVE_EXT_TIMEOUT = 0x20,
+    I2C_EXTRA_OPT_POLLING = 0x40,
+    I2C_EXTRA_OPT_RUN_IN_STANDBY = 0x80,
     I2C_EXTRA_OPT_IRQ_PRIO_0 = 0x100,
     I2C_EXTRA_OPT_IRQ_PRIO_1 = 0x200,
     I2C_EXTRA_OPT_IRQ_PRIO_2 = 0x300,
     I2C_EXTRA_OPT_IRQ_PRIO_3 = 0x400
 } i2c_extra_opt_t;
 
+/**
+ * @brief 10-bit addressing. Addresses above 0x7F are always sent as 10-bit address,
+ *        wrap an address in I2C_ADDR_10BIT() to address a 10-bit device with an address below 0x80.
+ */
+#define I2C_ADDR_10BIT_FLAG    0x8000
+#define I2C_ADDR_10BIT(addr)   ((addr) | I2C_ADDR_10BIT_FLAG)
+#define I2C_ADDR_VALUE(addr)   ((addr) & 0x3FF)
+#define I2C_ADDR_IS_10BIT(addr) (((addr) & I2C_ADDR_10BIT_FLAG) || I2C_ADDR_VALUE(addr) > 0x7F)
+
+/**
+ * @brief The ADDR register value of the read header of a 10-bit read (combined format), sent with a repeated start
+ *        after the write header. It holds only the first address byte (11110 + the two upper address bits) with
+ *        the read bit set and TENBITEN cleared, so the SERCOM doesn't send the second address byte again.
+ */
+#define I2C_ADDR_10BIT_READ_HEADER(addr) ((uint32_t) (((0x78 | ((I2C_ADDR_VALUE(addr) >> 8) & 0x3)) << 1) | 1))
+
+/**
+ * @brief All extra options which are not an IRQ priority.
+ */
+#define I2C_EXTRA_OPT_FLAGS_MASK                                                                                                                     \
+    (I2C_EXTRA_OPT_4_WIRE_MODE | I2C_EXTRA_OPT_LOW_TIMEOUT | I2C_EXTRA_OPT_INACTIVE_TIMEOUT_205US | I2C_EXTRA_OPT_MASTER_EXT_TIMEOUT                 \
+     | I2C_EXTRA_OPT_SLAVE_EXT_TIMEOUT | I2C_EXTRA_OPT_POLLING | I2C_EXTRA_OPT_RUN_IN_STANDBY)
+
+/**
+ * @brief Callback which gets called by the I2C slave register-map engine after the host wrote one or more registers.
+ *        It is called from the SERCOM ISR when the STOP condition of the write transaction is detected.
+ * @param i2c_peripheral_num The i2c peripheral on which the registers were written
+ * @param first_reg The first register which was (possibly) changed by the host
+ * @param amount_of_regs The amount of consecutive registers which were written (wraps around at the end of the map)
+ */
+typedef void (*i2c_slave_reg_change_cb_t)(const i2c_periph_inst_t i2c_peripheral_num, const uint8_t first_reg,
+                                          const uint16_t amount_of_regs);
+
+/**
+ * @brief Internal state of the I2C slave register-map engine (one per SERCOM).
+ *        The first byte written by the host sets reg_ptr, all following bytes are written to the map.
+ *        Reads stream from the map starting at reg_ptr, auto-incrementing and wrapping at amount_of_regs.
+ */
+typedef struct {
+    volatile uint8_t *registers;
+    const uint8_t *write_masks;
+    uint16_t amount_of_regs;
+    uint8_t reg_ptr;
+    uint8_t reg_ptr_received;
+    uint8_t first_changed_reg;
+    uint16_t amount_of_changed_regs;
+    i2c_slave_reg_change_cb_t reg_change_cb;
+} i2c_slave_reg_map_t;
+
+extern volatile i2c_slave_reg_map_t i2c_slave_reg_maps[6];
+
+/**
+ * @brief The maximum amount of addresses which can get their own handler and/or register map on one SERCOM.
+ */
+#define I2C_SLAVE_MAX_ADDRESS_HANDLERS 4
+#define I2C_SLAVE_NO_ADDRESS_SLOT      0xFF
+
+typedef enum {
+    I2C_SLAVE_ADDR_MODE_MASK = 0,
+    I2C_SLAVE_ADDR_MODE_TWO_ADDRESSES = 1,
+    I2C_SLAVE_ADDR_MODE_RANGE = 2
+} i2c_slave_addr_mode_t;
+
+typedef enum {
+    I2C_SLAVE_ADDR_OPT_NONE = 0,
+    I2C_SLAVE_ADDR_OPT_GENERAL_CALL = 1
+} i2c_slave_addr_opt_t;
+
+/**
+ * @brief Handler which gets called (from the SERCOM ISR) when the host addresses the slave on a specific address.
+ * @param i2c_peripheral_num The i2c peripheral on which the address matched
+ * @param matched_addr The address the host sent (0 for a general call)
+ * @param is_read 1 when the host wants to read from the slave, 0 when it wants to write
+ * @return UHAL_STATUS_OK to ACK the address, any other value NACKs it.
+ */
+typedef uhal_status_t (*i2c_slave_addr_handler_t)(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t matched_addr,
+                                                  const uint8_t is_read);
+
+typedef struct {
+    uint8_t in_use;
+    uint16_t addr;
+    i2c_slave_addr_handler_t handler;
+    i2c_slave_reg_map_t reg_map;
+} i2c_slave_addr_slot_t;
+
+/**
+ * @brief Internal per-address state of the I2C slave driver (one per SERCOM).
+ *        active_slot is the slot of the address matched by the current transaction.
+ */
+typedef struct {
+    uint8_t active_slot;
+    uint16_t matched_addr;
+    i2c_slave_addr_slot_t slots[I2C_SLAVE_MAX_ADDRESS_HANDLERS];
+} i2c_slave_addr_state_t;
+
+extern volatile i2c_slave_addr_state_t i2c_slave_addr_states[6];
+
+typedef enum {
+    I2C_SLAVE_DMA_DIR_NONE,
+    I2C_SLAVE_DMA_DIR_RECEIVED,
+    I2C_SLAVE_DMA_DIR_TRANSMITTED
+} i2c_slave_dma_dir_t;
+
+/**
+ * @brief Callback which gets called by the I2C slave DMA engine when a transfer has been finished by a STOP or repeated START.
+ * @param i2c_peripheral_num The i2c peripheral on which the transfer took place
+ * @param direction I2C_SLAVE_DMA_DIR_RECEIVED when the host wrote to the rx buffer, I2C_SLAVE_DMA_DIR_TRANSMITTED when it read the tx buffer
+ * @param amount_of_bytes The amount of bytes transferred to or from the buffer
+ */
+typedef void (*i2c_slave_dma_done_cb_t)(const i2c_periph_inst_t i2c_peripheral_num, const i2c_slave_dma_dir_t direction,
+                                        const size_t amount_of_bytes);
+
+/**
+ * @brief Internal state of the I2C slave DMA engine (one per SERCOM).
+ */
+typedef struct {
+    uint8_t enabled;
+    uint8_t active_direction;
+    uint8_t buffer_exhausted;
+    dma_channel_t rx_channel;
+    dma_channel_t tx_channel;
+    uint8_t *rx_buffer;
+    size_t rx_size;
+    const uint8_t *tx_buffer;
+    size_t tx_size;
+    i2c_slave_dma_done_cb_t transfer_done_cb;
+} i2c_slave_dma_t;
+
+extern volatile i2c_slave_dma_t i2c_slave_dma[6];
+
+/**
+ * @brief The maximum amount of devices which can get their own retry policy on one SERCOM.
+ */
+#define I2C_HOST_MAX_DEVICE_RETRY_POLICIES 4
+
+/**
+ * @brief Retry policy of the I2C host retry engine.
+ *        A failed transaction is restarted by the ISR when its error is in retry_on (i2c_error_flag_t flags),
+ *        until max_retries is reached. The backoff before a retry starts at backoff_scl_periods and doubles every retry.
+ */
+typedef struct {
+    uint8_t max_retries;
+    uint8_t retry_on;
+    uint16_t backoff_scl_periods;
+} i2c_host_retry_policy_t;
+
+typedef struct {
+    uint8_t in_use;
+    uint16_t addr;
+    i2c_host_retry_policy_t policy;
+} i2c_host_device_retry_policy_t;
+
+/**
+ * @brief Internal state of the I2C host retry engine (one per SERCOM).
+ *        active_policy, addr_reg and transaction_type are captured when a transaction is started,
+ *        so the ISR can restart the transaction without help of the caller.
+ */
+typedef struct {
+    i2c_host_retry_policy_t default_policy;
+    i2c_host_device_retry_policy_t device_policies[I2C_HOST_MAX_DEVICE_RETRY_POLICIES];
+    i2c_host_retry_policy_t active_policy;
+    uint32_t addr_reg;
+    uint8_t transaction_type;
+    uint8_t pending;
+    uint16_t deadline;
+    uint16_t ticks_per_scl_period;
+} i2c_host_retry_state_t;
+
+extern volatile i2c_host_retry_state_t i2c_host_retry_states[6];
+
+/**
+ * @brief Reports the end of a transaction to the I2C host driver, called by the SERCOM ISR.
+ *        Starts the read of i2c_host_write_read_non_blocking or calls the transaction done callback.
+ */
+void i2c_host_transaction_done(volatile bustransaction_t *transaction);
+
+/**
+ * @brief The maximum time a blocking function sleeps on the completion event when the OS hooks are enabled (UHAL_OS_HOOKS).
+ *        After it the driver falls back to its own (busy-waiting) timeout handling.
+ */
+#ifndef I2C_HOST_OS_WAIT_TIMEOUT_MS
+#define I2C_HOST_OS_WAIT_TIMEOUT_MS 100
+#endif
+
+/**
+ * @brief The range of (non-reserved) 7-bit addresses probed by the I2C host bus scanner.
+ */
+#define I2C_HOST_SCAN_FIRST_ADDR 0x08
+#define I2C_HOST_SCAN_LAST_ADDR  0x77
+
+/**
+ * @brief Internal state of the I2C host bus scanner and device-presence cache (one per SERCOM).
+ *        A bit in probed is set for every 7-bit address of which the presence is known,
+ *        a bit in present is set when the device at that address ACKed the probe.
+ */
+typedef struct {
+    uint32_t probed[4];
+    uint32_t present[4];
+    uint8_t scanning;
+    uint8_t scan_addr;
+    uint32_t addr_flags;
+} i2c_host_presence_t;
+
+extern volatile i2c_host_presence_t i2c_host_presence[6];
+
+/**
+ * @brief The TC used for timing the backoff of the retry engine, selected with I2C_HOST_RETRY_TIMER (3, 4 or 5).
+ *        Without a retry timer, failed transactions are restarted immediately from the ISR and a backoff can't be set.
+ *        The TC is clocked from the fast clock generator of the first peripheral which sets a retry policy, the backoff
+ *        of every peripheral is converted to ticks of that clock using its own baud rate (ticks_per_scl_period).
+ */
+#ifdef I2C_HOST_RETRY_TIMER
+#define I2C_HOST_RETRY_BACKOFF_SUPPORTED 1
+#ifdef __SAMD51__
+#error "I2C_HOST_RETRY_TIMER is only supported on the SAMD21!"
+#elif I2C_HOST_RETRY_TIMER == 3
+#define I2C_HOST_RETRY_TC             TC3
+#define I2C_HOST_RETRY_TC_IRQn        TC3_IRQn
+#define I2C_HOST_RETRY_TC_HANDLER     TC3_Handler
+#define I2C_HOST_RETRY_TC_CLKCTRL_ID  GCLK_CLKCTRL_ID_TCC2_TC3
+#define I2C_HOST_RETRY_TC_APBCMASK    PM_APBCMASK_TC3
+#elif I2C_HOST_RETRY_TIMER == 4
+#define I2C_HOST_RETRY_TC             TC4
+#define I2C_HOST_RETRY_TC_IRQn        TC4_IRQn
+#define I2C_HOST_RETRY_TC_HANDLER     TC4_Handler
+#define I2C_HOST_RETRY_TC_CLKCTRL_ID  GCLK_CLKCTRL_ID_TC4_TC5
+#define I2C_HOST_RETRY_TC_APBCMASK    PM_APBCMASK_TC4
+#elif I2C_HOST_RETRY_TIMER == 5
+#define I2C_HOST_RETRY_TC             TC5
+#define I2C_HOST_RETRY_TC_IRQn        TC5_IRQn
+#define I2C_HOST_RETRY_TC_HANDLER     TC5_Handler
+#define I2C_HOST_RETRY_TC_CLKCTRL_ID  GCLK_CLKCTRL_ID_TC4_TC5
+#define I2C_HOST_RETRY_TC_APBCMASK    PM_APBCMASK_TC5
+#else
+#error "I2C_HOST_RETRY_TIMER has to be 3, 4 or 5!"
+#endif
+#define I2C_HOST_RETRY_TC_PRESCALER   64
+#else
+#define I2C_HOST_RETRY_BACKOFF_SUPPORTED 0
+#endif
+
+/**
+ * @brief Baud rate calculator of the I2C host, the macros can be used in static_asserts when their arguments are constants.
+ *        fscl = fgclk / (10 + BAUD + BAUDLOW + fgclk * Trise), with BAUDLOW = 0 BAUD sets both the high and low time (section 28.10.3).
+ *        In high-speed mode fscl = fgclk / (2 + HSBAUD + HSBAUDLOW), the master code is sent in fast-mode using BAUD/BAUDLOW.
+ *        The period is rounded up, so the achieved frequency never exceeds the requested frequency.
+ *        Above standard mode the steps are split 2:1 between the SCL low and high time, as fast-mode(+) and high-speed mode require.
+ *
+ * I2C_HOST_RISE_TIME_NS is the rise time of the bus (depends on the pull-ups and bus capacitance),
+ * I2C_HOST_MAX_BAUD_ERROR_PERMILLE the maximum deviation from the requested baud rate accepted by I2C_HOST_INIT
+ * (the default accepts the 3.2MHz high-speed clock which is the closest a 48MHz clock can get to 3.4MHz).
+ */
+#ifndef I2C_HOST_RISE_TIME_NS
+#define I2C_HOST_RISE_TIME_NS            215
+#endif
+#ifndef I2C_HOST_MAX_BAUD_ERROR_PERMILLE
+#define I2C_HOST_MAX_BAUD_ERROR_PERMILLE 60
+#endif
+
+#define I2C_STANDARD_MODE_MAX_FREQ       100000
+#define I2C_FAST_MODE_MAX_FREQ           400000
+#define I2C_FAST_MODE_PLUS_MAX_FREQ      1000000
+
+#define I2C_BAUD_DIV_CEIL(a, b)          (((a) + (b) - 1) / (b))
+#define I2C_RISE_TIME_CYCLES(clk_freq, rise_time_ns)                                                                                                 \
+    ((int32_t) (((uint64_t) (clk_freq) * (rise_time_ns) + 500000000ULL) / 1000000000ULL))
+#define I2C_BAUD_STEPS(clk_freq, baud_freq, rise_time_ns)                                                                                            \
+    ((int32_t) I2C_BAUD_DIV_CEIL(clk_freq, baud_freq) - 10 - I2C_RISE_TIME_CYCLES(clk_freq, rise_time_ns))
+#define I2C_HS_BAUD_STEPS(clk_freq, baud_freq) ((int32_t) I2C_BAUD_DIV_CEIL(clk_freq, baud_freq) - 2)
+#define I2C_BAUD_SYMMETRIC(steps)              (((steps) + 1) / 2)
+#define I2C_BAUD_LOW(steps)                    (((steps) * 2) / 3)
+#define I2C_BAUD_HIGH(steps)                   ((steps) - I2C_BAUD_LOW(steps))
+#define I2C_HOST_FAST_MODE_FREQ(baud_freq)     ((baud_freq) > I2C_FAST_MODE_PLUS_MAX_FREQ ? I2C_FAST_MODE_MAX_FREQ : (baud_freq))
+
+/**
+ * @brief The register values calculated for a baud rate.
+ */
+#define I2C_HOST_BAUD_VAL(clk_freq, baud_freq, rise_time_ns)                                                                                         \
+    ((baud_freq) <= I2C_STANDARD_MODE_MAX_FREQ ? I2C_BAUD_SYMMETRIC(I2C_BAUD_STEPS(clk_freq, baud_freq, rise_time_ns))                              \
+                                               : I2C_BAUD_HIGH(I2C_BAUD_STEPS(clk_freq, I2C_HOST_FAST_MODE_FREQ(baud_freq), rise_time_ns)))
+#define I2C_HOST_BAUDLOW_VAL(clk_freq, baud_freq, rise_time_ns)                                                                                      \
+    ((baud_freq) <= I2C_STANDARD_MODE_MAX_FREQ ? 0 : I2C_BAUD_LOW(I2C_BAUD_STEPS(clk_freq, I2C_HOST_FAST_MODE_FREQ(baud_freq), rise_time_ns)))
+#define I2C_HOST_HSBAUD_VAL(clk_freq, baud_freq)                                                                                                     \
+    ((baud_freq) > I2C_FAST_MODE_PLUS_MAX_FREQ ? I2C_BAUD_HIGH(I2C_HS_BAUD_STEPS(clk_freq, baud_freq)) : 0)
+#define I2C_HOST_HSBAUDLOW_VAL(clk_freq, baud_freq)                                                                                                  \
+    ((baud_freq) > I2C_FAST_MODE_PLUS_MAX_FREQ ? I2C_BAUD_LOW(I2C_HS_BAUD_STEPS(clk_freq, baud_freq)) : 0)
+
+/**
+ * @brief The SCL frequency achieved with the calculated register values and its deviation from the requested baud rate.
+ */
+#define I2C_HOST_ACHIEVED_FREQ(clk_freq, baud_freq, rise_time_ns)                                                                                    \
+    ((baud_freq) > I2C_FAST_MODE_PLUS_MAX_FREQ                                                                                                       \
+         ? (clk_freq) / (2 + I2C_HOST_HSBAUD_VAL(clk_freq, baud_freq) + I2C_HOST_HSBAUDLOW_VAL(clk_freq, baud_freq))                                \
+     : (baud_freq) <= I2C_STANDARD_MODE_MAX_FREQ                                                                                                     \
+         ? (clk_freq) / (10 + 2 * I2C_HOST_BAUD_VAL(clk_freq, baud_freq, rise_time_ns) + I2C_RISE_TIME_CYCLES(clk_freq, rise_time_ns))               \
+         : (clk_freq) / (10 + I2C_HOST_BAUD_VAL(clk_freq, baud_freq, rise_time_ns) + I2C_HOST_BAUDLOW_VAL(clk_freq, baud_freq, rise_time_ns)        \
+                         + I2C_RISE_TIME_CYCLES(clk_freq, rise_time_ns)))
+#define I2C_HOST_BAUD_ERROR_PERMILLE(clk_freq, baud_freq, rise_time_ns)                                                                              \
+    ((((int64_t) (baud_freq) - (int64_t) I2C_HOST_ACHIEVED_FREQ(clk_freq, baud_freq, rise_time_ns)) * 1000) / (int64_t) (baud_freq))
+
+/**
+ * @brief Whether the calculated values fit in the BAUD register (every used field between 1 and 255).
+ */
+#define I2C_HOST_BAUD_FITS(clk_freq, baud_freq, rise_time_ns)                                                                                        \
+    (I2C_HOST_BAUD_VAL(clk_freq, baud_freq, rise_time_ns) >= 1 && I2C_HOST_BAUD_VAL(clk_freq, baud_freq, rise_time_ns) <= 0xFF                      \
+     && I2C_HOST_BAUDLOW_VAL(clk_freq, baud_freq, rise_time_ns) <= 0xFF                                                                              \
+     && ((baud_freq) <= I2C_FAST_MODE_PLUS_MAX_FREQ                                                                                                  \
+         || (I2C_HOST_HSBAUD_VAL(clk_freq, baud_freq) >= 1 && I2C_HOST_HSBAUDLOW_VAL(clk_freq, baud_freq) <= 0xFF)))
+
 #define I2C_HOST_INIT_FUNC_PARAMETER_CHECK(i2c_peripheral_num, clock_sources, periph_clk_freq, baud_rate_freq, extra_configuration_options)          \
     do {                                                                                                                                             \
         const uint32_t max_freq = 48000000;                                                                                                          \
         const uint32_t min_freq = 200000;                                                                                                            \
-        const uint32_t max_supported_baud_rate = 1000000;                                                                                            \
+        const uint32_t max_supported_baud_rate = 3400000;                                                                                            \
         const uint32_t min_supported_baud_rate = 100000;                                                                                             \
         static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
                       "Invalid i2c peripheral instance number given to host driver!");                                                               \
@@ -88,10 +407,14 @@ typedef enum {
                       "I2C peripheral clock frequency has to be atleast higher than 2x the standard slow i2c baud_rate of 100KHz");                  \
         static_assert(baud_rate_freq <= max_supported_baud_rate && baud_rate_freq >= min_supported_baud_rate,                                        \
                       "Unsupported baud rate option set on I2C host driver!");                                                                       \
-        static_assert((extra_configuration_options <= I2C_EXTRA_OPT_IRQ_PRIO_3 && extra_configuration_options >= I2C_EXTRA_OPT_IRQ_PRIO_0)           \
-                          || extra_configuration_options == I2C_EXTRA_OPT_NONE,                                                                      \
-                      "Invalid IRQ priority set on I2C host driver!");                                                                               \
-        static_assert((extra_configuration_options & 0xFF) <= I2C_EXTRA_OPT_4_WIRE_MODE,                                                             \
+        static_assert(baud_rate_freq <= 1000000 || periph_clk_freq >= 4 * baud_rate_freq,                                                          \
+                      "High-speed mode needs a peripheral clock of atleast 4x the baud rate!");                                                      \
+        static_assert(I2C_HOST_BAUD_FITS(periph_clk_freq, baud_rate_freq, I2C_HOST_RISE_TIME_NS),                                                    \
+                      "The baud rate can't be generated from this peripheral clock frequency!");                                                     \
+        static_assert(I2C_HOST_BAUD_ERROR_PERMILLE(periph_clk_freq, baud_rate_freq, I2C_HOST_RISE_TIME_NS) <= I2C_HOST_MAX_BAUD_ERROR_PERMILLE,      \
+                      "The achieved baud rate deviates more than I2C_HOST_MAX_BAUD_ERROR_PERMILLE from the requested baud rate!");                   \
+        static_assert((extra_configuration_options >> 8) <= (I2C_EXTRA_OPT_IRQ_PRIO_3 >> 8), "Invalid IRQ priority set on I2C host driver!");     \
+        static_assert(((extra_configuration_options & 0xFF) & ~I2C_EXTRA_OPT_FLAGS_MASK) == 0,                                                       \
                       "Unsupported extra configurations options set on I2C host driver!");                                                           \
     } while (0);
 
@@ -101,11 +424,24 @@ typedef enum {
                       "Invalid i2c peripheral instance number given to host driver!");                                                               \
     } while (0);
 
+#define I2C_HOST_SET_BUS_RECOVERY_PINS_FUNC_PARAMETER_CHECK(i2c_peripheral_num, scl_pin, sda_pin)                                                   \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert(scl_pin != sda_pin, "The SCL and SDA pin can't be the same pin!");                                                            \
+    } while (0);
+
+#define I2C_HOST_RECOVER_BUS_FUNC_PARAMETER_CHECK(i2c_peripheral_num)                                                                            \
+    do {                                                                                                                                         \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                          \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                           \
+    } while (0);
+
 #define I2C_HOST_WRITE_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, write_buff, size, stop_bit)                                                    \
     do {                                                                                                                                             \
         static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
                       "Invalid i2c peripheral instance number given to host driver!");                                                               \
-        static_assert(addr <= 1023 && addr > 0, "Invalid I2C address given!");                                                                       \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                                                                       \
         static_assert(write_buff != NULL && sizeof(write_buff) >= size, "writebuffer is equal to NULL or buffer overflow!");                         \
         static_assert(stop_bit <= 1, "Stop-bit can't have a higher value than 1!");                                                                  \
     } while (0);
@@ -114,18 +450,84 @@ typedef enum {
     do {                                                                                                                                             \
         static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
                       "Invalid i2c peripheral instance number given to host driver!");                                                               \
-        static_assert(addr <= 1023 && addr > 0, "Invalid I2C address given!");                                                                       \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                                                                       \
         static_assert(read_buff != NULL && sizeof(read_buff) >= size, "readbuffer is equal to NULL or buffer overflow!");                            \
     } while (0);
 
+#define I2C_HOST_SET_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on)                               \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert(max_retries <= 0xFF && backoff_scl_periods <= 0xFFFF, "Retry count or backoff out of range!");                                \
+        static_assert(I2C_HOST_RETRY_BACKOFF_SUPPORTED || backoff_scl_periods == 0,                                                                  \
+                      "A retry backoff needs a retry timer (I2C_HOST_RETRY_TIMER)!");                                                                 \
+        static_assert((retry_on & ~(I2C_ERROR_FLAG_ADDR_NACK | I2C_ERROR_FLAG_DATA_NACK | I2C_ERROR_FLAG_ARBLOST)) == 0,                             \
+                      "Only NACKs and arbitration loss can be retried!");                                                                            \
+    } while (0);
+
+#define I2C_HOST_SET_DEVICE_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, max_retries, backoff_scl_periods, retry_on)                  \
+    do {                                                                                                                                             \
+        I2C_HOST_SET_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on);                              \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                                                                       \
+    } while (0);
+
+#define I2C_HOST_SCAN_FUNC_PARAMETER_CHECK(i2c_peripheral_num)                                                                                       \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+    } while (0);
+
 #define I2C_SLAVE_INIT_PARAMETER_CHECK(i2c_peripheral_num, slave_addr, clock_sources, extra_configuration_options)                              \
     do {                                                                                                                                             \
+        static_assert((slave_addr & ~I2C_ADDR_10BIT_FLAG) <= 1023, "Invalid I2C slave address given!");                                             \
     } while (0);
 
 #define I2C_SLAVE_DEINIT_PARAMETER_CHECK(i2c_peripheral_num)                                                                                         \
     do {                                                                                                                                             \
     } while (0);
 
+#define I2C_SLAVE_SET_DMA_PARAMETER_CHECK(i2c_peripheral_num, rx_channel, rx_buffer, rx_size, tx_channel, tx_buffer, tx_size, transfer_done_cb)      \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to slave driver!");                                                              \
+        static_assert(rx_channel != tx_channel, "The i2c slave driver needs two different DMA channels for receiving and transmitting!");           \
+        static_assert(rx_size <= 0xFFFF && tx_size <= 0xFFFF, "A DMA buffer can't be larger than 65535 bytes!");                                   \
+    } while (0);
+
+#define I2C_SLAVE_DISABLE_DMA_PARAMETER_CHECK(i2c_peripheral_num)                                                                                    \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to slave driver!");                                                              \
+    } while (0);
+
+#define I2C_SLAVE_SET_ADDRESSING_PARAMETER_CHECK(i2c_peripheral_num, addr_mode, slave_addr, second_addr_or_mask, addr_opt)                          \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to slave driver!");                                                              \
+        static_assert(addr_mode <= I2C_SLAVE_ADDR_MODE_RANGE, "Invalid addressing mode given to slave driver!");                                    \
+        static_assert((slave_addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(second_addr_or_mask) <= 1023,                                  \
+                      "Invalid I2C address or address mask given!");                             \
+        static_assert(addr_mode != I2C_SLAVE_ADDR_MODE_RANGE || slave_addr <= second_addr_or_mask,                                                  \
+                      "The lower limit of an address range can't be higher than the upper limit!");                                                  \
+        static_assert(!I2C_ADDR_IS_10BIT(slave_addr) || (addr_mode == I2C_SLAVE_ADDR_MODE_MASK && I2C_ADDR_VALUE(second_addr_or_mask) == 0),       \
+                      "A 10-bit slave address can only be used as single address (mask mode without mask bits)!");                                   \
+        static_assert(addr_opt <= I2C_SLAVE_ADDR_OPT_GENERAL_CALL, "Invalid addressing options given to slave driver!");                            \
+    } while (0);
+
+#define I2C_SLAVE_SET_ADDRESS_HANDLER_PARAMETER_CHECK(i2c_peripheral_num, slave_addr)                                                                \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to slave driver!");                                                              \
+        static_assert((slave_addr & ~I2C_ADDR_10BIT_FLAG) <= 1023, "Invalid I2C address given!");                                                                            \
+    } while (0);
+
+#define I2C_SLAVE_SET_REGISTER_MAP_PARAMETER_CHECK(i2c_peripheral_num, registers, write_masks, amount_of_regs, reg_change_cb)                        \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_5 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to slave driver!");                                                              \
+        static_assert(amount_of_regs <= 256, "The register map can't contain more registers than an 8-bit register pointer can address!");          \
+    } while (0);
+
 
 #ifdef __cplusplus
 }
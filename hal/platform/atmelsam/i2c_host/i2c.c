@@ -25,24 +25,100 @@
 #ifndef DISABLE_I2C_HOST_MODULE
 
 #include <hal_i2c_host.h>
+#include <hal_gpio.h>
 #include <stdbool.h>
 #include "error_handling.h"
+#include "bit_manipulation.h"
+#include "hal_os.h"
 #include "irq/irq_bindings.h"
 
 static Sercom *i2c_host_peripheral_mapping_table[6] = {SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5};
+
+/**
+ * @brief The pins used for bus recovery on each peripheral, set using i2c_host_set_bus_recovery_pins.
+ */
+typedef struct {
+    uint8_t configured;
+    gpio_pin_t scl_pin;
+    gpio_pin_t sda_pin;
+} i2c_bus_recovery_pins_t;
+
+static i2c_bus_recovery_pins_t i2c_host_recovery_pins[6];
+
+/**
+ * @brief The peripheral clock frequency given to i2c_host_init, used for timing the bus recovery sequence.
+ */
+static uint32_t i2c_host_periph_clk_freq[6];
+
+/**
+ * @brief The baud rate and fast clock generator given to i2c_host_init, used for timing the backoff of the retry engine.
+ */
+static uint32_t i2c_host_baud_rate_freq[6];
+static uint8_t i2c_host_fast_clk_gen[6];
+
+/**
+ * @brief Whether the peripheral runs in high-speed mode, in which every transaction is started with the master code.
+ */
+static bool i2c_host_high_speed_mode[6];
+
+/**
+ * @brief Whether the peripheral was initialized with I2C_EXTRA_OPT_POLLING, its transactions then run in the calling context.
+ */
+static bool i2c_host_polling_mode[6];
+
+/**
+ * @brief Set when the fast clock generator of the peripheral changed frequency, the BAUD register is then recalculated
+ *        before the next transaction.
+ */
+static volatile bool i2c_host_retune_pending[6];
+
+volatile i2c_host_retry_state_t i2c_host_retry_states[6];
+
+volatile i2c_host_presence_t i2c_host_presence[6];
+
+/**
+ * @brief The callbacks set with i2c_host_set_transaction_done_callback.
+ */
+static volatile i2c_host_transaction_done_cb_t i2c_host_transaction_done_callbacks[6];
+
 /**
- * @brief This formula is used to calculate the baud rate steps.
- * The formula is a rewritten form of the formula found on page 483 (section 28.10.3) of the SAMD21 Family datasheet.
- * The original formula is: fscl = 1/(10 + 2*BAUD_STEPS + fgclk + Trise)
- * If no external pullup resistors are added the Trise will be the equivalent of fgclk/10
- * fgclk will be the fast gclk frequency (probably same as the CPU frequency)
- * fscl will be the output clock frequency (100/400/1000 KHz)
- * Baud_steps are the amount of steps needed to generate the right output frequency
+ * @brief The read which is started by the ISR as soon as the write of i2c_host_write_read_non_blocking finished,
+ *        the host still owns the bus at that point so the read starts with a repeated start.
  */
-#define calculate_baudrate(clock_freq, baud_freq) (clock_freq / (2 * baud_freq)) - (10 * clock_freq / (2 * clock_freq)) - 5
+typedef struct {
+    uint8_t pending;
+    uint16_t addr;
+    uint8_t *read_buffer;
+    size_t size;
+} i2c_host_chained_read_t;
+
+static volatile i2c_host_chained_read_t i2c_host_chained_reads[6];
+#define I2C_SPEED_STANDARD_AND_FAST_MODE          0x0
+#define I2C_SPEED_FAST_MODE_PLUS                  0x1
+#define I2C_SPEED_HIGH_SPEED_MODE                 0x2
 
 #define SERCOM_SLOW_CLOCK_SOURCE(x)               (x >> 8)
 
+#define I2C_BUSSTATE_UNKNOWN                      0x0
+#define I2C_BUSSTATE_IDLE                         0x1
+#define I2C_BUSSTATE_OWNER                        0x2
+
+/**
+ * @brief The amount of register reads after which a polled transaction gives up waiting on the bus.
+ */
+#define I2C_POLLING_TIMEOUT_LOOPS                 (65535 * 4)
+#define I2C_POLLING_ERROR_BITS                                                                                         \
+    (SERCOM_I2CM_STATUS_BUSERR | SERCOM_I2CM_STATUS_ARBLOST | SERCOM_I2CM_STATUS_RXNACK | SERCOM_I2CM_STATUS_LOWTOUT  \
+     | SERCOM_I2CM_STATUS_MEXTTOUT | SERCOM_I2CM_STATUS_SEXTTOUT | SERCOM_I2CM_STATUS_LENERR)
+
+/**
+ * @brief The bus recovery sequence clocks SCL at (at most) the standard mode frequency of 100KHz.
+ *        A delay loop iteration takes about 4 cycles.
+ */
+#define I2C_RECOVERY_SCL_FREQ                     100000
+#define I2C_RECOVERY_DELAY_LOOP_CYCLES            4
+#define I2C_RECOVERY_CLOCK_PULSES                 9
+
 
 /**
  * @brief Helper function which waits for the sercom peripheral to get in sync and finish requested operations.
@@ -74,27 +150,155 @@ uint8_t get_i2c_master_busstate(const void *const hw) {
     return (((Sercom *) hw)->I2CM.STATUS.reg & SERCOM_I2CM_STATUS_BUSSTATE_Msk) >> SERCOM_I2CM_STATUS_BUSSTATE_Pos;
 }
 
+/**
+ * @brief Helper function which busy-waits half an SCL period of the bus recovery sequence.
+ *        The loop runs on the CPU, so its length is based on the CPU clock (generator 0) and not on the SERCOM clock.
+ */
+static inline void recovery_half_period_delay(void) {
+    volatile uint32_t delay = clk_get_generator_freq(CLKGEN_0) / (2 * I2C_RECOVERY_SCL_FREQ * I2C_RECOVERY_DELAY_LOOP_CYCLES);
+    while (delay--) {};
+}
+
+/**
+ * @brief Helper functions which emulate an open-drain output using the GPIO direction.
+ */
+static inline void recovery_pull_line_low(const gpio_pin_t pin) {
+    gpio_set_pin_lvl(pin, GPIO_LOW);
+    gpio_set_pin_mode(pin, GPIO_MODE_OUTPUT);
+}
+
+static inline void recovery_release_line(const gpio_pin_t pin) {
+    gpio_set_pin_mode(pin, GPIO_MODE_INPUT);
+}
+
+/**
+ * @brief Helper function which checks whether the transaction ended in an error which could have left the bus stuck.
+ */
+static inline bool transaction_has_bus_error(volatile bustransaction_t *transaction) {
+    return (transaction->error_mask & (I2C_ERROR_FLAG_TIMEOUT | I2C_ERROR_FLAG_BUSERR));
+}
+
+/**
+ * @brief Helper function which clears the error information of the previous transaction before a new one is started.
+ */
+static inline void reset_transaction_info(volatile bustransaction_t *transaction) {
+    transaction->status = UHAL_STATUS_OK;
+    transaction->error_mask = 0;
+    transaction->first_error = UHAL_STATUS_OK;
+    transaction->last_error = UHAL_STATUS_OK;
+    transaction->nack_offset = 0;
+    transaction->retry_cnt = 0;
+}
+
+/**
+ * @brief Helper function which calls the transaction done callback of the peripheral (when set).
+ */
+static inline void notify_transaction_done(const i2c_periph_inst_t i2c_peripheral_num, const uhal_status_t status) {
+    const i2c_host_transaction_done_cb_t transaction_done_cb = i2c_host_transaction_done_callbacks[i2c_peripheral_num];
+    if (transaction_done_cb != NULL) {
+        transaction_done_cb(i2c_peripheral_num, status);
+    }
+}
+
+/**
+ * @brief Helper function which returns whether the ISR is still busy with a transaction, a retry or a bus scan.
+ */
+static inline bool transaction_in_flight(volatile bustransaction_t *transaction, volatile i2c_host_retry_state_t *retry_state,
+                                         volatile i2c_host_presence_t *presence) {
+    return transaction->transaction_type != SERCOMACT_IDLE_I2CM || retry_state->pending || presence->scanning;
+}
+
+/**
+ * @brief Helper function which returns whether a new transaction can be started on the bus.
+ *        Next to an idle bus this is a bus which is still owned by the host after a transaction without stop bit,
+ *        writing the ADDR register then sends a repeated start.
+ */
+static inline bool bus_available(Sercom *SercomInst, volatile bustransaction_t *transaction) {
+    const uint8_t busstate = get_i2c_master_busstate(SercomInst);
+    return busstate == I2C_BUSSTATE_IDLE
+           || (busstate == I2C_BUSSTATE_OWNER && transaction->transaction_type == SERCOMACT_IDLE_I2CM);
+}
+
 /**
  * @brief Helper function to wait for a transaction to finish.
  *        It uses a combination of flag polling as well as cycles delay to achieve this.
+ *        The wait is ended early when the ISR reports an error, in which case the bus is recovered when it doesn't return to idle
+ *        and recovery pins have been set.
  *
- * @param hw Pointer to the SERCOM peripheral to be manipulated or read.
+ * @param i2c_peripheral_num The i2c peripheral to wait on.
+ * @return The status of the transaction, or UHAL_STATUS_I2C_TIMEOUT when the bus didn't return to idle
+ *         (or stayed owned after a transaction without stop bit).
  *
  * @note This function can only be used for use with I2C host/master configuration
  */
-void wait_for_idle_busstate(Sercom *SercomInst) {
+static uhal_status_t wait_for_idle_busstate(const i2c_periph_inst_t i2c_peripheral_num) {
+    Sercom *SercomInst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    volatile bustransaction_t *transaction = &sercom_bustrans_buffer[i2c_peripheral_num];
+    volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[i2c_peripheral_num];
     int timeout = 65535;
     int timeout_attempt = 4;
-    while (get_i2c_master_busstate(SercomInst) != 0x1) {
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    /* With an OS the task sleeps until the ISR reports the end of the transaction, the loop below then only sees the STOP go out */
+    while (transaction_in_flight(transaction, retry_state, presence)) {
+        if (!UHAL_OS_BUS_WAIT(UHAL_OS_BUS_SERCOM(i2c_peripheral_num), I2C_HOST_OS_WAIT_TIMEOUT_MS)) {
+            break;
+        }
+    }
+#ifdef UHAL_LOW_POWER_WAIT
+    /* The SCL low timeout guarantees an interrupt (an error at the latest), without it a hanging bus would leave the core asleep */
+    if (SercomInst->I2CM.CTRLA.reg & SERCOM_I2CM_CTRLA_LOWTOUTEN) {
+        IRQ_SLEEP_WHILE(transaction_in_flight(transaction, retry_state, presence));
+    }
+#endif
+    uint8_t retry_cnt = transaction->retry_cnt;
+    uint8_t scan_addr = presence->scan_addr;
+    bool bus_idle = true;
+    while (!bus_available(SercomInst, transaction) || retry_state->pending || presence->scanning) {
+        const bool error_reported = (transaction->transaction_type == SERCOMACT_IDLE_I2CM) && transaction_has_bus_error(transaction);
+        if (retry_cnt != transaction->retry_cnt || scan_addr != presence->scan_addr) {
+            /* Every retry and every probed address gets the full timeout again */
+            retry_cnt = transaction->retry_cnt;
+            scan_addr = presence->scan_addr;
+            timeout = 65535;
+            timeout_attempt = 4;
+        }
         timeout--;
-
-        if (timeout <= 0) {
-            if (--timeout_attempt) {
-                timeout = 65535;
-            } else {
-                return;
+        if (timeout <= 0 && --timeout_attempt) {
+            timeout = 65535;
+        }
+        if (error_reported || timeout_attempt <= 0) {
+            bus_idle = false;
+            break;
+        }
+    }
+    if (!bus_idle) {
+        /* The ISR reports the end of a transaction once it is idle and has no retry pending */
+        const bool done_reported = (transaction->transaction_type == SERCOMACT_IDLE_I2CM) && !retry_state->pending && !presence->scanning;
+        transaction->transaction_type = SERCOMACT_IDLE_I2CM;
+        retry_state->pending = 0;
+        presence->scanning = 0;
+        if (!transaction_has_bus_error(transaction)) {
+            transaction->error_mask |= I2C_ERROR_FLAG_TIMEOUT;
+            transaction->last_error = UHAL_STATUS_I2C_TIMEOUT;
+            if (transaction->first_error == UHAL_STATUS_OK) {
+                transaction->first_error = UHAL_STATUS_I2C_TIMEOUT;
+            }
+            if (transaction->status == UHAL_STATUS_OK) {
+                transaction->status = UHAL_STATUS_I2C_TIMEOUT;
             }
         }
+        const bool recovered = i2c_host_recover_bus(i2c_peripheral_num) == UHAL_STATUS_OK;
+        if (!recovered && get_i2c_master_busstate(SercomInst) == I2C_BUSSTATE_UNKNOWN) {
+            SercomInst->I2CM.STATUS.reg = SERCOM_I2CM_STATUS_BUSSTATE(I2C_BUSSTATE_IDLE);
+            i2c_master_wait_for_sync(SercomInst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+        }
+        if (!done_reported) {
+            /* The ISR never ended this transaction, so a task or coroutine waiting on it is woken here */
+            i2c_host_chained_reads[i2c_peripheral_num].pending = 0;
+            UHAL_OS_BUS_NOTIFY_FROM_ISR(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+            notify_transaction_done(i2c_peripheral_num, (uhal_status_t) transaction->status);
+        }
+        return UHAL_STATUS_I2C_TIMEOUT;
     }
     /**
      * Wait an additional 20 cycles
@@ -107,6 +311,356 @@ void wait_for_idle_busstate(Sercom *SercomInst) {
     do {
         timeout--;
     } while (timeout >= 1);
+    return (int8_t) transaction->status;
+}
+
+/**
+ * @brief Helper function which returns the ADDR.HS flag when the peripheral runs in high-speed mode,
+ *        the SERCOM then sends the master code in fast-mode before switching to high-speed mode for the transaction.
+ */
+static inline uint32_t get_high_speed_addr_flag(const i2c_periph_inst_t i2c_peripheral_num) {
+    return i2c_host_high_speed_mode[i2c_peripheral_num] ? SERCOM_I2CM_ADDR_HS : 0;
+}
+
+/**
+ * @brief Helper function which checks the device-presence cache, a device is known to be absent when the last scan wasn't ACKed.
+ */
+static inline bool device_known_absent(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr) {
+    if (I2C_ADDR_IS_10BIT(addr)) {
+        return false;
+    }
+    const volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    const uint32_t addr_bit = (1UL << (addr % 32));
+    return (presence->probed[addr / 32] & addr_bit) && !(presence->present[addr / 32] & addr_bit);
+}
+
+/**
+ * @brief Helper function which builds the ADDR register value of a transaction.
+ *        10-bit addresses set TENBITEN, the SERCOM then sends both address bytes.
+ */
+static inline uint32_t get_addr_reg_val(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr, const uint8_t read) {
+    const uint32_t ten_bit_en = I2C_ADDR_IS_10BIT(addr) ? SERCOM_I2CM_ADDR_TENBITEN : 0;
+    return (I2C_ADDR_VALUE(addr) << 1) | read | ten_bit_en | get_high_speed_addr_flag(i2c_peripheral_num);
+}
+
+/**
+ * @brief Helper function which converts the error bits of the I2CM status register to a status code.
+ *        A bus error also sets ARBLOST, so it is checked first.
+ */
+static inline uhal_status_t get_polled_error_status(const uint16_t status_reg) {
+    if (status_reg & SERCOM_I2CM_STATUS_BUSERR) {
+        return UHAL_STATUS_I2C_BUSERR;
+    }
+    if (status_reg & SERCOM_I2CM_STATUS_ARBLOST) {
+        return UHAL_STATUS_I2C_ARBSTATE_LOST;
+    }
+    if (status_reg & (SERCOM_I2CM_STATUS_LOWTOUT | SERCOM_I2CM_STATUS_MEXTTOUT | SERCOM_I2CM_STATUS_SEXTTOUT)) {
+        return UHAL_STATUS_I2C_TIMEOUT;
+    }
+    if (status_reg & SERCOM_I2CM_STATUS_LENERR) {
+        return UHAL_STATUS_I2C_LENERR;
+    }
+    return UHAL_STATUS_I2C_NACK;
+}
+
+/**
+ * @brief Helper function which spins on the MB and SB flags of a polled transaction.
+ * @return The MB and SB bits of the INTFLAG register, 0 when neither got set in time.
+ */
+static inline uint8_t polled_wait_for_bus_flag(Sercom *sercom_inst) {
+    uint32_t timeout = I2C_POLLING_TIMEOUT_LOOPS;
+    uint8_t intflag;
+    do {
+        intflag = sercom_inst->I2CM.INTFLAG.reg & (SERCOM_I2CM_INTFLAG_MB | SERCOM_I2CM_INTFLAG_SB);
+    } while (!intflag && --timeout);
+    return intflag;
+}
+
+/**
+ * @brief Helper function which waits for the bus to be idle, or still owned after a transaction without stop bit.
+ *        The bus is recovered when it doesn't get there in time and recovery pins have been set.
+ */
+static uhal_status_t polled_wait_for_bus_available(const i2c_periph_inst_t i2c_peripheral_num, Sercom *sercom_inst) {
+    uint32_t timeout = I2C_POLLING_TIMEOUT_LOOPS;
+    uint8_t busstate;
+    do {
+        busstate = get_i2c_master_busstate(sercom_inst);
+    } while (busstate != I2C_BUSSTATE_IDLE && busstate != I2C_BUSSTATE_OWNER && --timeout);
+    if (timeout) {
+        return UHAL_STATUS_OK;
+    }
+    if (i2c_host_recover_bus(i2c_peripheral_num) == UHAL_STATUS_OK) {
+        return UHAL_STATUS_OK;
+    }
+    return UHAL_STATUS_I2C_TIMEOUT;
+}
+
+/**
+ * @brief Helper function which sends a stop bit, optionally preceded by a NACK when the host is receiving.
+ */
+static inline void polled_send_stop(Sercom *sercom_inst, const uint32_t ackact) {
+    sercom_inst->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN | ackact | SERCOM_I2CM_CTRLB_CMD(3);
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+}
+
+/**
+ * @brief Helper function which ends a polled transaction on an error or a missing bus flag.
+ *        The stop bit is only sent when the host still owns the bus.
+ * @return The status code belonging to the error.
+ */
+static uhal_status_t polled_end_on_error(Sercom *sercom_inst, const uint8_t intflag) {
+    const uint16_t status_reg = sercom_inst->I2CM.STATUS.reg;
+    const uhal_status_t status = intflag ? get_polled_error_status(status_reg) : UHAL_STATUS_I2C_TIMEOUT;
+    if (get_i2c_master_busstate(sercom_inst) == I2C_BUSSTATE_OWNER) {
+        polled_send_stop(sercom_inst, SERCOM_I2CM_CTRLB_ACKACT);
+    }
+    sercom_inst->I2CM.STATUS.reg = status_reg & (I2C_POLLING_ERROR_BITS & ~SERCOM_I2CM_STATUS_RXNACK);
+    sercom_inst->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_MB | SERCOM_I2CM_INTFLAG_SB | SERCOM_I2CM_INTFLAG_ERROR;
+    return status;
+}
+
+/**
+ * @brief Polled write transaction: every MB flag is awaited by reading the INTFLAG register, no interrupt or
+ *        sercom_bustrans_buffer state is involved. The retry policies don't apply to polled transactions.
+ */
+static uhal_status_t polled_write(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                  const uint8_t *write_buff, const size_t size, const i2c_stop_bit_t stop_bit) {
+    Sercom *sercom_inst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    const uhal_status_t bus_status = polled_wait_for_bus_available(i2c_peripheral_num, sercom_inst);
+    if (bus_status != UHAL_STATUS_OK) {
+        return bus_status;
+    }
+    sercom_inst->I2CM.ADDR.reg = get_addr_reg_val(i2c_peripheral_num, addr, 0);
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    for (size_t byte = 0; byte <= size; byte++) {
+        const uint8_t intflag = polled_wait_for_bus_flag(sercom_inst);
+        if (!(intflag & SERCOM_I2CM_INTFLAG_MB) || (sercom_inst->I2CM.STATUS.reg & I2C_POLLING_ERROR_BITS)) {
+            return polled_end_on_error(sercom_inst, intflag);
+        }
+        if (byte == size) {
+            break;
+        }
+        sercom_inst->I2CM.DATA.reg = write_buff[byte];
+        i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    }
+    if (stop_bit) {
+        polled_send_stop(sercom_inst, 0);
+    }
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Polled read transaction, the counterpart of polled_write.
+ *        The NACK is set up before the last byte is read, with SCLSM one byte earlier as the (N)ACK is sent before SB is set.
+ */
+static uhal_status_t polled_read(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                 uint8_t *read_buff, const size_t amount_of_bytes) {
+    Sercom *sercom_inst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    const uhal_status_t bus_status = polled_wait_for_bus_available(i2c_peripheral_num, sercom_inst);
+    if (bus_status != UHAL_STATUS_OK) {
+        return bus_status;
+    }
+    if (I2C_ADDR_IS_10BIT(addr)) {
+        /* Combined format: the write header goes first, the read header follows with a repeated start */
+        sercom_inst->I2CM.ADDR.reg = get_addr_reg_val(i2c_peripheral_num, addr, 0);
+        i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+        const uint8_t intflag = polled_wait_for_bus_flag(sercom_inst);
+        if (!(intflag & SERCOM_I2CM_INTFLAG_MB) || (sercom_inst->I2CM.STATUS.reg & I2C_POLLING_ERROR_BITS)) {
+            return polled_end_on_error(sercom_inst, intflag);
+        }
+    }
+    const bool sclsm = i2c_host_high_speed_mode[i2c_peripheral_num];
+    const uint32_t first_ackact = (sclsm && amount_of_bytes <= 1) ? SERCOM_I2CM_CTRLB_ACKACT : 0;
+    sercom_inst->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN | first_ackact;
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    sercom_inst->I2CM.ADDR.reg = I2C_ADDR_IS_10BIT(addr)
+                                 ? I2C_ADDR_10BIT_READ_HEADER(addr) | get_high_speed_addr_flag(i2c_peripheral_num)
+                                 : get_addr_reg_val(i2c_peripheral_num, addr, 1);
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    for (size_t byte = 0; byte < amount_of_bytes; byte++) {
+        const uint8_t intflag = polled_wait_for_bus_flag(sercom_inst);
+        if (!(intflag & SERCOM_I2CM_INTFLAG_SB) || (sercom_inst->I2CM.STATUS.reg & I2C_POLLING_ERROR_BITS)) {
+            return polled_end_on_error(sercom_inst, intflag);
+        }
+        const bool last_byte = (byte + 1 == amount_of_bytes);
+        const bool nack = sclsm ? (byte + 2 >= amount_of_bytes) : last_byte;
+        if (last_byte) {
+            polled_send_stop(sercom_inst, SERCOM_I2CM_CTRLB_ACKACT);
+        } else if (nack) {
+            sercom_inst->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN | SERCOM_I2CM_CTRLB_ACKACT;
+            i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+        }
+        read_buff[byte] = sercom_inst->I2CM.DATA.reg;
+        i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    }
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Polled bus scan, probes every address in the calling context and fills the device-presence cache.
+ */
+static uhal_status_t polled_scan(const i2c_periph_inst_t i2c_peripheral_num) {
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t word = 0; word < 4; word++) {
+        presence->probed[word] = 0;
+        presence->present[word] = 0;
+    }
+    for (uint8_t addr = I2C_HOST_SCAN_FIRST_ADDR; addr <= I2C_HOST_SCAN_LAST_ADDR; addr++) {
+        const uhal_status_t status = polled_write(i2c_peripheral_num, addr, NULL, 0, I2C_STOP_BIT);
+        if (status != UHAL_STATUS_OK && status != UHAL_STATUS_I2C_NACK) {
+            return status;
+        }
+        const uint32_t addr_bit = (1UL << (addr % 32));
+        presence->probed[addr / 32] |= addr_bit;
+        if (status == UHAL_STATUS_OK) {
+            presence->present[addr / 32] |= addr_bit;
+        }
+    }
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Helper function which captures the retry policy, address and type of a transaction before it is started,
+ *        so the ISR is able to restart it. A device specific policy takes precedence over the policy of the peripheral.
+ */
+static inline void capture_retry_state(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                       const uint32_t addr_reg, const uint8_t transaction_type) {
+    volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[i2c_peripheral_num];
+    retry_state->active_policy = retry_state->default_policy;
+    for (uint8_t slot = 0; slot < I2C_HOST_MAX_DEVICE_RETRY_POLICIES; slot++) {
+        volatile i2c_host_device_retry_policy_t *device_policy = &retry_state->device_policies[slot];
+        if (device_policy->in_use && device_policy->addr == addr) {
+            retry_state->active_policy = device_policy->policy;
+            break;
+        }
+    }
+    retry_state->addr_reg = addr_reg;
+    retry_state->transaction_type = transaction_type;
+    retry_state->pending = 0;
+}
+
+#ifdef I2C_HOST_RETRY_TIMER
+/**
+ * @brief The frequency the retry timer is counting at, 0 when the timer hasn't been started yet.
+ */
+static uint32_t i2c_host_retry_timer_freq;
+static uint8_t i2c_host_retry_timer_gen;
+
+/**
+ * @brief Helper function which starts the free-running retry timer, clocked from the fast clock generator of the peripheral.
+ */
+static void start_retry_timer(const i2c_periph_inst_t i2c_peripheral_num) {
+    if (i2c_host_retry_timer_freq != 0) {
+        return;
+    }
+    PM->APBCMASK.reg |= I2C_HOST_RETRY_TC_APBCMASK;
+    clk_route_generator(I2C_HOST_RETRY_TC_CLKCTRL_ID, i2c_host_fast_clk_gen[i2c_peripheral_num]);
+    I2C_HOST_RETRY_TC->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    while (I2C_HOST_RETRY_TC->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) {};
+    I2C_HOST_RETRY_TC->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_NFRQ | TC_CTRLA_PRESCALER_DIV64;
+    I2C_HOST_RETRY_TC->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    while (I2C_HOST_RETRY_TC->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) {};
+    i2c_host_retry_timer_freq = i2c_host_periph_clk_freq[i2c_peripheral_num] / I2C_HOST_RETRY_TC_PRESCALER;
+    i2c_host_retry_timer_gen = i2c_host_fast_clk_gen[i2c_peripheral_num];
+    enable_irq_handler(I2C_HOST_RETRY_TC_IRQn, 2);
+}
+#endif
+
+/**
+ * @brief Helper function which prepares the retry engine for a peripheral after its retry policy has changed.
+ *        The timer may run from the clock of another peripheral, so the SCL period is converted against the timer frequency.
+ */
+static void prepare_retry_engine(const i2c_periph_inst_t i2c_peripheral_num) {
+#ifdef I2C_HOST_RETRY_TIMER
+    if (i2c_host_baud_rate_freq[i2c_peripheral_num] == 0) {
+        return;
+    }
+    start_retry_timer(i2c_peripheral_num);
+    const uint32_t ticks_per_scl_period = i2c_host_retry_timer_freq / i2c_host_baud_rate_freq[i2c_peripheral_num];
+    i2c_host_retry_states[i2c_peripheral_num].ticks_per_scl_period = ticks_per_scl_period ? ticks_per_scl_period : 1;
+#else
+    (void) i2c_peripheral_num;
+#endif
+}
+
+static inline uint8_t get_i2c_speed_mode(const uint32_t baud_rate_freq) {
+    if (baud_rate_freq <= I2C_FAST_MODE_MAX_FREQ) {
+        return I2C_SPEED_STANDARD_AND_FAST_MODE;
+    }
+    return baud_rate_freq <= I2C_FAST_MODE_PLUS_MAX_FREQ ? I2C_SPEED_FAST_MODE_PLUS : I2C_SPEED_HIGH_SPEED_MODE;
+}
+
+/**
+ * @brief Helper function which calculates the value of the BAUD register using the baud rate calculator of the platform header.
+ *        When the calculator is used with values which are out of range, the fields are limited to what fits in the register.
+ */
+static uint32_t calculate_baud_register(const uint32_t periph_clk_freq, const uint32_t baud_rate_freq) {
+    const uint32_t fast_mode_freq = I2C_HOST_FAST_MODE_FREQ(baud_rate_freq);
+    const int32_t steps = I2C_BAUD_STEPS(periph_clk_freq, fast_mode_freq, I2C_HOST_RISE_TIME_NS);
+    if (steps < 2) {
+        return SERCOM_I2CM_BAUD_BAUD(1);
+    }
+    if (baud_rate_freq <= I2C_STANDARD_MODE_MAX_FREQ) {
+        const uint32_t baud = I2C_BAUD_SYMMETRIC(steps);
+        return SERCOM_I2CM_BAUD_BAUD(baud > 0xFF ? 0xFF : baud);
+    }
+    const uint32_t baud_low = I2C_BAUD_LOW(steps);
+    uint32_t baud_reg = SERCOM_I2CM_BAUD_BAUD(I2C_BAUD_HIGH(steps) > 0xFF ? 0xFF : I2C_BAUD_HIGH(steps)) |
+                        SERCOM_I2CM_BAUD_BAUDLOW(baud_low > 0xFF ? 0xFF : baud_low);
+    if (get_i2c_speed_mode(baud_rate_freq) == I2C_SPEED_HIGH_SPEED_MODE) {
+        const int32_t hs_steps = I2C_HS_BAUD_STEPS(periph_clk_freq, baud_rate_freq);
+        const uint32_t hs_baud_low = hs_steps < 2 ? 1 : I2C_BAUD_LOW(hs_steps);
+        const uint32_t hs_baud_high = hs_steps < 2 ? 1 : I2C_BAUD_HIGH(hs_steps);
+        baud_reg |= SERCOM_I2CM_BAUD_HSBAUD(hs_baud_high > 0xFF ? 0xFF : hs_baud_high) |
+                    SERCOM_I2CM_BAUD_HSBAUDLOW(hs_baud_low > 0xFF ? 0xFF : hs_baud_low);
+    }
+    return baud_reg;
+}
+
+/**
+ * @brief Frequency change handler of the clock system. The BAUD register is enable-protected,
+ *        so it is only marked for recalculation here and rewritten before the next transaction.
+ */
+static void i2c_host_clk_freq_changed(const clk_gen_num_t clk_gen, const uint32_t new_freq) {
+    if (new_freq == 0) {
+        return;
+    }
+    for (uint8_t periph = 0; periph < 6; periph++) {
+        if (i2c_host_baud_rate_freq[periph] != 0 && i2c_host_fast_clk_gen[periph] == clk_gen) {
+            i2c_host_periph_clk_freq[periph] = new_freq;
+            i2c_host_retune_pending[periph] = true;
+        }
+    }
+#ifdef I2C_HOST_RETRY_TIMER
+    if (i2c_host_retry_timer_freq != 0 && i2c_host_retry_timer_gen == clk_gen) {
+        i2c_host_retry_timer_freq = new_freq / I2C_HOST_RETRY_TC_PRESCALER;
+        for (uint8_t periph = 0; periph < 6; periph++) {
+            if (i2c_host_baud_rate_freq[periph] != 0) {
+                prepare_retry_engine(periph);
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Helper function which recalculates the BAUD register after a clock change, only while the bus is idle,
+ *        a transaction without stop bit keeps the old BAUD value until the bus is released.
+ */
+static void apply_pending_retune(const i2c_periph_inst_t i2c_peripheral_num) {
+    Sercom *sercom_inst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    if (!i2c_host_retune_pending[i2c_peripheral_num] || get_i2c_master_busstate(sercom_inst) != I2C_BUSSTATE_IDLE) {
+        return;
+    }
+    i2c_host_retune_pending[i2c_peripheral_num] = false;
+    sercom_inst->I2CM.CTRLA.reg &= ~SERCOM_I2CM_CTRLA_ENABLE;
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_ENABLE);
+    sercom_inst->I2CM.BAUD.reg = calculate_baud_register(i2c_host_periph_clk_freq[i2c_peripheral_num],
+                                                         i2c_host_baud_rate_freq[i2c_peripheral_num]);
+    sercom_inst->I2CM.CTRLA.reg |= SERCOM_I2CM_CTRLA_ENABLE;
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_ENABLE);
+    sercom_inst->I2CM.STATUS.reg = SERCOM_I2CM_STATUS_BUSSTATE(I2C_BUSSTATE_IDLE);
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
 }
 
 static inline uint8_t get_fast_clk_gen_val(const i2c_clock_sources_t clock_sources) {
@@ -138,32 +692,17 @@ uhal_status_t i2c_host_init(const i2c_periph_inst_t i2c_peripheral_num,
                             const uint32_t periph_clk_freq,
                             const uint32_t baud_rate_freq,
                             const i2c_extra_opt_t extra_configuration_options) {
-#ifdef __SAMD51__
-
-#else
-    PM->APBCMASK.reg |= 1 << (PM_APBCMASK_SERCOM0_Pos + i2c_peripheral_num);
-    if (clock_sources != I2C_CLK_SOURCE_USE_DEFAULT) {
-        const uint8_t clk_gen_slow = get_slow_clk_gen_val(clock_sources);
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = get_fast_clk_gen_val(clock_sources);
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + i2c_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    } else {
-        const uint8_t clk_gen_slow = 3;
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = 0;
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + i2c_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
+    uint32_t sercom_clk_freq = periph_clk_freq;
+    const bool default_clocks = (clock_sources == I2C_CLK_SOURCE_USE_DEFAULT);
+    const clk_gen_num_t clk_gen_fast = default_clocks ? CLKGEN_0 : get_fast_clk_gen_val(clock_sources);
+    const clk_gen_num_t clk_gen_slow = default_clocks ? CLKGEN_3 : get_slow_clk_gen_val(clock_sources);
+    clk_enable_sercom_clocks(i2c_peripheral_num, clk_gen_fast, clk_gen_slow);
+    clk_register_freq_change_handler(i2c_host_clk_freq_changed);
+    /* The frequency tracked by the clock system wins, periph_clk_freq is only used when it is unknown */
+    const uint32_t routed_clk_freq = clk_get_peripheral_freq(CLK_CHANNEL_SERCOM_CORE(i2c_peripheral_num));
+    if (routed_clk_freq) {
+        sercom_clk_freq = routed_clk_freq;
     }
-#endif
 
     Sercom *SercomInst = get_sercom_inst(i2c_peripheral_num);
     const bool SercomEnabled = SercomInst->I2CM.CTRLA.bit.ENABLE;
@@ -173,19 +712,27 @@ uhal_status_t i2c_host_init(const i2c_periph_inst_t i2c_peripheral_num,
     SercomInst->I2CM.CTRLA.reg = (SERCOM_I2CM_CTRLA_SWRST | SERCOM_I2CM_CTRLA_MODE(5));
     const uint32_t waitflags = (SERCOM_I2CM_SYNCBUSY_SWRST | SERCOM_I2CM_SYNCBUSY_ENABLE);
     i2c_master_wait_for_sync(SercomInst, waitflags);
-    SercomInst->I2CM.CTRLA.reg = (0 << SERCOM_I2CM_CTRLA_LOWTOUTEN_Pos    /* SCL Low Time-Out: disabled */
-                                  | 0 << SERCOM_I2CM_CTRLA_INACTOUT_Pos   /* Inactive Time-Out: 0 */
-                                  | 0 << SERCOM_I2CM_CTRLA_SCLSM_Pos      /* SCL Clock Stretch Mode: disabled */
-                                  | 0 << SERCOM_I2CM_CTRLA_SPEED_Pos      /* Transfer Speed: 0 */
-                                  | 0 << SERCOM_I2CM_CTRLA_SEXTTOEN_Pos   /* Slave SCL Low Extend Time-Out: disabled */
-                                  | 0 << SERCOM_I2CM_CTRLA_MEXTTOEN_Pos   /* Master SCL Low Extend Time-Out: 0 */
+    const uint8_t low_timeout_en = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_LOW_TIMEOUT) ? 1 : 0;
+    const uint8_t inactive_timeout = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_INACTIVE_TIMEOUT_205US) >> 2;
+    const uint8_t master_ext_timeout_en = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_MASTER_EXT_TIMEOUT) ? 1 : 0;
+    const uint8_t slave_ext_timeout_en = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_SLAVE_EXT_TIMEOUT) ? 1 : 0;
+    const uint8_t run_in_standby = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_RUN_IN_STANDBY) ? 1 : 0;
+    const uint8_t speed_mode = get_i2c_speed_mode(baud_rate_freq);
+    /* High-speed mode requires the SCL clock stretch mode in which SCL is stretched after the acknowledge bit */
+    const uint8_t sclsm = (speed_mode == I2C_SPEED_HIGH_SPEED_MODE) ? 1 : 0;
+    SercomInst->I2CM.CTRLA.reg = (low_timeout_en << SERCOM_I2CM_CTRLA_LOWTOUTEN_Pos          /* SCL Low Time-Out */
+                                  | inactive_timeout << SERCOM_I2CM_CTRLA_INACTOUT_Pos       /* Inactive Time-Out */
+                                  | sclsm << SERCOM_I2CM_CTRLA_SCLSM_Pos                     /* SCL Clock Stretch Mode */
+                                  | speed_mode << SERCOM_I2CM_CTRLA_SPEED_Pos                /* Transfer Speed */
+                                  | slave_ext_timeout_en << SERCOM_I2CM_CTRLA_SEXTTOEN_Pos   /* Slave SCL Low Extend Time-Out */
+                                  | master_ext_timeout_en << SERCOM_I2CM_CTRLA_MEXTTOEN_Pos  /* Master SCL Low Extend Time-Out */
                                   | 0b10 << SERCOM_I2CM_CTRLA_SDAHOLD_Pos /* SDA Hold Time: 0 */
                                   | 0 << SERCOM_I2CM_CTRLA_PINOUT_Pos     /* Pin Usage: disabled */
-                                  | 0 << SERCOM_I2CM_CTRLA_RUNSTDBY_Pos   /* Run In Standby: disabled */
+                                  | run_in_standby << SERCOM_I2CM_CTRLA_RUNSTDBY_Pos /* Run In Standby */
                                   | 5 << SERCOM_I2CM_CTRLA_MODE_Pos);
 
     i2c_master_wait_for_sync(SercomInst, SERCOM_I2CM_SYNCBUSY_MASK);
-    SercomInst->I2CM.BAUD.reg = calculate_baudrate(periph_clk_freq, baud_rate_freq);
+    SercomInst->I2CM.BAUD.reg = calculate_baud_register(sercom_clk_freq, baud_rate_freq);
     int timeout = 65535;
     int timeout_attempt = 4;
     SercomInst->I2CM.CTRLA.reg |= SERCOM_I2CM_CTRLA_ENABLE;
@@ -204,15 +751,30 @@ uhal_status_t i2c_host_init(const i2c_periph_inst_t i2c_peripheral_num,
             i2c_master_wait_for_sync(SercomInst, SERCOM_I2CM_SYNCBUSY_SYSOP);
         }
     }
-    SercomInst->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_MB | SERCOM_I2CM_INTENSET_SB;
+    const bool polling = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_POLLING);
+    i2c_host_polling_mode[i2c_peripheral_num] = polling;
+    i2c_host_retune_pending[i2c_peripheral_num] = false;
+    i2c_host_periph_clk_freq[i2c_peripheral_num] = sercom_clk_freq;
+    i2c_host_baud_rate_freq[i2c_peripheral_num] = baud_rate_freq;
+    i2c_host_high_speed_mode[i2c_peripheral_num] = (speed_mode == I2C_SPEED_HIGH_SPEED_MODE);
+    i2c_host_fast_clk_gen[i2c_peripheral_num] = (clock_sources != I2C_CLK_SOURCE_USE_DEFAULT) ? get_fast_clk_gen_val(clock_sources) : 0;
+    sercom_bustrans_buffer[i2c_peripheral_num].transaction_type = SERCOMACT_IDLE_I2CM;
+    sercom_bustrans_buffer[i2c_peripheral_num].instance_num = i2c_peripheral_num;
+    UHAL_OS_BUS_INIT(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
 
-    const enum IRQn irq_type = (SERCOM0_IRQn + i2c_peripheral_num);
-    NVIC_EnableIRQ(irq_type);
+    const IRQn_Type irq_type = SERCOM_FIRST_IRQn(i2c_peripheral_num);
+    if (polling) {
+        /* Polled transactions read the flags themselves, so the SERCOM interrupt stays off */
+        SercomInst->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB | SERCOM_I2CM_INTENCLR_SB | SERCOM_I2CM_INTENCLR_ERROR;
+        disable_irq_handlers(irq_type, SERCOM_IRQ_LINES);
+        return UHAL_STATUS_OK;
+    }
+    SercomInst->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_MB | SERCOM_I2CM_INTENSET_SB | SERCOM_I2CM_INTENSET_ERROR;
     const uint16_t irq_options = extra_configuration_options >> 8;
     if (irq_options) {
-        enable_irq_handler(irq_type, irq_options - 1);
+        enable_irq_handlers(irq_type, SERCOM_IRQ_LINES, irq_options - 1);
     } else {
-        enable_irq_handler(irq_type, 2);
+        enable_irq_handlers(irq_type, SERCOM_IRQ_LINES, 2);
     }
     return UHAL_STATUS_OK;
 }
@@ -223,62 +785,339 @@ uhal_status_t i2c_host_deinit(const i2c_periph_inst_t i2c_peripheral_num) {
     return UHAL_STATUS_OK;
 }
 
-uhal_status_t i2c_host_write_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
-                                          const uint16_t addr,
-                                          const uint8_t *write_buff,
-                                          const size_t size,
-                                          const i2c_stop_bit_t stop_bit) {
+/**
+ * @brief Helper function which hands a write transaction to the ISR, or runs it in polling mode.
+ * @param chained_read_buff The buffer of the read which follows the write with a repeated start, NULL for a plain write
+ * @param chained_read_size The amount of bytes of the chained read
+ */
+static uhal_status_t start_write_transaction(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                             const uint8_t *write_buff, const size_t size, const i2c_stop_bit_t stop_bit,
+                                             uint8_t *chained_read_buff, const size_t chained_read_size) {
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    if (i2c_host_polling_mode[i2c_peripheral_num]) {
+        apply_pending_retune(i2c_peripheral_num);
+        uhal_status_t status = polled_write(i2c_peripheral_num, addr, write_buff, size, stop_bit);
+        if (status == UHAL_STATUS_OK && chained_read_buff != NULL) {
+            status = polled_read(i2c_peripheral_num, addr, chained_read_buff, chained_read_size);
+        }
+        notify_transaction_done(i2c_peripheral_num, status);
+        return status;
+    }
     Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
-    wait_for_idle_busstate(sercom_inst);
+    const uhal_status_t bus_status = wait_for_idle_busstate(i2c_peripheral_num);
+    if (bus_status == UHAL_STATUS_I2C_TIMEOUT && !bus_available(sercom_inst, &sercom_bustrans_buffer[i2c_peripheral_num])) {
+        return UHAL_STATUS_I2C_TIMEOUT;
+    }
+    apply_pending_retune(i2c_peripheral_num);
     volatile bustransaction_t *TransactionData = &sercom_bustrans_buffer[i2c_peripheral_num];
-    while ((sercom_inst->I2CM.STATUS.bit.BUSSTATE != 0x1) &&
-           sercom_bustrans_buffer[i2c_peripheral_num].transaction_type != SERCOMACT_NONE
-           && sercom_inst->I2CM.INTFLAG.reg == 0);
+    volatile i2c_host_chained_read_t *chained_read = &i2c_host_chained_reads[i2c_peripheral_num];
+    chained_read->addr = addr;
+    chained_read->read_buffer = chained_read_buff;
+    chained_read->size = chained_read_size;
+    chained_read->pending = (chained_read_buff != NULL);
     i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
     TransactionData->write_buffer = write_buff;
     TransactionData->buf_size = size;
+    reset_transaction_info(TransactionData);
     TransactionData->transaction_type = stop_bit ? SERCOMACT_I2C_DATA_TRANSMIT_STOP
                                                  : SERCOMACT_I2C_DATA_TRANSMIT_NO_STOP;
     TransactionData->buf_cnt = 0;
-    sercom_inst->I2CM.ADDR.reg = (addr << 1);
+    const uint32_t addr_reg = get_addr_reg_val(i2c_peripheral_num, addr, 0);
+    capture_retry_state(i2c_peripheral_num, addr, addr_reg, TransactionData->transaction_type);
+    sercom_inst->I2CM.ADDR.reg = addr_reg;
     i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
-    return TransactionData->status;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_write_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                          const uint16_t addr,
+                                          const uint8_t *write_buff,
+                                          const size_t size,
+                                          const i2c_stop_bit_t stop_bit) {
+    return start_write_transaction(i2c_peripheral_num, addr, write_buff, size, stop_bit, NULL, 0);
+}
+
+/**
+ * @brief Helper function which waits for a transaction started by a blocking function, and gives the bus back to the other tasks.
+ * @param start_status The status of starting the transaction
+ */
+static uhal_status_t finish_blocking_transaction(const i2c_periph_inst_t i2c_peripheral_num, uhal_status_t start_status) {
+    if (start_status == UHAL_STATUS_OK && !i2c_host_polling_mode[i2c_peripheral_num]) {
+        start_status = wait_for_idle_busstate(i2c_peripheral_num);
+    }
+    UHAL_OS_BUS_UNLOCK(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+    return start_status;
 }
 
 uhal_status_t i2c_host_write_blocking(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
                                       const uint8_t *write_buff, const size_t size,
                                       const i2c_stop_bit_t stop_bit) {
-    Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
-    uhal_status_t status = i2c_host_write_non_blocking(i2c_peripheral_num, addr, write_buff, size, stop_bit);
-    wait_for_idle_busstate(sercom_inst);
-    return status;
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+    const uhal_status_t status = i2c_host_write_non_blocking(i2c_peripheral_num, addr, write_buff, size, stop_bit);
+    return finish_blocking_transaction(i2c_peripheral_num, status);
 }
 
 uhal_status_t i2c_host_read_blocking(const i2c_periph_inst_t i2c_peripheral_num,
                                      const uint16_t addr, uint8_t *read_buff,
                                      const size_t amount_of_bytes) {
-    volatile bustransaction_t *TransactionData = &sercom_bustrans_buffer[i2c_peripheral_num];
-    i2c_host_read_non_blocking(i2c_peripheral_num, addr, read_buff, amount_of_bytes);
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+    const uhal_status_t status = i2c_host_read_non_blocking(i2c_peripheral_num, addr, read_buff, amount_of_bytes);
+    return finish_blocking_transaction(i2c_peripheral_num, status);
+}
+
+/**
+ * @brief Helper function which hands a read transaction to the ISR. When the host still owns the bus
+ *        (after a write without stop) writing the ADDR register sends a repeated start.
+ */
+static void start_read_transaction(const i2c_periph_inst_t i2c_peripheral_num,
+                                   const uint16_t addr, uint8_t *read_buff,
+                                   const size_t amount_of_bytes) {
     Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
-    wait_for_idle_busstate(sercom_inst);
-    return TransactionData->status;
+    volatile bustransaction_t *TransactionData = &sercom_bustrans_buffer[i2c_peripheral_num];
+    i2c_host_chained_reads[i2c_peripheral_num].pending = 0;
+    i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
+    TransactionData->read_buffer = read_buff;
+    TransactionData->buf_size = amount_of_bytes;
+    reset_transaction_info(TransactionData);
+    TransactionData->buf_cnt = 0;
+    /* A 10-bit read uses the combined format: the write header is sent first, the ISR then sends a repeated start with the read header */
+    const bool ten_bit_addr = I2C_ADDR_IS_10BIT(addr);
+    TransactionData->transaction_type = ten_bit_addr ? SERCOMACT_I2C_10BIT_READ_HEADER : SERCOMACT_I2C_DATA_RECEIVE_STOP;
+    const uint32_t addr_reg = get_addr_reg_val(i2c_peripheral_num, addr, ten_bit_addr ? 0 : 1);
+    capture_retry_state(i2c_peripheral_num, addr, addr_reg, TransactionData->transaction_type);
+    if (i2c_host_high_speed_mode[i2c_peripheral_num]) {
+        /* With SCLSM the (N)ACK is sent before the byte interrupt, so a single byte read has to be NACKed up front */
+        const uint32_t ackact = (amount_of_bytes <= 1) ? SERCOM_I2CM_CTRLB_ACKACT : 0;
+        sercom_inst->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN | ackact;
+        i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
+    }
+    sercom_inst->I2CM.ADDR.reg = addr_reg;
+    i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
 }
 
 uhal_status_t i2c_host_read_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
                                          const uint16_t addr, uint8_t *read_buff,
                                          const size_t amount_of_bytes) {
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    if (i2c_host_polling_mode[i2c_peripheral_num]) {
+        apply_pending_retune(i2c_peripheral_num);
+        const uhal_status_t status = polled_read(i2c_peripheral_num, addr, read_buff, amount_of_bytes);
+        notify_transaction_done(i2c_peripheral_num, status);
+        return status;
+    }
+    Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
+    const uhal_status_t bus_status = wait_for_idle_busstate(i2c_peripheral_num);
+    if (bus_status == UHAL_STATUS_I2C_TIMEOUT && !bus_available(sercom_inst, &sercom_bustrans_buffer[i2c_peripheral_num])) {
+        return UHAL_STATUS_I2C_TIMEOUT;
+    }
+    apply_pending_retune(i2c_peripheral_num);
+    start_read_transaction(i2c_peripheral_num, addr, read_buff, amount_of_bytes);
+    return UHAL_STATUS_OK;
+}
 
+uhal_status_t i2c_host_write_read_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t *write_buff,
+                                               const size_t write_size,
+                                               uint8_t *read_buff,
+                                               const size_t read_size) {
+    /* The host still owns the bus after the write, the ISR starts the read (with a repeated start) as soon as the write finished */
+    return start_write_transaction(i2c_peripheral_num, addr, write_buff, write_size, I2C_NO_STOP_BIT, read_buff, read_size);
+}
+
+uhal_status_t i2c_host_write_read_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                           const uint16_t addr,
+                                           const uint8_t *write_buff,
+                                           const size_t write_size,
+                                           uint8_t *read_buff,
+                                           const size_t read_size) {
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+    const uhal_status_t status = i2c_host_write_read_non_blocking(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size);
+    return finish_blocking_transaction(i2c_peripheral_num, status);
+}
+
+void i2c_host_transaction_done(volatile bustransaction_t *transaction) {
+    const i2c_periph_inst_t i2c_peripheral_num = (i2c_periph_inst_t) transaction->instance_num;
+    volatile i2c_host_chained_read_t *chained_read = &i2c_host_chained_reads[i2c_peripheral_num];
+    if (chained_read->pending) {
+        chained_read->pending = 0;
+        if (transaction->status == UHAL_STATUS_OK) {
+            start_read_transaction(i2c_peripheral_num, chained_read->addr, chained_read->read_buffer, chained_read->size);
+            return;
+        }
+    }
+    UHAL_OS_BUS_NOTIFY_FROM_ISR(UHAL_OS_BUS_SERCOM(i2c_peripheral_num));
+    notify_transaction_done(i2c_peripheral_num, (uhal_status_t) transaction->status);
+}
+
+uhal_status_t i2c_host_set_transaction_done_callback(const i2c_periph_inst_t i2c_peripheral_num,
+                                                     const i2c_host_transaction_done_cb_t transaction_done_cb) {
+    i2c_host_transaction_done_callbacks[i2c_peripheral_num] = transaction_done_cb;
+    return UHAL_STATUS_OK;
+}
+
+i2c_transaction_info_t i2c_host_get_transaction_info(const i2c_periph_inst_t i2c_peripheral_num) {
+    const volatile bustransaction_t *transaction = &sercom_bustrans_buffer[i2c_peripheral_num];
+    const i2c_transaction_info_t info = {
+            .status = (uhal_status_t) transaction->status,
+            .first_error = (uhal_status_t) transaction->first_error,
+            .last_error = (uhal_status_t) transaction->last_error,
+            .error_mask = transaction->error_mask,
+            .nack_offset = transaction->nack_offset,
+            .retry_cnt = transaction->retry_cnt
+    };
+    return info;
+}
+
+uhal_status_t i2c_host_set_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                        const uint8_t max_retries,
+                                        const uint16_t backoff_scl_periods,
+                                        const uint8_t retry_on) {
+    if (!I2C_HOST_RETRY_BACKOFF_SUPPORTED && backoff_scl_periods != 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    volatile i2c_host_retry_policy_t *policy = &i2c_host_retry_states[i2c_peripheral_num].default_policy;
+    policy->max_retries = max_retries;
+    policy->backoff_scl_periods = backoff_scl_periods;
+    policy->retry_on = retry_on;
+    prepare_retry_engine(i2c_peripheral_num);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_set_device_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t max_retries,
+                                               const uint16_t backoff_scl_periods,
+                                               const uint8_t retry_on) {
+    if (!I2C_HOST_RETRY_BACKOFF_SUPPORTED && backoff_scl_periods != 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[i2c_peripheral_num];
+    volatile i2c_host_device_retry_policy_t *free_slot = NULL;
+    for (uint8_t slot = 0; slot < I2C_HOST_MAX_DEVICE_RETRY_POLICIES; slot++) {
+        volatile i2c_host_device_retry_policy_t *device_policy = &retry_state->device_policies[slot];
+        if (device_policy->in_use && device_policy->addr == addr) {
+            free_slot = device_policy;
+            break;
+        }
+        if (!device_policy->in_use && free_slot == NULL) {
+            free_slot = device_policy;
+        }
+    }
+    if (free_slot == NULL) {
+        return UHAL_STATUS_ERROR;
+    }
+    free_slot->addr = addr;
+    free_slot->policy.max_retries = max_retries;
+    free_slot->policy.backoff_scl_periods = backoff_scl_periods;
+    free_slot->policy.retry_on = retry_on;
+    free_slot->in_use = 1;
+    prepare_retry_engine(i2c_peripheral_num);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_scan(const i2c_periph_inst_t i2c_peripheral_num) {
+    if (i2c_host_polling_mode[i2c_peripheral_num]) {
+        apply_pending_retune(i2c_peripheral_num);
+        return polled_scan(i2c_peripheral_num);
+    }
     Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
-    wait_for_idle_busstate(sercom_inst);
+    const uhal_status_t bus_status = wait_for_idle_busstate(i2c_peripheral_num);
+    if (bus_status == UHAL_STATUS_I2C_TIMEOUT && !bus_available(sercom_inst, &sercom_bustrans_buffer[i2c_peripheral_num])) {
+        return UHAL_STATUS_I2C_TIMEOUT;
+    }
+    apply_pending_retune(i2c_peripheral_num);
     volatile bustransaction_t *TransactionData = &sercom_bustrans_buffer[i2c_peripheral_num];
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
     i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
-    TransactionData->read_buffer = read_buff;
-    TransactionData->buf_size = amount_of_bytes;
-    TransactionData->transaction_type = SERCOMACT_I2C_DATA_RECEIVE_STOP;
+    reset_transaction_info(TransactionData);
+    /* Probes are never retried, a NACK is the answer the scanner is looking for */
+    i2c_host_retry_states[i2c_peripheral_num].active_policy.max_retries = 0;
+    i2c_host_chained_reads[i2c_peripheral_num].pending = 0;
+    for (uint8_t word = 0; word < 4; word++) {
+        presence->probed[word] = 0;
+        presence->present[word] = 0;
+    }
+    presence->addr_flags = get_high_speed_addr_flag(i2c_peripheral_num);
+    presence->scan_addr = I2C_HOST_SCAN_FIRST_ADDR;
+    presence->scanning = 1;
+    TransactionData->write_buffer = NULL;
+    TransactionData->buf_size = 0;
     TransactionData->buf_cnt = 0;
-    sercom_inst->I2CM.ADDR.reg = (addr << 1) | 1;
+    TransactionData->transaction_type = SERCOMACT_I2C_SCAN;
+    sercom_inst->I2CM.ADDR.reg = (I2C_HOST_SCAN_FIRST_ADDR << 1) | presence->addr_flags;
     i2c_master_wait_for_sync((sercom_inst), SERCOM_I2CM_SYNCBUSY_SYSOP);
-    return TransactionData->status;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_get_scan_results(const i2c_periph_inst_t i2c_peripheral_num, uint8_t *presence_bitmap) {
+    const volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t byte = 0; byte < 16; byte++) {
+        presence_bitmap[byte] = (presence->present[byte / 4] >> ((byte % 4) * 8)) & 0xFF;
+    }
+    return presence->scanning ? UHAL_STATUS_PERIPHERAL_IN_USE_WARNING : UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_invalidate_presence_cache(const i2c_periph_inst_t i2c_peripheral_num) {
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t word = 0; word < 4; word++) {
+        presence->probed[word] = 0;
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_set_bus_recovery_pins(const i2c_periph_inst_t i2c_peripheral_num,
+                                             const gpio_pin_t scl_pin,
+                                             const gpio_pin_t sda_pin) {
+    i2c_bus_recovery_pins_t *recovery_pins = &i2c_host_recovery_pins[i2c_peripheral_num];
+    recovery_pins->scl_pin = scl_pin;
+    recovery_pins->sda_pin = sda_pin;
+    recovery_pins->configured = 1;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_recover_bus(const i2c_periph_inst_t i2c_peripheral_num) {
+    const i2c_bus_recovery_pins_t *recovery_pins = &i2c_host_recovery_pins[i2c_peripheral_num];
+    if (!recovery_pins->configured) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    Sercom *sercom_inst = get_sercom_inst(i2c_peripheral_num);
+    const gpio_pin_t scl_pin = recovery_pins->scl_pin;
+    const gpio_pin_t sda_pin = recovery_pins->sda_pin;
+    const gpio_mode_t scl_pin_mode = gpio_get_pin_mode(scl_pin);
+    const gpio_mode_t sda_pin_mode = gpio_get_pin_mode(sda_pin);
+
+    /* Take the pins from the SERCOM and clock SCL until the stuck client releases SDA */
+    recovery_release_line(sda_pin);
+    recovery_release_line(scl_pin);
+    for (uint8_t pulse = 0; pulse < I2C_RECOVERY_CLOCK_PULSES && gpio_get_pin_lvl(sda_pin) == GPIO_LOW; pulse++) {
+        recovery_pull_line_low(scl_pin);
+        recovery_half_period_delay();
+        recovery_release_line(scl_pin);
+        recovery_half_period_delay();
+    }
+
+    /* Generate a STOP condition: SDA goes high while SCL is high */
+    recovery_pull_line_low(scl_pin);
+    recovery_half_period_delay();
+    recovery_pull_line_low(sda_pin);
+    recovery_half_period_delay();
+    recovery_release_line(scl_pin);
+    recovery_half_period_delay();
+    recovery_release_line(sda_pin);
+    recovery_half_period_delay();
+    const bool bus_released = (gpio_get_pin_lvl(sda_pin) == GPIO_HIGH && gpio_get_pin_lvl(scl_pin) == GPIO_HIGH);
+
+    /* Give the pins back to the SERCOM and force its bus-state to idle */
+    gpio_set_pin_mode(scl_pin, scl_pin_mode);
+    gpio_set_pin_mode(sda_pin, sda_pin_mode);
+    sercom_inst->I2CM.STATUS.reg = SERCOM_I2CM_STATUS_BUSSTATE(I2C_BUSSTATE_IDLE);
+    i2c_master_wait_for_sync(sercom_inst, SERCOM_I2CM_SYNCBUSY_SYSOP);
+    return bus_released ? UHAL_STATUS_OK : UHAL_STATUS_I2C_TIMEOUT;
 }
 
 #endif /* DISABLE_I2C_HOST_MODULE */
\ No newline at end of file
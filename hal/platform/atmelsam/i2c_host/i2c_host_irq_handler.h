@@ -35,23 +35,225 @@
 #include <sam.h>
 #include "irq/sercom_stuff.h"
 #include "error_handling.h"
+#include "hal_i2c_host.h"
 
 /**
  * @brief Macros used in ISR for acknowledging and finishing the transaction
  * SERCOM_I2C_MASTER_RECV_ACK_AND_REQ_NEW_BYTE will send an acknowledgment bit to the slave device and request the next byte to read
+ * (in high-speed mode the acknowledge action set in the same write applies to the next byte)
  * SERCOM_I2C_MASTER_NACK_AND_STOP will send a NACK to the slave device and stops the transaction by sending a stop bit.
  */
 #define SERCOM_I2C_MASTER_RECV_ACK_AND_REQ_NEW_BYTE SERCOM_I2CM_CTRLB_CMD(2) | SERCOM_I2CM_CTRLB_SMEN
 #define SERCOM_I2C_MASTER_NACK_AND_STOP             SERCOM_I2CM_CTRLB_CMD(3) | SERCOM_I2CM_CTRLB_ACKACT | SERCOM_I2CM_CTRLB_SMEN
 
 
-void update_i2c_host_bus_transaction_state(Sercom *sercom_instance, volatile bustransaction_t *transaction) {
-    transaction->status = ((sercom_instance->I2CM.STATUS.bit.RXNACK) * UHAL_STATUS_I2C_NACK);
-    transaction->status = ((sercom_instance->I2CM.STATUS.bit.LENERR) * UHAL_STATUS_I2C_LENERR);
-    transaction->status = ((sercom_instance->I2CM.STATUS.bit.ARBLOST) * UHAL_STATUS_I2C_ARBSTATE_LOST);
-    transaction->status = ((sercom_instance->I2CM.STATUS.bit.BUSERR) * UHAL_STATUS_I2C_BUSERR);
+/**
+ * @brief All error bits of the I2CM status register, writing them clears the error.
+ */
+#define SERCOM_I2C_MASTER_STATUS_ERRORS                                                                                                              \
+    (SERCOM_I2CM_STATUS_BUSERR | SERCOM_I2CM_STATUS_ARBLOST | SERCOM_I2CM_STATUS_LOWTOUT | SERCOM_I2CM_STATUS_MEXTTOUT                               \
+     | SERCOM_I2CM_STATUS_SEXTTOUT | SERCOM_I2CM_STATUS_LENERR)
+#define SERCOM_I2C_MASTER_STATUS_TIMEOUTS (SERCOM_I2CM_STATUS_LOWTOUT | SERCOM_I2CM_STATUS_MEXTTOUT | SERCOM_I2CM_STATUS_SEXTTOUT)
+#define SERCOM_I2C_MASTER_STOP           SERCOM_I2CM_CTRLB_CMD(3) | SERCOM_I2CM_CTRLB_SMEN
+#define SERCOM_I2C_MASTER_BUSSTATE_OWNER 0x2
+
+/**
+ * @brief Records an error in the transaction info, the status of the transaction is the first error of its last attempt.
+ * @param transaction The transaction to record the error in
+ * @param error_flag The i2c_error_flag_t flag of the error
+ * @param error The status code belonging to the error
+ */
+static inline void record_i2c_host_transaction_error(volatile bustransaction_t *transaction, const uint8_t error_flag,
+                                                     const uhal_status_t error) {
+    transaction->error_mask |= error_flag;
+    if (transaction->first_error == UHAL_STATUS_OK) {
+        transaction->first_error = error;
+    }
+    transaction->last_error = error;
+    if (transaction->status == UHAL_STATUS_OK) {
+        transaction->status = error;
+    }
+}
+
+/**
+ * @brief Collects every error reported by the I2CM status register into the transaction info.
+ * @param sercom_instance The SERCOM peripheral the transaction is running on
+ * @param transaction The current transaction information
+ * @return The i2c_error_flag_t flags of the errors which were found, 0 when there were none
+ */
+uint8_t update_i2c_host_bus_transaction_state(Sercom *sercom_instance, volatile bustransaction_t *transaction) {
+    const uint16_t bus_status = sercom_instance->I2CM.STATUS.reg;
+    uint8_t found_errors = 0;
+    if (bus_status & SERCOM_I2CM_STATUS_RXNACK) {
+        /* buf_cnt is only zero when the client NACKed its address */
+        if (transaction->buf_cnt == 0) {
+            found_errors |= I2C_ERROR_FLAG_ADDR_NACK;
+            record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_ADDR_NACK, UHAL_STATUS_I2C_NACK);
+        } else {
+            transaction->nack_offset = transaction->buf_cnt - 1;
+            found_errors |= I2C_ERROR_FLAG_DATA_NACK;
+            record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_DATA_NACK, UHAL_STATUS_I2C_NACK);
+        }
+    }
+    if (bus_status & SERCOM_I2C_MASTER_STATUS_TIMEOUTS) {
+        found_errors |= I2C_ERROR_FLAG_TIMEOUT;
+        record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_TIMEOUT, UHAL_STATUS_I2C_TIMEOUT);
+    }
+    if (bus_status & SERCOM_I2CM_STATUS_BUSERR) {
+        found_errors |= I2C_ERROR_FLAG_BUSERR;
+        record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_BUSERR, UHAL_STATUS_I2C_BUSERR);
+    }
+    if (bus_status & SERCOM_I2CM_STATUS_ARBLOST) {
+        found_errors |= I2C_ERROR_FLAG_ARBLOST;
+        record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_ARBLOST, UHAL_STATUS_I2C_ARBSTATE_LOST);
+    }
+    if (bus_status & SERCOM_I2CM_STATUS_LENERR) {
+        found_errors |= I2C_ERROR_FLAG_LENERR;
+        record_i2c_host_transaction_error(transaction, I2C_ERROR_FLAG_LENERR, UHAL_STATUS_I2C_LENERR);
+    }
+    return found_errors;
+}
+
+/**
+ * @brief Restarts the transaction captured in the retry state by writing its address register again.
+ *        When the host lost arbitration the SERCOM waits for the bus to become idle before it sends the START condition.
+ */
+static inline void i2c_host_restart_transaction(Sercom *sercom_instance, volatile bustransaction_t *transaction,
+                                                volatile i2c_host_retry_state_t *retry_state) {
+    while (sercom_instance->I2CM.SYNCBUSY.reg & SERCOM_I2CM_SYNCBUSY_SYSOP) {};
+    const bool sclsm = sercom_instance->I2CM.CTRLA.reg & SERCOM_I2CM_CTRLA_SCLSM;
+    if (sclsm && retry_state->transaction_type == SERCOMACT_I2C_DATA_RECEIVE_STOP && transaction->buf_size <= 1) {
+        sercom_instance->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN | SERCOM_I2CM_CTRLB_ACKACT;
+        while (sercom_instance->I2CM.SYNCBUSY.reg & SERCOM_I2CM_SYNCBUSY_SYSOP) {};
+    }
+    transaction->status = UHAL_STATUS_OK;
+    transaction->buf_cnt = 0;
+    transaction->transaction_type = retry_state->transaction_type;
+    sercom_instance->I2CM.ADDR.reg = retry_state->addr_reg;
+}
+
+#ifdef I2C_HOST_RETRY_TIMER
+
+static Sercom *const i2c_host_retry_sercom_table[6] = {SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5};
+
+static inline uint16_t i2c_host_retry_timer_count(void) {
+    I2C_HOST_RETRY_TC->COUNT16.READREQ.reg = TC_READREQ_RREQ | TC_READREQ_ADDR(TC_COUNT16_COUNT_OFFSET);
+    while (I2C_HOST_RETRY_TC->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) {};
+    return I2C_HOST_RETRY_TC->COUNT16.COUNT.reg;
+}
+
+/**
+ * @brief Restarts every transaction of which the backoff has passed and arms the compare channel for the next one.
+ *        The timer is free-running, deadlines are compared wrap-around safe.
+ */
+static void i2c_host_retry_timer_service(void) {
+    bool deadline_passed;
+    do {
+        const uint16_t now = i2c_host_retry_timer_count();
+        bool next_pending = false;
+        uint16_t next_deadline = 0;
+        for (uint8_t periph = 0; periph < 6; periph++) {
+            volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[periph];
+            if (!retry_state->pending) {
+                continue;
+            }
+            if ((int16_t) (now - retry_state->deadline) >= 0) {
+                retry_state->pending = 0;
+                i2c_host_restart_transaction(i2c_host_retry_sercom_table[periph], &sercom_bustrans_buffer[periph], retry_state);
+            } else if (!next_pending || (int16_t) (retry_state->deadline - next_deadline) < 0) {
+                next_pending = true;
+                next_deadline = retry_state->deadline;
+            }
+        }
+        if (!next_pending) {
+            I2C_HOST_RETRY_TC->COUNT16.INTENCLR.reg = TC_INTENCLR_MC0;
+            return;
+        }
+        I2C_HOST_RETRY_TC->COUNT16.CC[0].reg = next_deadline;
+        while (I2C_HOST_RETRY_TC->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) {};
+        I2C_HOST_RETRY_TC->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+        I2C_HOST_RETRY_TC->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+        /* The deadline could have passed while the compare channel was being written */
+        deadline_passed = (int16_t) (i2c_host_retry_timer_count() - next_deadline) >= 0;
+    } while (deadline_passed);
+}
+
+/**
+ * @brief Interrupt handler of the retry timer, gets called when the nearest backoff deadline was reached.
+ */
+void i2c_host_retry_timer_irq(void) {
+    I2C_HOST_RETRY_TC->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    i2c_host_retry_timer_service();
 }
 
+#endif
+
+/**
+ * @brief Retries a failed transaction when its errors are retryable and the policy has retries left.
+ *        With a retry timer the transaction is restarted after the (exponential) backoff, otherwise it is restarted right away.
+ * @param sercom_instance The SERCOM peripheral the transaction is running on
+ * @param transaction The failed transaction
+ * @param found_errors The i2c_error_flag_t flags of the errors which ended the transaction
+ */
+static inline void i2c_host_retry_failed_transaction(Sercom *sercom_instance, volatile bustransaction_t *transaction,
+                                                     const uint8_t found_errors) {
+    volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[transaction->instance_num];
+    const uint8_t retry_on = retry_state->active_policy.retry_on;
+    const bool retryable = found_errors && (found_errors & ~retry_on) == 0;
+    if (!retryable || transaction->retry_cnt >= retry_state->active_policy.max_retries) {
+        return;
+    }
+#ifdef I2C_HOST_RETRY_TIMER
+    uint32_t backoff_ticks = (uint32_t) retry_state->active_policy.backoff_scl_periods * retry_state->ticks_per_scl_period;
+    backoff_ticks <<= (transaction->retry_cnt > 15 ? 15 : transaction->retry_cnt);
+    if (backoff_ticks > INT16_MAX) {
+        backoff_ticks = INT16_MAX;
+    }
+    transaction->retry_cnt++;
+    if (backoff_ticks != 0) {
+        NVIC_DisableIRQ(I2C_HOST_RETRY_TC_IRQn);
+        retry_state->deadline = i2c_host_retry_timer_count() + backoff_ticks;
+        retry_state->pending = 1;
+        i2c_host_retry_timer_service();
+        NVIC_EnableIRQ(I2C_HOST_RETRY_TC_IRQn);
+        return;
+    }
+#else
+    transaction->retry_cnt++;
+#endif
+    i2c_host_restart_transaction(sercom_instance, transaction, retry_state);
+}
+
+/**
+ * @brief Ends the current transaction after an error, a STOP is only sent when the host still owns the bus.
+ *        The transaction is restarted when the retry policy allows it.
+ */
+static inline void end_i2c_host_transaction_on_error(Sercom *sercom_instance, volatile bustransaction_t *transaction,
+                                                     const uint8_t found_errors) {
+    const uint16_t bus_status = sercom_instance->I2CM.STATUS.reg;
+    sercom_instance->I2CM.STATUS.reg = (bus_status & SERCOM_I2C_MASTER_STATUS_ERRORS);
+    const bool still_owns_bus = ((bus_status & SERCOM_I2CM_STATUS_BUSSTATE_Msk) >> SERCOM_I2CM_STATUS_BUSSTATE_Pos)
+                                == SERCOM_I2C_MASTER_BUSSTATE_OWNER;
+    if (still_owns_bus) {
+        sercom_instance->I2CM.CTRLB.reg = SERCOM_I2C_MASTER_STOP;
+    }
+    sercom_instance->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR | SERCOM_I2CM_INTFLAG_MB | SERCOM_I2CM_INTFLAG_SB;
+    transaction->transaction_type = SERCOMACT_IDLE_I2CM;
+    transaction->buf_cnt = 0;
+    i2c_host_retry_failed_transaction(sercom_instance, transaction, found_errors);
+}
+
+
+/**
+ * @brief Reports the end of a transaction to the driver, called by the SERCOM ISR after the I2C host handlers.
+ *        A transaction which waits for a retry has not ended yet.
+ * @param transaction The transaction information of the SERCOM
+ */
+static inline void i2c_host_check_transaction_done(volatile bustransaction_t *transaction) {
+    if (transaction->transaction_type == SERCOMACT_IDLE_I2CM && !i2c_host_retry_states[transaction->instance_num].pending) {
+        i2c_host_transaction_done(transaction);
+    }
+}
 
 /**
  * @brief Default IRQ Handler for the I2C master data send interrupt
@@ -60,6 +262,11 @@ void update_i2c_host_bus_transaction_state(Sercom *sercom_instance, volatile bus
  */
 void i2c_host_data_send_irq(const void *hw, volatile bustransaction_t *transaction) {
     Sercom *sercom_instance = ((Sercom *) hw);
+    const uint8_t found_errors = update_i2c_host_bus_transaction_state(sercom_instance, transaction);
+    if (found_errors) {
+        end_i2c_host_transaction_on_error(sercom_instance, transaction, found_errors);
+        return;
+    }
     const bool write_buffer_exists = (transaction->write_buffer != NULL);
     const bool has_bytes_left_to_write = (transaction->buf_cnt < transaction->buf_size);
     if (write_buffer_exists && has_bytes_left_to_write) {
@@ -74,23 +281,94 @@ void i2c_host_data_send_irq(const void *hw, volatile bustransaction_t *transacti
         transaction->transaction_type = SERCOMACT_IDLE_I2CM;
         transaction->buf_cnt = 0;
     }
-    update_i2c_host_bus_transaction_state(sercom_instance, transaction);
 }
 
 
 void i2c_host_data_recv_irq(const void *hw, volatile bustransaction_t *transaction) {
     Sercom *sercom_instance = ((Sercom *) hw);
+    /* On a read the MB flag is only set when the address phase failed, or when the write header of a 10-bit read was sent */
+    const bool master_on_bus = sercom_instance->I2CM.INTFLAG.reg & SERCOM_I2CM_INTFLAG_MB;
+    const bool ten_bit_header_sent = master_on_bus && transaction->transaction_type == SERCOMACT_I2C_10BIT_READ_HEADER;
+    const uint8_t found_errors = update_i2c_host_bus_transaction_state(sercom_instance, transaction);
+    if (found_errors || (master_on_bus && !ten_bit_header_sent)) {
+        end_i2c_host_transaction_on_error(sercom_instance, transaction, found_errors);
+        return;
+    }
+    if (ten_bit_header_sent) {
+        /* Combined format: a repeated start with the read header, which only holds the first address byte.
+         * addr_reg is the write header of the transaction (also used by a retry), the address sits above the R/W bit */
+        volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[transaction->instance_num];
+        transaction->transaction_type = SERCOMACT_I2C_DATA_RECEIVE_STOP;
+        sercom_instance->I2CM.ADDR.reg = I2C_ADDR_10BIT_READ_HEADER(retry_state->addr_reg >> 1)
+                                         | (retry_state->addr_reg & SERCOM_I2CM_ADDR_HS);
+        return;
+    }
     if (transaction->read_buffer != NULL && transaction->buf_cnt < transaction->buf_size) {
         transaction->read_buffer[transaction->buf_cnt++] = sercom_instance->I2CM.DATA.reg;
         const bool last_byte_read = transaction->buf_cnt >= transaction->buf_size;
+        /* With SCLSM (high-speed mode) the (N)ACK of a byte is sent before its interrupt, so the NACK is set one byte ahead */
+        const bool sclsm = sercom_instance->I2CM.CTRLA.reg & SERCOM_I2CM_CTRLA_SCLSM;
+        const bool nack_next_byte = sclsm && (transaction->buf_cnt + 1) >= transaction->buf_size;
         sercom_instance->I2CM.CTRLB.reg = last_byte_read ? SERCOM_I2C_MASTER_NACK_AND_STOP :
+                                          nack_next_byte ? SERCOM_I2C_MASTER_RECV_ACK_AND_REQ_NEW_BYTE | SERCOM_I2CM_CTRLB_ACKACT :
                                           SERCOM_I2C_MASTER_RECV_ACK_AND_REQ_NEW_BYTE;
     } else {
         sercom_instance->I2CM.CTRLB.reg = SERCOM_I2C_MASTER_NACK_AND_STOP;
         transaction->transaction_type = SERCOMACT_IDLE_I2CM;
         transaction->buf_cnt = 0;
     }
-    update_i2c_host_bus_transaction_state(sercom_instance, transaction);
+}
+
+/**
+ * @brief Default IRQ Handler for the I2C master error interrupt
+ * @param hw Pointer to the HW peripheral to be manipulated
+ * @param transaction The current transaction information
+ */
+void i2c_host_error_irq(const void *hw, volatile bustransaction_t *transaction) {
+    Sercom *sercom_instance = ((Sercom *) hw);
+    const uint8_t found_errors = update_i2c_host_bus_transaction_state(sercom_instance, transaction);
+    end_i2c_host_transaction_on_error(sercom_instance, transaction, found_errors);
+}
+
+/**
+ * @brief Default IRQ Handler for the I2C host bus scanner.
+ *        Stores whether the probed address was ACKed, ends the probe with a STOP and starts probing the next address.
+ *        When the host lost arbitration the same address is probed again, any other error aborts the scan.
+ * @param hw Pointer to the HW peripheral to be manipulated
+ * @param transaction The current transaction information
+ */
+void i2c_host_scan_irq(const void *hw, volatile bustransaction_t *transaction) {
+    Sercom *sercom_instance = ((Sercom *) hw);
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[transaction->instance_num];
+    const uint16_t bus_status = sercom_instance->I2CM.STATUS.reg;
+    const bool error_occurred = sercom_instance->I2CM.INTFLAG.reg & SERCOM_I2CM_INTFLAG_ERROR;
+    if (error_occurred && (bus_status & SERCOM_I2C_MASTER_STATUS_ERRORS) != SERCOM_I2CM_STATUS_ARBLOST) {
+        i2c_host_error_irq(hw, transaction);
+        presence->scanning = 0;
+        return;
+    }
+    const uint8_t addr = presence->scan_addr;
+    if (error_occurred) {
+        sercom_instance->I2CM.STATUS.reg = SERCOM_I2CM_STATUS_ARBLOST;
+        sercom_instance->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR | SERCOM_I2CM_INTFLAG_MB;
+    } else {
+        const uint32_t addr_bit = (1UL << (addr % 32));
+        presence->probed[addr / 32] |= addr_bit;
+        if (bus_status & SERCOM_I2CM_STATUS_RXNACK) {
+            presence->present[addr / 32] &= ~addr_bit;
+        } else {
+            presence->present[addr / 32] |= addr_bit;
+        }
+        sercom_instance->I2CM.CTRLB.reg = SERCOM_I2C_MASTER_STOP;
+        if (addr >= I2C_HOST_SCAN_LAST_ADDR) {
+            presence->scanning = 0;
+            transaction->transaction_type = SERCOMACT_IDLE_I2CM;
+            return;
+        }
+        presence->scan_addr = addr + 1;
+    }
+    while (sercom_instance->I2CM.SYNCBUSY.reg & SERCOM_I2CM_SYNCBUSY_SYSOP) {};
+    sercom_instance->I2CM.ADDR.reg = (presence->scan_addr << 1) | presence->addr_flags;
 }
 
 #endif
\ No newline at end of file
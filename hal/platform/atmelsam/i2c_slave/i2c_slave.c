@@ -27,10 +27,26 @@
 #include <stdbool.h>
 #include <hal_i2c_slave.h>
 #include "irq/irq_bindings.h"
+#include "hal_dma.h"
 
 static Sercom *i2c_slave_peripheral_mapping_table[6] = {SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5};
 #define SERCOM_SLOW_CLOCK_SOURCE(x)               (x >> 8)
 
+/**
+ * @brief Register-map state for each SERCOM, used by the default i2c slave IRQ handlers.
+ */
+volatile i2c_slave_reg_map_t i2c_slave_reg_maps[6];
+
+/**
+ * @brief DMA state for each SERCOM, used by the default i2c slave IRQ handlers.
+ */
+volatile i2c_slave_dma_t i2c_slave_dma[6];
+
+/**
+ * @brief Per-address handlers and register maps for each SERCOM, used by the default i2c slave IRQ handlers.
+ */
+volatile i2c_slave_addr_state_t i2c_slave_addr_states[6];
+
 /**
  * @brief Helper function which waits for the SERCOM peripheral to get in sync and finish requested operations.
  *        By continually reading its I2CS syncbusy register.
@@ -66,41 +82,72 @@ static inline Sercom *get_sercom_inst(const i2c_periph_inst_t peripheral_inst_nu
     return i2c_slave_peripheral_mapping_table[peripheral_inst_num];
 }
 
+/**
+ * @brief Helper function which (re)configures a register map in a way that is safe against the ISR using it.
+ */
+static void configure_reg_map(volatile i2c_slave_reg_map_t *reg_map, volatile uint8_t *registers, const uint8_t *write_masks,
+                              const uint16_t amount_of_regs, const i2c_slave_reg_change_cb_t reg_change_cb) {
+    /* The ISR only uses the map when amount_of_regs is non-zero, so clear it first and set it last */
+    reg_map->amount_of_regs = 0;
+    reg_map->registers = registers;
+    reg_map->write_masks = write_masks;
+    reg_map->reg_change_cb = reg_change_cb;
+    reg_map->reg_ptr = 0;
+    reg_map->reg_ptr_received = 0;
+    reg_map->first_changed_reg = 0;
+    reg_map->amount_of_changed_regs = 0;
+    reg_map->amount_of_regs = (registers != NULL) ? amount_of_regs : 0;
+}
+
+/**
+ * @brief Helper function which finds the slot used for given address, or allocates a free one.
+ * @return The slot number or I2C_SLAVE_NO_ADDRESS_SLOT when all slots are in use.
+ */
+static uint8_t get_address_slot(const i2c_periph_inst_t i2c_instance, const uint16_t addr) {
+    volatile i2c_slave_addr_state_t *addr_state = &i2c_slave_addr_states[i2c_instance];
+    const uint16_t slave_addr = I2C_ADDR_VALUE(addr);
+    uint8_t free_slot = I2C_SLAVE_NO_ADDRESS_SLOT;
+    for (uint8_t slot = 0; slot < I2C_SLAVE_MAX_ADDRESS_HANDLERS; slot++) {
+        if (addr_state->slots[slot].in_use && addr_state->slots[slot].addr == slave_addr) {
+            return slot;
+        }
+        if (!addr_state->slots[slot].in_use && free_slot == I2C_SLAVE_NO_ADDRESS_SLOT) {
+            free_slot = slot;
+        }
+    }
+    if (free_slot != I2C_SLAVE_NO_ADDRESS_SLOT) {
+        addr_state->slots[free_slot].handler = NULL;
+        configure_reg_map(&addr_state->slots[free_slot].reg_map, NULL, NULL, 0, NULL);
+        addr_state->slots[free_slot].addr = slave_addr;
+        addr_state->slots[free_slot].in_use = 1;
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Helper function which releases an address slot when it no longer has a handler or register map.
+ */
+static void release_unused_address_slot(const i2c_periph_inst_t i2c_instance, const uint8_t slot) {
+    volatile i2c_slave_addr_slot_t *addr_slot = &i2c_slave_addr_states[i2c_instance].slots[slot];
+    if (addr_slot->handler == NULL && addr_slot->reg_map.amount_of_regs == 0) {
+        addr_slot->in_use = 0;
+    }
+}
+
 uhal_status_t i2c_slave_init(const i2c_periph_inst_t i2c_instance,
                              const uint16_t slave_addr,
                              const i2c_clock_sources_t clock_sources,
                              const i2c_extra_opt_t extra_configuration_options) {
-    const bool InvalidSercomInstNum = (i2c_instance < 0 || i2c_instance);
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
     //const bool InvalidClockGen = (i2c_instance->clk_gen_slow < 0 || i2c_instance->clk_gen_slow > 6 || i2c_instance->clk_gen_fast < 0 || i2c_instance->clk_gen_fast > 6);
     if (InvalidSercomInstNum) {
         return UHAL_STATUS_INVALID_PARAMETERS;
     }
 // Set the clock system
-#ifdef __SAMD51__
-
-#else
-    if (clock_sources != I2C_CLK_SOURCE_USE_DEFAULT) {
-        const uint8_t clk_gen_slow = get_slow_clk_gen_val(clock_sources);
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = get_fast_clk_gen_val(clock_sources);
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + i2c_instance) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    } else {
-        const uint8_t clk_gen_slow = 3;
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = 0;
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + i2c_instance) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    }
-#endif
+    const bool default_clocks = (clock_sources == I2C_CLK_SOURCE_USE_DEFAULT);
+    const clk_gen_num_t clk_gen_fast = default_clocks ? CLKGEN_0 : get_fast_clk_gen_val(clock_sources);
+    const clk_gen_num_t clk_gen_slow = default_clocks ? CLKGEN_3 : get_slow_clk_gen_val(clock_sources);
+    clk_enable_sercom_clocks(i2c_instance, clk_gen_fast, clk_gen_slow);
     Sercom *SercomInst = get_sercom_inst(i2c_instance);
     const bool SercomEnabled = SercomInst->I2CM.CTRLA.bit.ENABLE;
     if (SercomEnabled) {
@@ -108,29 +155,36 @@ uhal_status_t i2c_slave_init(const i2c_periph_inst_t i2c_instance,
     }
     SercomInst->I2CS.CTRLA.reg = (SERCOM_I2CS_CTRLA_SWRST | SERCOM_I2CS_CTRLA_MODE(4));
     i2c_slave_wait_for_sync(SercomInst, SERCOM_I2CS_SYNCBUSY_SWRST);
+    /* With RUNSTDBY set an address match wakes the device from standby, without it receptions in standby are dropped */
+    const uint8_t run_in_standby = BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_RUN_IN_STANDBY) ? 1 : 0;
     SercomInst->I2CS.CTRLA.reg = (1 << SERCOM_I2CS_CTRLA_LOWTOUTEN_Pos      /* SCL Low Time-Out: disabled */
                                   | 0 << SERCOM_I2CS_CTRLA_SCLSM_Pos    /* SCL Clock Stretch Mode: disabled */
                                   | 0 << SERCOM_I2CS_CTRLA_SPEED_Pos    /* Transfer Speed: 0 */
                                   | 1 << SERCOM_I2CS_CTRLA_SEXTTOEN_Pos /* Slave SCL Low Extend Time-Out: disabled */
                                   | 0b10 << SERCOM_I2CS_CTRLA_SDAHOLD_Pos  /* SDA Hold Time: 0 */
                                   | 0 << SERCOM_I2CS_CTRLA_PINOUT_Pos   /* Pin Usage: disabled */
-                                  | 0 << SERCOM_I2CS_CTRLA_RUNSTDBY_Pos /* Run In Standby: disabled */
+                                  | run_in_standby << SERCOM_I2CS_CTRLA_RUNSTDBY_Pos /* Run In Standby */
                                   | 4 << SERCOM_I2CS_CTRLA_MODE_Pos);
     SercomInst->I2CS.CTRLB.reg |= SERCOM_I2CS_CTRLB_SMEN;
     i2c_slave_wait_for_sync(SercomInst, SERCOM_I2CS_SYNCBUSY_MASK);
+    const uint8_t ten_bit_en = I2C_ADDR_IS_10BIT(slave_addr) ? 1 : 0;
     SercomInst->I2CS.ADDR.reg = (0 << SERCOM_I2CS_ADDR_ADDRMASK_Pos       /* Address Mask: 0 */
-                                 | 0 << SERCOM_I2CS_ADDR_TENBITEN_Pos /* Ten Bit Addressing Enable: disabled */
+                                 | ten_bit_en << SERCOM_I2CS_ADDR_TENBITEN_Pos /* Ten Bit Addressing Enable */
                                  | 0 << SERCOM_I2CS_ADDR_GENCEN_Pos   /* General Call Address Enable: disabled */
-                                 | (slave_addr) << SERCOM_I2CS_ADDR_ADDR_Pos);
+                                 | I2C_ADDR_VALUE(slave_addr) << SERCOM_I2CS_ADDR_ADDR_Pos);
+    volatile bustransaction_t *TransactionData = &sercom_bustrans_buffer[i2c_instance];
+    TransactionData->instance_num = i2c_instance;
+    TransactionData->transaction_type = SERCOMACT_IDLE_I2CS;
+    i2c_slave_addr_states[i2c_instance].active_slot = I2C_SLAVE_NO_ADDRESS_SLOT;
     SercomInst->I2CS.CTRLA.reg |= SERCOM_I2CS_CTRLA_ENABLE;
-    SercomInst->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_AMATCH | SERCOM_I2CS_INTENSET_PREC | SERCOM_I2CS_INTENSET_DRDY;
-    const enum IRQn irq_type = (SERCOM0_IRQn + i2c_instance);
-    NVIC_EnableIRQ(irq_type);
+    const bool DMAModeEnabled = i2c_slave_dma[i2c_instance].enabled;
+    SercomInst->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_AMATCH | SERCOM_I2CS_INTENSET_PREC | (DMAModeEnabled ? 0 : SERCOM_I2CS_INTENSET_DRDY);
+    const IRQn_Type irq_type = SERCOM_FIRST_IRQn(i2c_instance);
     const uint16_t irq_options = extra_configuration_options >> 8;
     if (irq_options) {
-        enable_irq_handler(irq_type, irq_options - 1);
+        enable_irq_handlers(irq_type, SERCOM_IRQ_LINES, irq_options - 1);
     } else {
-        enable_irq_handler(irq_type, 2);
+        enable_irq_handlers(irq_type, SERCOM_IRQ_LINES, 2);
     }
     return UHAL_STATUS_OK;
 }
@@ -138,6 +192,166 @@ uhal_status_t i2c_slave_init(const i2c_periph_inst_t i2c_instance,
 uhal_status_t i2c_slave_deinit(const i2c_periph_inst_t i2c_instance) {
     Sercom *sercom_inst = get_sercom_inst(i2c_instance);
     disable_i2c_interface(sercom_inst);
+    sercom_bustrans_buffer[i2c_instance].transaction_type = SERCOMACT_NONE;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_slave_set_register_map(const i2c_periph_inst_t i2c_instance,
+                                         volatile uint8_t *registers,
+                                         const uint8_t *write_masks,
+                                         const uint16_t amount_of_regs,
+                                         const i2c_slave_reg_change_cb_t reg_change_cb) {
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
+    const bool InvalidRegisterAmount = (amount_of_regs > 256);
+    if (InvalidSercomInstNum || InvalidRegisterAmount) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    configure_reg_map(&i2c_slave_reg_maps[i2c_instance], registers, write_masks, amount_of_regs, reg_change_cb);
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Called by the DMA ISR when a slave rx or tx buffer has been completely used.
+ *        From then on the DRDY interrupt is used to NACK extra written bytes or pad extra read bytes.
+ * @param dma_channel The DMA channel which finished
+ * @param status The status of the DMA transfer
+ */
+static void i2c_slave_dma_buffer_done(const dma_channel_t dma_channel, const uhal_status_t status) {
+    for (uint8_t i2c_instance = I2C_PERIPHERAL_0; i2c_instance <= I2C_PERIPHERAL_5; i2c_instance++) {
+        volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[i2c_instance];
+        const bool rx_channel_done = (slave_dma->active_direction == I2C_SLAVE_DMA_DIR_RECEIVED && slave_dma->rx_channel == dma_channel);
+        const bool tx_channel_done = (slave_dma->active_direction == I2C_SLAVE_DMA_DIR_TRANSMITTED && slave_dma->tx_channel == dma_channel);
+        if (!slave_dma->enabled || !(rx_channel_done || tx_channel_done)) {
+            continue;
+        }
+        Sercom *SercomInst = get_sercom_inst(i2c_instance);
+        slave_dma->buffer_exhausted = 1;
+        if (rx_channel_done) {
+            SercomInst->I2CS.CTRLB.reg |= SERCOM_I2CS_CTRLB_ACKACT;
+        }
+        SercomInst->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_DRDY;
+    }
+}
+
+uhal_status_t i2c_slave_set_dma(const i2c_periph_inst_t i2c_instance,
+                                const dma_channel_t rx_channel,
+                                uint8_t *rx_buffer,
+                                const size_t rx_size,
+                                const dma_channel_t tx_channel,
+                                const uint8_t *tx_buffer,
+                                const size_t tx_size,
+                                const i2c_slave_dma_done_cb_t transfer_done_cb) {
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
+    const bool InvalidDMAChannels = (rx_channel == tx_channel);
+    const bool InvalidBufferSize = (rx_size > 0xFFFF || tx_size > 0xFFFF);
+    if (InvalidSercomInstNum || InvalidDMAChannels || InvalidBufferSize) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[i2c_instance];
+    slave_dma->enabled = 0;
+    slave_dma->active_direction = I2C_SLAVE_DMA_DIR_NONE;
+    slave_dma->buffer_exhausted = 0;
+    slave_dma->rx_channel = rx_channel;
+    slave_dma->rx_buffer = rx_buffer;
+    slave_dma->rx_size = (rx_buffer != NULL) ? rx_size : 0;
+    slave_dma->tx_channel = tx_channel;
+    slave_dma->tx_buffer = tx_buffer;
+    slave_dma->tx_size = (tx_buffer != NULL) ? tx_size : 0;
+    slave_dma->transfer_done_cb = transfer_done_cb;
+    dma_set_transfer_done_callback(DMA_PERIPHERAL_0, rx_channel, i2c_slave_dma_buffer_done);
+    dma_set_transfer_done_callback(DMA_PERIPHERAL_0, tx_channel, i2c_slave_dma_buffer_done);
+    /* Bytes are moved by the DMA controller, the CPU only gets the address match and stop interrupts */
+    Sercom *SercomInst = get_sercom_inst(i2c_instance);
+    SercomInst->I2CS.INTENCLR.reg = SERCOM_I2CS_INTENCLR_DRDY;
+    slave_dma->enabled = 1;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_slave_disable_dma(const i2c_periph_inst_t i2c_instance) {
+    volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[i2c_instance];
+    if (!slave_dma->enabled) {
+        return UHAL_STATUS_OK;
+    }
+    slave_dma->enabled = 0;
+    dma_abort_transfer(DMA_PERIPHERAL_0, slave_dma->rx_channel);
+    dma_abort_transfer(DMA_PERIPHERAL_0, slave_dma->tx_channel);
+    dma_set_transfer_done_callback(DMA_PERIPHERAL_0, slave_dma->rx_channel, NULL);
+    dma_set_transfer_done_callback(DMA_PERIPHERAL_0, slave_dma->tx_channel, NULL);
+    slave_dma->active_direction = I2C_SLAVE_DMA_DIR_NONE;
+    Sercom *SercomInst = get_sercom_inst(i2c_instance);
+    SercomInst->I2CS.CTRLB.reg &= ~SERCOM_I2CS_CTRLB_ACKACT;
+    SercomInst->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_DRDY;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_slave_set_addressing(const i2c_periph_inst_t i2c_instance,
+                                       const i2c_slave_addr_mode_t addr_mode,
+                                       const uint16_t slave_addr,
+                                       const uint16_t second_addr_or_mask,
+                                       const i2c_slave_addr_opt_t addr_opt) {
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
+    const bool InvalidAddrMode = (addr_mode > I2C_SLAVE_ADDR_MODE_RANGE);
+    const bool InvalidRange = (addr_mode == I2C_SLAVE_ADDR_MODE_RANGE && I2C_ADDR_VALUE(slave_addr) > I2C_ADDR_VALUE(second_addr_or_mask));
+    /* On a 10-bit address match only the header is in DATA, so the matched address is only known with a single address */
+    const bool InvalidTenBitMode = I2C_ADDR_IS_10BIT(slave_addr)
+                                   && (addr_mode != I2C_SLAVE_ADDR_MODE_MASK || I2C_ADDR_VALUE(second_addr_or_mask) != 0);
+    if (InvalidSercomInstNum || InvalidAddrMode || InvalidRange || InvalidTenBitMode) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    Sercom *SercomInst = get_sercom_inst(i2c_instance);
+    /* CTRLB.AMODE is enable-protected */
+    const bool SercomEnabled = SercomInst->I2CS.CTRLA.bit.ENABLE;
+    if (SercomEnabled) {
+        disable_i2c_interface(SercomInst);
+    }
+    const uint8_t general_call_en = (addr_opt & I2C_SLAVE_ADDR_OPT_GENERAL_CALL) ? 1 : 0;
+    SercomInst->I2CS.CTRLB.reg = (SercomInst->I2CS.CTRLB.reg & ~SERCOM_I2CS_CTRLB_AMODE_Msk) | SERCOM_I2CS_CTRLB_AMODE(addr_mode);
+    /* In range mode the ADDRMASK field holds the upper limit of the range */
+    const uint8_t ten_bit_en = I2C_ADDR_IS_10BIT(slave_addr) ? 1 : 0;
+    SercomInst->I2CS.ADDR.reg = (I2C_ADDR_VALUE(second_addr_or_mask) << SERCOM_I2CS_ADDR_ADDRMASK_Pos  /* Address Mask, second address or upper limit */
+                                 | ten_bit_en << SERCOM_I2CS_ADDR_TENBITEN_Pos                     /* Ten Bit Addressing Enable */
+                                 | general_call_en << SERCOM_I2CS_ADDR_GENCEN_Pos                  /* General Call Address Enable */
+                                 | I2C_ADDR_VALUE(slave_addr) << SERCOM_I2CS_ADDR_ADDR_Pos);
+    if (SercomEnabled) {
+        SercomInst->I2CS.CTRLA.reg |= SERCOM_I2CS_CTRLA_ENABLE;
+        i2c_slave_wait_for_sync(SercomInst, SERCOM_I2CS_SYNCBUSY_ENABLE);
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_slave_set_address_handler(const i2c_periph_inst_t i2c_instance,
+                                            const uint16_t slave_addr,
+                                            const i2c_slave_addr_handler_t addr_handler) {
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
+    if (InvalidSercomInstNum) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const uint8_t slot = get_address_slot(i2c_instance, slave_addr);
+    if (slot == I2C_SLAVE_NO_ADDRESS_SLOT) {
+        return UHAL_STATUS_ERROR;
+    }
+    i2c_slave_addr_states[i2c_instance].slots[slot].handler = addr_handler;
+    release_unused_address_slot(i2c_instance, slot);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_slave_set_address_register_map(const i2c_periph_inst_t i2c_instance,
+                                                 const uint16_t slave_addr,
+                                                 volatile uint8_t *registers,
+                                                 const uint8_t *write_masks,
+                                                 const uint16_t amount_of_regs,
+                                                 const i2c_slave_reg_change_cb_t reg_change_cb) {
+    const bool InvalidSercomInstNum = (i2c_instance < I2C_PERIPHERAL_0 || i2c_instance > I2C_PERIPHERAL_5);
+    const bool InvalidRegisterAmount = (amount_of_regs > 256);
+    if (InvalidSercomInstNum || InvalidRegisterAmount) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const uint8_t slot = get_address_slot(i2c_instance, slave_addr);
+    if (slot == I2C_SLAVE_NO_ADDRESS_SLOT) {
+        return UHAL_STATUS_ERROR;
+    }
+    configure_reg_map(&i2c_slave_addr_states[i2c_instance].slots[slot].reg_map, registers, write_masks, amount_of_regs, reg_change_cb);
+    release_unused_address_slot(i2c_instance, slot);
     return UHAL_STATUS_OK;
 }
 
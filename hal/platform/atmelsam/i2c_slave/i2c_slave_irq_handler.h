@@ -27,40 +27,248 @@
 
 #include <stdbool.h>
 #include <sam.h>
+#include "i2c_common/i2c_platform_specific.h"
+#include "hal_dma.h"
 
+/**
+ * @brief Command used in the send ISR when the host NACKed the last byte.
+ *        Waits for a (repeated) start condition and releases the bus.
+ */
+#define SERCOM_I2C_SLAVE_WAIT_FOR_START SERCOM_I2CS_CTRLB_CMD(2) | SERCOM_I2CS_CTRLB_SMEN
+
+/**
+ * @brief Value transmitted when the host reads past the end of the DMA tx buffer.
+ */
+#define I2C_SLAVE_DMA_PADDING_BYTE 0xFF
+
+static inline bool i2c_slave_dma_active(volatile i2c_slave_dma_t *slave_dma) {
+    return slave_dma->enabled;
+}
+
+/**
+ * @brief Ends the currently running DMA transfer (if any) and reports the amount of transferred bytes to the user.
+ */
+static inline void i2c_slave_dma_finish_transfer(Sercom *sercom_instance, volatile bustransaction_t *transaction,
+                                                 volatile i2c_slave_dma_t *slave_dma) {
+    const i2c_slave_dma_dir_t direction = slave_dma->active_direction;
+    if (direction == I2C_SLAVE_DMA_DIR_NONE) {
+        return;
+    }
+    const bool received = (direction == I2C_SLAVE_DMA_DIR_RECEIVED);
+    const dma_channel_t dma_channel = received ? slave_dma->rx_channel : slave_dma->tx_channel;
+    const size_t buffer_size = received ? slave_dma->rx_size : slave_dma->tx_size;
+    size_t amount_of_bytes = buffer_size;
+    if (!slave_dma->buffer_exhausted) {
+        dma_abort_transfer(DMA_PERIPHERAL_0, dma_channel);
+        amount_of_bytes = buffer_size - dma_get_remaining_transfer_count(DMA_PERIPHERAL_0, dma_channel);
+    }
+    slave_dma->active_direction = I2C_SLAVE_DMA_DIR_NONE;
+    slave_dma->buffer_exhausted = 0;
+    sercom_instance->I2CS.INTENCLR.reg = SERCOM_I2CS_INTENCLR_DRDY;
+    sercom_instance->I2CS.CTRLB.reg &= ~SERCOM_I2CS_CTRLB_ACKACT;
+    if (slave_dma->transfer_done_cb != NULL) {
+        slave_dma->transfer_done_cb(transaction->instance_num, direction, amount_of_bytes);
+    }
+}
+
+/**
+ * @brief Arms the rx or tx DMA channel for the transfer which just got addressed by the host.
+ *        When no buffer is available the DRDY interrupt is used to NACK or pad every byte.
+ */
+static inline void i2c_slave_dma_start_transfer(Sercom *sercom_instance, volatile bustransaction_t *transaction,
+                                                volatile i2c_slave_dma_t *slave_dma, const bool isReadTransaction) {
+    const dma_peripheral_location_t sercom_location = (dma_peripheral_location_t) transaction->instance_num;
+    slave_dma->buffer_exhausted = 0;
+    if (isReadTransaction && slave_dma->tx_size) {
+        dma_set_transfer_mem_to_peripheral(DMA_PERIPHERAL_0, slave_dma->tx_channel, slave_dma->tx_buffer, sercom_location,
+                                           slave_dma->tx_size, DMA_OPT_IRQ_TRANSFER_COMPLETE);
+        slave_dma->active_direction = I2C_SLAVE_DMA_DIR_TRANSMITTED;
+    } else if (!isReadTransaction && slave_dma->rx_size) {
+        dma_set_transfer_peripheral_to_mem(DMA_PERIPHERAL_0, slave_dma->rx_channel, sercom_location, slave_dma->rx_buffer,
+                                           slave_dma->rx_size, DMA_OPT_IRQ_TRANSFER_COMPLETE);
+        slave_dma->active_direction = I2C_SLAVE_DMA_DIR_RECEIVED;
+    } else {
+        slave_dma->buffer_exhausted = 1;
+        slave_dma->active_direction = isReadTransaction ? I2C_SLAVE_DMA_DIR_TRANSMITTED : I2C_SLAVE_DMA_DIR_RECEIVED;
+        if (!isReadTransaction) {
+            sercom_instance->I2CS.CTRLB.reg |= SERCOM_I2CS_CTRLB_ACKACT;
+        }
+        sercom_instance->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_DRDY;
+    }
+}
+
+/**
+ * @brief Returns the register map of the address matched by the current transaction,
+ *        or the default register map when that address has no map of its own.
+ */
+static inline volatile i2c_slave_reg_map_t *i2c_slave_get_reg_map(const uint8_t instance_num) {
+    volatile i2c_slave_addr_state_t *addr_state = &i2c_slave_addr_states[instance_num];
+    const uint8_t active_slot = addr_state->active_slot;
+    if (active_slot < I2C_SLAVE_MAX_ADDRESS_HANDLERS && addr_state->slots[active_slot].reg_map.amount_of_regs) {
+        return &addr_state->slots[active_slot].reg_map;
+    }
+    return &i2c_slave_reg_maps[instance_num];
+}
+
+/**
+ * @brief Looks up the address slot which belongs to the matched address.
+ */
+static inline uint8_t i2c_slave_find_address_slot(volatile i2c_slave_addr_state_t *addr_state, const uint16_t matched_addr) {
+    for (uint8_t slot = 0; slot < I2C_SLAVE_MAX_ADDRESS_HANDLERS; slot++) {
+        if (addr_state->slots[slot].in_use && addr_state->slots[slot].addr == matched_addr) {
+            return slot;
+        }
+    }
+    return I2C_SLAVE_NO_ADDRESS_SLOT;
+}
+
+static inline bool i2c_slave_reg_map_active(volatile i2c_slave_reg_map_t *reg_map) {
+    return reg_map->amount_of_regs != 0;
+}
+
+static inline void i2c_slave_reg_map_increment_ptr(volatile i2c_slave_reg_map_t *reg_map) {
+    reg_map->reg_ptr = (reg_map->reg_ptr + 1) % reg_map->amount_of_regs;
+}
 
 void i2c_slave_data_recv_irq(const void *const hw, volatile bustransaction_t *Transaction) {
-    ((Sercom *) hw)->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_DRDY;
-    Transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+    Sercom *sercom_instance = ((Sercom *) hw);
+    if (i2c_slave_dma_active(&i2c_slave_dma[Transaction->instance_num])) {
+        /* The rx buffer is full, ACKACT is set so reading DATA NACKs the byte */
+        (void) sercom_instance->I2CS.DATA.reg;
+        return;
+    }
+    volatile i2c_slave_reg_map_t *reg_map = i2c_slave_get_reg_map(Transaction->instance_num);
+    if (!i2c_slave_reg_map_active(reg_map)) {
+        sercom_instance->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_DRDY;
+        Transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+        return;
+    }
+    /* Smart mode is enabled, reading DATA acknowledges the byte and clears DRDY */
+    const uint8_t received_byte = sercom_instance->I2CS.DATA.reg;
+    if (!reg_map->reg_ptr_received) {
+        reg_map->reg_ptr = received_byte % reg_map->amount_of_regs;
+        reg_map->reg_ptr_received = 1;
+        return;
+    }
+    const uint8_t write_mask = (reg_map->write_masks != NULL) ? reg_map->write_masks[reg_map->reg_ptr] : 0xFF;
+    const uint8_t old_value = reg_map->registers[reg_map->reg_ptr];
+    reg_map->registers[reg_map->reg_ptr] = (old_value & ~write_mask) | (received_byte & write_mask);
+    if (reg_map->amount_of_changed_regs == 0) {
+        reg_map->first_changed_reg = reg_map->reg_ptr;
+    }
+    if (reg_map->amount_of_changed_regs < reg_map->amount_of_regs) {
+        reg_map->amount_of_changed_regs++;
+    }
+    i2c_slave_reg_map_increment_ptr(reg_map);
 }
 
 void i2c_slave_data_send_irq(const void *const hw, volatile bustransaction_t *Transaction) {
-    ((Sercom *) hw)->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_DRDY;
-    Transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+    Sercom *sercom_instance = ((Sercom *) hw);
+    volatile i2c_slave_reg_map_t *reg_map = i2c_slave_get_reg_map(Transaction->instance_num);
+    volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[Transaction->instance_num];
+    const bool dma_mode = i2c_slave_dma_active(slave_dma);
+    if (!dma_mode && !i2c_slave_reg_map_active(reg_map)) {
+        sercom_instance->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_DRDY;
+        Transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+        return;
+    }
+    /*
+     * RXNACK still holds the NACK which ended the previous read until a byte of this read has been sent.
+     * buf_cnt counts the bytes sent by this ISR, in DMA mode DRDY is only enabled after the DMA sent the tx buffer.
+     */
+    const bool byte_sent = Transaction->buf_cnt != 0 || (dma_mode && slave_dma->tx_size != 0);
+    const bool host_nacked_last_byte = byte_sent && sercom_instance->I2CS.STATUS.bit.RXNACK;
+    if (host_nacked_last_byte) {
+        sercom_instance->I2CS.CTRLB.reg = SERCOM_I2C_SLAVE_WAIT_FOR_START;
+        return;
+    }
+    Transaction->buf_cnt++;
+    if (dma_mode) {
+        /* The tx buffer is exhausted, pad the remaining bytes the host reads */
+        sercom_instance->I2CS.DATA.reg = I2C_SLAVE_DMA_PADDING_BYTE;
+        return;
+    }
+    /* Smart mode is enabled, writing DATA clears DRDY */
+    sercom_instance->I2CS.DATA.reg = reg_map->registers[reg_map->reg_ptr];
+    i2c_slave_reg_map_increment_ptr(reg_map);
 }
 
 void i2c_slave_stop_irq(const void *const hw, volatile bustransaction_t *Transaction) {
     ((Sercom *) hw)->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_PREC;
     Transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+    volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[Transaction->instance_num];
+    if (i2c_slave_dma_active(slave_dma)) {
+        i2c_slave_dma_finish_transfer((Sercom *) hw, Transaction, slave_dma);
+        return;
+    }
+    volatile i2c_slave_reg_map_t *reg_map = i2c_slave_get_reg_map(Transaction->instance_num);
+    if (!i2c_slave_reg_map_active(reg_map)) {
+        return;
+    }
+    const uint16_t amount_of_changed_regs = reg_map->amount_of_changed_regs;
+    reg_map->amount_of_changed_regs = 0;
+    if (amount_of_changed_regs && reg_map->reg_change_cb != NULL) {
+        reg_map->reg_change_cb(Transaction->instance_num, reg_map->first_changed_reg, amount_of_changed_regs);
+    }
 }
 
 void i2c_slave_address_match_irq(const void *const hw, volatile bustransaction_t *transaction) {
-    ((Sercom *) hw)->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_AMATCH;
+    Sercom *sercom_instance = ((Sercom *) hw);
+    const bool isReadTransaction = sercom_instance->I2CS.STATUS.bit.DIR;
+    volatile i2c_slave_dma_t *slave_dma = &i2c_slave_dma[transaction->instance_num];
+    if (i2c_slave_dma_active(slave_dma)) {
+        /* A repeated start ends the previous transfer */
+        i2c_slave_dma_finish_transfer(sercom_instance, transaction, slave_dma);
+    }
+    /* On address match the DATA register holds the received address byte.
+     * With 10-bit addressing that is only the header, the configured address is used as matched address instead.
+     * i2c_slave_set_addressing only allows a single 10-bit address, so that is the address the host sent */
+    volatile i2c_slave_addr_state_t *addr_state = &i2c_slave_addr_states[transaction->instance_num];
+    const bool ten_bit_addressing = sercom_instance->I2CS.ADDR.reg & SERCOM_I2CS_ADDR_TENBITEN;
+    const uint16_t matched_addr = ten_bit_addressing ?
+                                  (sercom_instance->I2CS.ADDR.reg & SERCOM_I2CS_ADDR_ADDR_Msk) >> SERCOM_I2CS_ADDR_ADDR_Pos :
+                                  sercom_instance->I2CS.DATA.reg >> 1;
+    const uint8_t active_slot = i2c_slave_find_address_slot(addr_state, matched_addr);
+    addr_state->matched_addr = matched_addr;
+    addr_state->active_slot = active_slot;
+    uhal_status_t addr_status = UHAL_STATUS_OK;
+    if (active_slot != I2C_SLAVE_NO_ADDRESS_SLOT && addr_state->slots[active_slot].handler != NULL) {
+        addr_status = addr_state->slots[active_slot].handler(transaction->instance_num, matched_addr, isReadTransaction);
+    }
+    if (addr_status != UHAL_STATUS_OK) {
+        /* NACK the address, the host will end the transaction with a STOP */
+        sercom_instance->I2CS.CTRLB.reg |= SERCOM_I2CS_CTRLB_ACKACT;
+        sercom_instance->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_AMATCH;
+        transaction->transaction_type = SERCOMACT_IDLE_I2CS;
+        return;
+    }
+    sercom_instance->I2CS.CTRLB.reg &= ~SERCOM_I2CS_CTRLB_ACKACT;
+    transaction->buf_cnt = 0;
+    if (i2c_slave_dma_active(slave_dma)) {
+        i2c_slave_dma_start_transfer(sercom_instance, transaction, slave_dma, isReadTransaction);
+    }
+    /* A write transaction always starts with a new register pointer, a (repeated start) read continues at the current one */
+    if (!isReadTransaction) {
+        i2c_slave_get_reg_map(transaction->instance_num)->reg_ptr_received = 0;
+    }
+    sercom_instance->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_AMATCH;
     transaction->transaction_type = SERCOMACT_IDLE_I2CS;
 }
 
 void i2c_slave_handler(const void *const hw, volatile bustransaction_t *Transaction) {
     Sercom *sercom_instance = ((Sercom *) hw);
-    const bool addressMatchInt = sercom_instance->I2CS.INTFLAG.reg & SERCOM_I2CS_INTFLAG_AMATCH;
-    const bool stopInt = sercom_instance->I2CS.INTFLAG.reg & SERCOM_I2CS_INTFLAG_PREC;
-    const bool dataReadyInt = sercom_instance->I2CS.INTFLAG.reg & SERCOM_I2CS_INTFLAG_DRDY;
+    /* Only handle enabled interrupts, in DMA mode DRDY is serviced by the DMA controller */
+    const uint8_t pendingInts = sercom_instance->I2CS.INTFLAG.reg & sercom_instance->I2CS.INTENSET.reg;
+    const bool addressMatchInt = pendingInts & SERCOM_I2CS_INTFLAG_AMATCH;
+    const bool stopInt = pendingInts & SERCOM_I2CS_INTFLAG_PREC;
+    const bool dataReadyInt = pendingInts & SERCOM_I2CS_INTFLAG_DRDY;
     const bool isReadTransaction = sercom_instance->I2CS.STATUS.bit.DIR;
-    if (addressMatchInt) {
-        i2c_slave_address_match_irq(hw, Transaction);
-    }
     if (stopInt) {
         i2c_slave_stop_irq(hw, Transaction);
     }
+    if (addressMatchInt) {
+        i2c_slave_address_match_irq(hw, Transaction);
+    }
     if (dataReadyInt && isReadTransaction) {
         i2c_slave_data_send_irq(hw, Transaction);
     }
@@ -72,6 +72,19 @@ void enable_irq_handler(IRQn_Type irq_type, uint8_t priority) {
     NVIC_EnableIRQ(irq_type);
 }
 
+void enable_irq_handlers(IRQn_Type first_irq, uint8_t irq_lines, uint8_t priority) {
+    for (uint8_t line = 0; line < irq_lines; line++) {
+        enable_irq_handler((IRQn_Type) (first_irq + line), priority);
+    }
+}
+
+void disable_irq_handlers(IRQn_Type first_irq, uint8_t irq_lines) {
+    for (uint8_t line = 0; line < irq_lines; line++) {
+        NVIC_DisableIRQ((IRQn_Type) (first_irq + line));
+        NVIC_ClearPendingIRQ((IRQn_Type) (first_irq + line));
+    }
+}
+
 
 /**
  * @brief Each SERCOM peripheral gets its own SercomBusTransaction.
@@ -87,6 +100,21 @@ volatile bustransaction_t sercom_bustrans_buffer[6] = {{SERCOMACT_NONE, 0, NULL,
                                                        {SERCOMACT_NONE, 0, NULL, NULL, 0, 0},
                                                        {SERCOMACT_NONE, 0, NULL, NULL, 0, 0}};
 
+bool sercom_transaction_in_flight(const uint8_t sercom_num) {
+    /* The idle states of the drivers sort below the active states */
+    const uint8_t transaction_type = sercom_bustrans_buffer[sercom_num].transaction_type;
+    if (transaction_type > SERCOMACT_IDLE_SPI_SLAVE) {
+        return true;
+    }
+#ifndef DISABLE_I2C_HOST_MODULE
+    /* A retry waits for its backoff timer and a scan for its next probe while the SERCOM itself is idle */
+    if (transaction_type == SERCOMACT_IDLE_I2CM) {
+        return i2c_host_retry_states[sercom_num].pending || i2c_host_presence[sercom_num].scanning;
+    }
+#endif
+    return false;
+}
+
 static inline void default_sercom_isr_handler(const void *const hw, volatile bustransaction_t *transaction) {
     Sercom *sercom_instance = ((Sercom *) hw);
     switch (transaction->transaction_type) {
@@ -100,11 +128,36 @@ static inline void default_sercom_isr_handler(const void *const hw, volatile bus
 #ifndef DISABLE_I2C_HOST_MODULE
         case SERCOMACT_I2C_DATA_TRANSMIT_NO_STOP:
         case SERCOMACT_I2C_DATA_TRANSMIT_STOP: {
-            i2c_host_data_send_irq(sercom_instance, transaction);
+            if (BITMASK_COMPARE(sercom_instance->I2CM.INTFLAG.reg, SERCOM_I2CM_INTFLAG_ERROR)) {
+                i2c_host_error_irq(sercom_instance, transaction);
+            } else {
+                i2c_host_data_send_irq(sercom_instance, transaction);
+            }
+            i2c_host_check_transaction_done(transaction);
             break;
         }
+        case SERCOMACT_I2C_10BIT_READ_HEADER:
         case SERCOMACT_I2C_DATA_RECEIVE_STOP: {
-            i2c_host_data_recv_irq(sercom_instance, transaction);
+            if (BITMASK_COMPARE(sercom_instance->I2CM.INTFLAG.reg, SERCOM_I2CM_INTFLAG_ERROR)) {
+                i2c_host_error_irq(sercom_instance, transaction);
+            } else {
+                i2c_host_data_recv_irq(sercom_instance, transaction);
+            }
+            i2c_host_check_transaction_done(transaction);
+            break;
+        }
+        case SERCOMACT_I2C_SCAN: {
+            i2c_host_scan_irq(sercom_instance, transaction);
+            i2c_host_check_transaction_done(transaction);
+            break;
+        }
+        case SERCOMACT_IDLE_I2CM: {
+            if (BITMASK_COMPARE(sercom_instance->I2CM.INTFLAG.reg, SERCOM_I2CM_INTFLAG_ERROR)) {
+                i2c_host_error_irq(sercom_instance, transaction);
+            } else {
+                const uint8_t i2c_intflag = sercom_instance->I2CM.INTFLAG.reg;
+                sercom_instance->I2CM.INTFLAG.reg = i2c_intflag;
+            }
             break;
         }
 #endif
@@ -119,6 +172,8 @@ static inline void default_sercom_isr_handler(const void *const hw, volatile bus
             break;
         }
         case SERCOMACT_IDLE_SPI_HOST: {
+            /* The RXC interrupt only wakes up a polled transfer (UHAL_LOW_POWER_WAIT), the transfer reads DATA itself */
+            sercom_instance->SPI.INTENCLR.reg = SERCOM_SPI_INTENCLR_RXC;
             uint8_t spi_intflag = sercom_instance->SPI.INTFLAG.reg;
             sercom_instance->SPI.INTFLAG.reg = spi_intflag;
             break;
@@ -190,9 +245,58 @@ __attribute__((used)) void NonMaskableInt_Handler(void) {
     gpio_irq_handler(EIC);
 }
 
-__attribute__((used)) void DMAC_Handler(){
+__attribute__((used)) void DMAC_Handler(void) {
 #ifndef DISABLE_DMA_HANDLER
     dma_irq_handler(DMAC);
 #endif
 }
 
+#ifdef __SAMD51__
+/*
+ * The SAMD51 vector table has a separate entry for every interrupt line,
+ * the lines of each peripheral are bound to the single handler above.
+ */
+#define SERCOM_IRQ_LINE_HANDLERS(n) \
+    void SERCOM##n##_0_Handler(void) __attribute__((used, alias("SERCOM" #n "_Handler"))); \
+    void SERCOM##n##_1_Handler(void) __attribute__((used, alias("SERCOM" #n "_Handler"))); \
+    void SERCOM##n##_2_Handler(void) __attribute__((used, alias("SERCOM" #n "_Handler"))); \
+    void SERCOM##n##_3_Handler(void) __attribute__((used, alias("SERCOM" #n "_Handler")));
+
+SERCOM_IRQ_LINE_HANDLERS(0)
+SERCOM_IRQ_LINE_HANDLERS(1)
+SERCOM_IRQ_LINE_HANDLERS(2)
+SERCOM_IRQ_LINE_HANDLERS(3)
+SERCOM_IRQ_LINE_HANDLERS(4)
+SERCOM_IRQ_LINE_HANDLERS(5)
+
+void DMAC_0_Handler(void) __attribute__((used, alias("DMAC_Handler")));
+void DMAC_1_Handler(void) __attribute__((used, alias("DMAC_Handler")));
+void DMAC_2_Handler(void) __attribute__((used, alias("DMAC_Handler")));
+void DMAC_3_Handler(void) __attribute__((used, alias("DMAC_Handler")));
+void DMAC_4_Handler(void) __attribute__((used, alias("DMAC_Handler")));
+
+#define EIC_IRQ_LINE_HANDLER(n) void EIC_##n##_Handler(void) __attribute__((used, alias("EIC_Handler")));
+
+EIC_IRQ_LINE_HANDLER(0)
+EIC_IRQ_LINE_HANDLER(1)
+EIC_IRQ_LINE_HANDLER(2)
+EIC_IRQ_LINE_HANDLER(3)
+EIC_IRQ_LINE_HANDLER(4)
+EIC_IRQ_LINE_HANDLER(5)
+EIC_IRQ_LINE_HANDLER(6)
+EIC_IRQ_LINE_HANDLER(7)
+EIC_IRQ_LINE_HANDLER(8)
+EIC_IRQ_LINE_HANDLER(9)
+EIC_IRQ_LINE_HANDLER(10)
+EIC_IRQ_LINE_HANDLER(11)
+EIC_IRQ_LINE_HANDLER(12)
+EIC_IRQ_LINE_HANDLER(13)
+EIC_IRQ_LINE_HANDLER(14)
+EIC_IRQ_LINE_HANDLER(15)
+#endif
+
+#if defined(I2C_HOST_RETRY_TIMER) && !defined(DISABLE_I2C_HOST_MODULE)
+__attribute__((used)) void I2C_HOST_RETRY_TC_HANDLER(void) {
+    i2c_host_retry_timer_irq();
+}
+#endif
@@ -27,6 +27,64 @@
 
 #include <sam.h>
 
+/**
+ * @brief The SAMD51 splits the interrupt of a SERCOM over 4 lines (one per flag group), the DMAC over 5 and the EIC over 16.
+ *        All lines of a peripheral run the same handler, so the drivers enable them as a group.
+ */
+#ifdef __SAMD51__
+#define SERCOM_IRQ_LINES            4
+#define SERCOM_FIRST_IRQn(n)        ((IRQn_Type) (SERCOM0_0_IRQn + ((n) * SERCOM_IRQ_LINES)))
+#define DMAC_IRQ_LINES              5
+#define DMAC_FIRST_IRQn             DMAC_0_IRQn
+#define EIC_IRQ_LINES               16
+#define EIC_FIRST_IRQn              EIC_0_IRQn
+#else
+#define SERCOM_IRQ_LINES            1
+#define SERCOM_FIRST_IRQn(n)        ((IRQn_Type) (SERCOM0_IRQn + (n)))
+#define DMAC_IRQ_LINES              1
+#define DMAC_FIRST_IRQn             DMAC_IRQn
+#define EIC_IRQ_LINES               1
+#define EIC_FIRST_IRQn              EIC_IRQn
+#endif
+
 void enable_irq_handler(IRQn_Type irq_type, uint8_t priority);
 
+/**
+ * @brief Enables a group of consecutive interrupt lines with the same priority.
+ * @param first_irq The first interrupt line of the group
+ * @param irq_lines The amount of lines in the group
+ * @param priority The priority of all lines
+ */
+void enable_irq_handlers(IRQn_Type first_irq, uint8_t irq_lines, uint8_t priority);
+
+/**
+ * @brief Disables a group of consecutive interrupt lines and clears their pending state.
+ */
+void disable_irq_handlers(IRQn_Type first_irq, uint8_t irq_lines);
+
+#ifdef UHAL_LOW_POWER_WAIT
+/**
+ * @brief Sleeps the core (WFI) for as long as the condition holds, the condition has to be ended by an interrupt handler.
+ *        The condition is checked with the interrupts masked. An interrupt which comes in between the check and the WFI
+ *        stays pending and ends the WFI straight away, the handler runs once the mask is restored, so no wake-up is lost.
+ *        The core always enters idle sleep (SLEEPDEEP is cleared during the wait), so the peripherals keep running.
+ *        When the caller has the interrupts masked the handler can't run, the macro then only spins.
+ */
+#define IRQ_SLEEP_WHILE(condition)                                                                                      \
+    do {                                                                                                                \
+        while (condition) {                                                                                             \
+            const uint32_t sleep_primask = __get_PRIMASK();                                                             \
+            const uint32_t sleep_scr = SCB->SCR;                                                                        \
+            __disable_irq();                                                                                            \
+            if (!sleep_primask && (condition)) {                                                                        \
+                SCB->SCR = sleep_scr & ~SCB_SCR_SLEEPDEEP_Msk;                                                          \
+                __DSB();                                                                                                \
+                __WFI();                                                                                                \
+                SCB->SCR = sleep_scr;                                                                                   \
+            }                                                                                                           \
+            __set_PRIMASK(sleep_primask);                                                                               \
+        }                                                                                                               \
+    } while (0)
+#endif /* UHAL_LOW_POWER_WAIT */
+
 #endif
\ No newline at end of file
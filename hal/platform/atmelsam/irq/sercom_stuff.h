@@ -25,17 +25,29 @@
 #ifndef ATMELSAMD21_SERCOM_STUFF_H
 #define ATMELSAMD21_SERCOM_STUFF_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 
+/**
+ * @brief Information about the transaction currently running on a SERCOM.
+ *        status holds an uhal_status_t value. When an error occurs it holds the first error of the transaction,
+ *        the I2C host driver additionally collects every error seen during the transaction in error_mask.
+ */
 typedef struct {
     uint8_t transaction_type;
     uint8_t instance_num;
     const uint8_t *write_buffer;
     uint8_t *read_buffer;
-    uint8_t buf_size;
-    uint8_t buf_cnt;
-    uint8_t status;
+    size_t buf_size;
+    size_t buf_cnt;
+    int8_t status;
+    uint8_t error_mask;
+    int8_t first_error;
+    int8_t last_error;
+    size_t nack_offset;
+    uint8_t retry_cnt;
 } bustransaction_t;
 
 extern volatile bustransaction_t sercom_bustrans_buffer[6];
@@ -55,8 +67,16 @@ typedef enum {
     SERCOMACT_I2C_DATA_TRANSMIT_STOP,
     SERCOMACT_I2C_DATA_RECEIVE_STOP,
     SERCOMACT_SPI_DATA_TRANSMIT,
-    SERCOMACT_SPI_DATA_RECEIVE
+    SERCOMACT_SPI_DATA_RECEIVE,
+    SERCOMACT_I2C_SCAN,
+    SERCOMACT_I2C_10BIT_READ_HEADER
 } busactions_t;
 
+/**
+ * @brief Returns whether a SERCOM has a transaction in flight.
+ *        An I2C host retry waiting for its backoff and a running bus scan count as in flight as well.
+ */
+bool sercom_transaction_in_flight(const uint8_t sercom_num);
+
 
 #endif //ATMELSAMD21_SERCOM_STUFF_H
@@ -0,0 +1,116 @@
+/**
+* \file            power_samd.c
+* \brief           Standby entry with checks for transfers which would break in standby
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef DISABLE_POWER_MODULE
+
+#include <sam.h>
+#include <stdbool.h>
+#include "hal_power.h"
+#include "dma/dma_platform_specific.h"
+#include "irq/sercom_stuff.h"
+
+static Sercom *const power_sercom_mapping_table[6] = {SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5};
+
+/**
+ * @brief Helper function which returns whether any SERCOM has a transaction in flight while it stops in standby.
+ *        RUNSTDBY is bit 7 of CTRLA in every SERCOM mode.
+ */
+static bool sercom_blocks_standby(void) {
+    for (uint8_t sercom_num = 0; sercom_num < 6; sercom_num++) {
+        const bool run_in_standby = power_sercom_mapping_table[sercom_num]->I2CM.CTRLA.reg & SERCOM_I2CM_CTRLA_RUNSTDBY;
+        if (!run_in_standby && sercom_transaction_in_flight(sercom_num)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Helper function which returns whether an enabled DMA channel stops in standby.
+ *        An enabled channel waits for its trigger, so it counts as in flight even when it isn't moving data yet.
+ *        The SAMD21 reaches the channel registers through CHID, the selection is restored for the code which was interrupted.
+ */
+static bool dma_blocks_standby(void) {
+#ifdef __SAMD51__
+    for (uint8_t channel = 0; channel < DMA_NUM_CHANNELS; channel++) {
+        const uint32_t chctrla = DMAC->Channel[channel].CHCTRLA.reg;
+        if ((chctrla & DMAC_CHCTRLA_ENABLE) && !(chctrla & DMAC_CHCTRLA_RUNSTDBY)) {
+            return true;
+        }
+    }
+    return false;
+#else
+    const uint8_t previous_channel_id = DMAC->CHID.reg;
+    bool blocks = false;
+    for (uint8_t channel = 0; channel < DMA_NUM_CHANNELS && !blocks; channel++) {
+        DMAC->CHID.reg = DMAC_CHID_ID(channel);
+        const uint32_t chctrla = DMAC->CHCTRLA.reg;
+        blocks = (chctrla & DMAC_CHCTRLA_ENABLE) && !(chctrla & DMAC_CHCTRLA_RUNSTDBY);
+    }
+    DMAC->CHID.reg = previous_channel_id;
+    return blocks;
+#endif
+}
+
+static inline bool standby_blocked(void) {
+    return sercom_blocks_standby() || dma_blocks_standby();
+}
+
+uhal_status_t power_check_standby(void) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const bool blocked = standby_blocked();
+    __set_PRIMASK(primask);
+    return blocked ? UHAL_STATUS_PERIPHERAL_IN_USE_WARNING : UHAL_STATUS_OK;
+}
+
+uhal_status_t power_enter_standby(void) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (standby_blocked()) {
+        __set_PRIMASK(primask);
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+#ifdef __SAMD51__
+    /* The SAMD51 ignores SLEEPDEEP, the sleep mode is selected in the PM and has to be read back before the WFI */
+    const uint8_t previous_sleep_cfg = PM->SLEEPCFG.reg;
+    PM->SLEEPCFG.reg = PM_SLEEPCFG_SLEEPMODE_STANDBY;
+    while (PM->SLEEPCFG.reg != PM_SLEEPCFG_SLEEPMODE_STANDBY);
+    __DSB();
+    __WFI();
+    PM->SLEEPCFG.reg = previous_sleep_cfg;
+    while (PM->SLEEPCFG.reg != previous_sleep_cfg);
+#else
+    const uint32_t scr = SCB->SCR;
+    SCB->SCR = scr | SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+    SCB->SCR = scr;
+#endif
+    /* Restoring the mask runs the handler of the interrupt which woke the device up */
+    __set_PRIMASK(primask);
+    return UHAL_STATUS_OK;
+}
+
+#endif /* DISABLE_POWER_MODULE */
@@ -0,0 +1,78 @@
+/**
+* \file            sercom_traits.hpp
+* \brief           Compile-time description of the SERCOM peripherals, used by the C++ driver templates
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef ATMELSAMD21_SERCOM_TRAITS_HPP
+#define ATMELSAMD21_SERCOM_TRAITS_HPP
+
+#include <sam.h>
+#include <stdint.h>
+#include "irq/irq_bindings.h"
+#include "irq/sercom_stuff.h"
+#include "dma/dma_platform_specific.h"
+
+namespace uhal {
+
+/**
+ * @brief The APB base addresses of the SERCOMs. The device headers only provide them as pointer casts,
+ *        which can't be used in constant expressions.
+ */
+#ifdef __SAMD51__
+inline constexpr uintptr_t sercom_base_addresses[6] = {0x40003000, 0x40003400, 0x41012000, 0x41014000, 0x43000000, 0x43000400};
+#else
+inline constexpr uintptr_t sercom_base_addresses[6] = {0x42000800, 0x42000C00, 0x42001000, 0x42001400, 0x42001800, 0x42001C00};
+#endif
+
+/**
+ * @brief Everything the drivers look up per SERCOM number, resolved at compile time.
+ * @tparam SercomNum The SERCOM number (0..5)
+ */
+template<unsigned SercomNum>
+struct SercomTraits {
+    static_assert(SercomNum < SERCOM_INST_NUM, "Invalid SERCOM instance number!");
+
+    static constexpr unsigned num = SercomNum;
+    static constexpr uintptr_t base_address = sercom_base_addresses[SercomNum];
+    static constexpr IRQn_Type first_irqn = SERCOM_FIRST_IRQn(SercomNum);
+    static constexpr uint8_t irq_lines = SERCOM_IRQ_LINES;
+    static constexpr dma_trigger_t dma_trigger_rx = static_cast<dma_trigger_t>(SERCOM0_DMAC_ID_RX + 2 * SercomNum);
+    static constexpr dma_trigger_t dma_trigger_tx = static_cast<dma_trigger_t>(SERCOM0_DMAC_ID_TX + 2 * SercomNum);
+
+    /**
+     * @brief The register block of the SERCOM. The address is a literal, so every access compiles to a load/store on a constant address.
+     */
+    static inline Sercom *hw() {
+        return reinterpret_cast<Sercom *>(base_address);
+    }
+
+    /**
+     * @brief The transaction information shared with the interrupt handler of the SERCOM.
+     */
+    static inline volatile bustransaction_t &bustransaction() {
+        return sercom_bustrans_buffer[SercomNum];
+    }
+};
+
+}
+
+#endif //ATMELSAMD21_SERCOM_TRAITS_HPP
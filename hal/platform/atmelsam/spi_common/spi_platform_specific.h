@@ -74,7 +74,9 @@ typedef enum {
     SPI_BUS_OPT_DIPO_PAD_0 = 0x40,
     SPI_BUS_OPT_DIPO_PAD_1 = 0x80,
     SPI_BUS_OPT_DIPO_PAD_2 = 0xC0,
-    SPI_BUS_OPT_DIPO_PAD_3 = 0x100
+    SPI_BUS_OPT_DIPO_PAD_3 = 0x100,
+    SPI_BUS_OPT_DATA32_DISABLE = 0x200,
+    SPI_BUS_OPT_RUN_IN_STANDBY = 0x400
 } spi_bus_opt_t;
 
 typedef enum {
@@ -83,6 +85,36 @@ typedef enum {
     SPI_EXTRA_OPT_DATA_ORDER_LSB_FIRST = 0x02,
 } spi_extra_dev_opt_t;
 
+/**
+ * @brief With UHAL_LOW_POWER_WAIT the core sleeps while a character is shifted on buses up to this frequency.
+ *        On faster buses a character takes less time than the interrupt which wakes the core, so the driver keeps polling.
+ */
+#ifndef SPI_HOST_LOW_POWER_WAIT_MAX_FREQ
+#define SPI_HOST_LOW_POWER_WAIT_MAX_FREQ            1000000
+#endif
+
+/**
+ * @brief The largest amount of bytes transferred with one LENGTH setting in 32-bit mode (SAMD51),
+ *        a multiple of 4 so only the last word of a buffer can be partial.
+ */
+#define SPI_HOST_DATA32_MAX_CHUNK                   252
+
+/**
+ * @brief Baud rate calculator of the SPI host, the macros can be used in static_asserts when their arguments are constants.
+ *        fsck = fref / (2 * (BAUD + 1)), the divider is rounded up so the achieved frequency never exceeds the requested frequency.
+ *        SPI_HOST_MAX_BAUD_ERROR_PERMILLE is the maximum deviation from the requested frequency accepted by SPI_HOST_INIT,
+ *        define it before including the HAL to accept a larger deviation.
+ */
+#ifndef SPI_HOST_MAX_BAUD_ERROR_PERMILLE
+#define SPI_HOST_MAX_BAUD_ERROR_PERMILLE 60
+#endif
+
+#define SPI_HOST_BAUD_VAL(clk_freq, baud_freq)      ((int32_t) (((clk_freq) + 2 * (baud_freq) - 1) / (2 * (baud_freq))) - 1)
+#define SPI_HOST_ACHIEVED_FREQ(clk_freq, baud_freq) ((clk_freq) / (2 * (SPI_HOST_BAUD_VAL(clk_freq, baud_freq) + 1)))
+#define SPI_HOST_BAUD_ERROR_PERMILLE(clk_freq, baud_freq)                                                                                            \
+    ((((int64_t) (baud_freq) - (int64_t) SPI_HOST_ACHIEVED_FREQ(clk_freq, baud_freq)) * 1000) / (int64_t) (baud_freq))
+#define SPI_HOST_BAUD_FITS(clk_freq, baud_freq)     (SPI_HOST_BAUD_VAL(clk_freq, baud_freq) >= 0 && SPI_HOST_BAUD_VAL(clk_freq, baud_freq) <= 0xFF)
+
 #define SPI_HOST_INIT_PARAMETER_CHECK(spi_peripheral_num, peripheral_clock_source, peripheral_clock_freq, spi_bus_frequency, \
                                       spi_extra_configuration_opt)                                                                                   \
     {                                                                                                                                                \
@@ -98,7 +130,12 @@ typedef enum {
                       "SPI_HOST_INIT: Peripheral clock frequency has to be atleast higher than 2x the minimum spi baud_rate of 100KHz");             \
         static_assert(spi_bus_frequency <= max_supported_baud_rate && spi_bus_frequency >= min_supported_baud_rate,                                  \
                       "SPI_HOST_INIT: Unsupported bus frequency option set!");                                                                       \
-        static_assert(spi_extra_configuration_opt <= SPI_BUS_OPT_DIPO_PAD_3, "SPI_HOST_INIT: Unsupported extra configuration options set!");         \
+        static_assert(spi_extra_configuration_opt <= (SPI_BUS_OPT_DIPO_PAD_3 | SPI_BUS_OPT_DATA32_DISABLE | SPI_BUS_OPT_RUN_IN_STANDBY),                                         \
+                      "SPI_HOST_INIT: Unsupported extra configuration options set!");                                                                \
+        static_assert(SPI_HOST_BAUD_FITS(peripheral_clock_freq, spi_bus_frequency),                                                                 \
+                      "SPI_HOST_INIT: The bus frequency can't be generated from this peripheral clock frequency!");                                  \
+        static_assert(SPI_HOST_BAUD_ERROR_PERMILLE(peripheral_clock_freq, spi_bus_frequency) <= SPI_HOST_MAX_BAUD_ERROR_PERMILLE,                    \
+                      "SPI_HOST_INIT: The achieved bus frequency deviates more than SPI_HOST_MAX_BAUD_ERROR_PERMILLE from the requested frequency!"); \
     }                                                                                                                                                \
     while (0)                                                                                                                                        \
         ;
@@ -24,10 +24,12 @@
 
 #ifndef DISABLE_SPI_HOST_MODULE
 
+#include <stdbool.h>
 #include "bit_manipulation.h"
 #include "hal_gpio.h"
 #include "hal_spi_host.h"
 #include "hal_i2c_host.h"
+#include "hal_os.h"
 #include "spi_common/spi_platform_specific.h"
 #include "irq/irq_bindings.h"
 
@@ -35,11 +37,41 @@
 
 Sercom *spi_peripheral_mapping_table[6] = {SERCOM0, SERCOM1, SERCOM2, SERCOM3, SERCOM4, SERCOM5};
 
+/**
+ * @brief The bus frequency, fast clock generator and its frequency given to spi_host_init,
+ *        used for recalculating the BAUD register after a clock change.
+ */
+static uint32_t spi_host_bus_freq[6];
+static uint8_t spi_host_fast_clk_gen[6];
+static uint32_t spi_host_clk_freq[6];
+static volatile bool spi_host_retune_pending[6];
+
+#ifdef __SAMD51__
+/**
+ * @brief Whether the DATA register is accessed 32 bits at a time (CTRLC.DATA32B), only done for 8-bit characters.
+ */
+static bool spi_host_data32[6];
+#endif
+
+#ifdef UHAL_LOW_POWER_WAIT
+/**
+ * @brief Whether the core sleeps while a character is shifted, only done on buses slow enough to make it worth the interrupt.
+ */
+static bool spi_host_sleep_wait[6];
+#endif
 
 static inline Sercom *get_sercom_inst(const spi_host_inst_t peripheral_inst_num) {
     return spi_peripheral_mapping_table[peripheral_inst_num];
 }
 
+static inline bool get_sleep_wait(const spi_host_inst_t peripheral_inst_num) {
+#ifdef UHAL_LOW_POWER_WAIT
+    return spi_host_sleep_wait[peripheral_inst_num];
+#else
+    return false;
+#endif
+}
+
 /**
  * @brief Helper function which waits for the sercom peripheral to get in sync and finish requested operations.
  *        By continually reading its SPI syncbusy register.
@@ -55,8 +87,31 @@ static inline void spi_wait_for_sync(const void *const hw, const uint32_t bits_t
 }
 
 static inline void spi_wait_for_transaction_finish(volatile bustransaction_t *bustransaction, busactions_t flag) {
+#ifdef UHAL_LOW_POWER_WAIT
+    IRQ_SLEEP_WHILE(bustransaction->transaction_type != flag);
+#else
     while (bustransaction->transaction_type != flag) { ;
     }
+#endif
+}
+
+/**
+ * @brief Helper function which waits for the received character (RXC).
+ *        When sleeping, the RXC interrupt wakes the core up. The interrupt handler only disables the interrupt again,
+ *        the character is left in DATA for the caller.
+ * @param sleep Whether to sleep (WFI) while waiting, only has an effect with UHAL_LOW_POWER_WAIT
+ */
+static inline void spi_wait_for_rxc(Sercom *sercom, const bool sleep) {
+#ifdef UHAL_LOW_POWER_WAIT
+    if (sleep) {
+        sercom->SPI.INTENSET.reg = SERCOM_SPI_INTENSET_RXC;
+        IRQ_SLEEP_WHILE(sercom->SPI.INTFLAG.bit.RXC == 0);
+        return;
+    }
+#endif
+    while (sercom->SPI.INTFLAG.bit.RXC == 0) {
+        // Waiting Complete Reception
+    }
 }
 
 static inline uint8_t get_fast_clk_gen_val(const spi_clock_sources_t clock_sources) {
@@ -89,37 +144,43 @@ static inline uint8_t get_dipo_pad_from_bus_opt(const spi_bus_opt_t bus_opt) {
     return (BITMASK_COMPARE(bus_opt, 0x1C0) >> 6) - 1;
 }
 
+/**
+ * @brief Frequency change handler of the clock system. The BAUD register is enable-protected,
+ *        so it is rewritten at the start of the next transaction.
+ */
+static void spi_host_clk_freq_changed(const clk_gen_num_t clk_gen, const uint32_t new_freq) {
+    if (new_freq == 0) {
+        return;
+    }
+    for (uint8_t periph = 0; periph < 6; periph++) {
+        if (spi_host_bus_freq[periph] != 0 && spi_host_fast_clk_gen[periph] == clk_gen) {
+            spi_host_clk_freq[periph] = new_freq;
+            spi_host_retune_pending[periph] = true;
+        }
+    }
+}
+
+static inline uint8_t get_baud_register_val(const uint32_t clk_freq, const uint32_t bus_freq) {
+    const int32_t baud = SPI_HOST_BAUD_VAL(clk_freq, bus_freq);
+    return baud < 0 ? 0 : (baud > 0xFF ? 0xFF : baud);
+}
+
 uhal_status_t spi_host_init(const spi_host_inst_t spi_peripheral_num, const uint32_t spi_clock_source,
                             const uint32_t spi_clock_source_freq,
                             const unsigned long spi_bus_frequency, const spi_bus_opt_t spi_extra_configuration_opt) {
 
     // Set the clock system
-#ifdef __SAMD51__
-
-#else
-    PM->APBCMASK.reg |= 1 << (PM_APBCMASK_SERCOM0_Pos + spi_peripheral_num);
-    if (spi_clock_source != SPI_CLK_SOURCE_USE_DEFAULT) {
-        const uint8_t clk_gen_slow = get_slow_clk_gen_val(spi_clock_source);
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = get_fast_clk_gen_val(spi_clock_source);
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + spi_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    } else {
-        const uint8_t clk_gen_slow = 3;
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = 0;
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + spi_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
+    uint32_t sercom_clk_freq = spi_clock_source_freq;
+    const bool default_clocks = (spi_clock_source == SPI_CLK_SOURCE_USE_DEFAULT);
+    const clk_gen_num_t clk_gen_fast = default_clocks ? CLKGEN_0 : get_fast_clk_gen_val(spi_clock_source);
+    const clk_gen_num_t clk_gen_slow = default_clocks ? CLKGEN_3 : get_slow_clk_gen_val(spi_clock_source);
+    clk_enable_sercom_clocks(spi_peripheral_num, clk_gen_fast, clk_gen_slow);
+    clk_register_freq_change_handler(spi_host_clk_freq_changed);
+    /* The frequency tracked by the clock system wins, spi_clock_source_freq is only used when it is unknown */
+    const uint32_t routed_clk_freq = clk_get_peripheral_freq(CLK_CHANNEL_SERCOM_CORE(spi_peripheral_num));
+    if (routed_clk_freq) {
+        sercom_clk_freq = routed_clk_freq;
     }
-#endif
     Sercom *sercom_instance = get_sercom_inst(spi_peripheral_num);
     const uint8_t dopo_pad = get_dopo_pad_from_bus_opt(spi_extra_configuration_opt);
     const uint8_t dipo_pad = get_dipo_pad_from_bus_opt(spi_extra_configuration_opt);
@@ -131,16 +192,30 @@ uhal_status_t spi_host_init(const spi_host_inst_t spi_peripheral_num, const uint
     sercom_instance->SPI.CTRLA.reg =
             SERCOM_SPI_CTRLA_MODE_SPI_MASTER | (0 << SERCOM_SPI_CTRLA_CPHA_Pos)
             | (0 << SERCOM_SPI_CTRLA_CPOL_Pos) | (SERCOM_SPI_CTRLA_DIPO(dipo_pad))
-            | (SERCOM_SPI_CTRLA_DOPO(dopo_pad));
+            | (SERCOM_SPI_CTRLA_DOPO(dopo_pad))
+            | (BITMASK_COMPARE(spi_extra_configuration_opt, SPI_BUS_OPT_RUN_IN_STANDBY) ? SERCOM_SPI_CTRLA_RUNSTDBY : 0);
     sercom_instance->SPI.CTRLB.reg = SERCOM_SPI_CTRLB_PLOADEN | SERCOM_SPI_CTRLB_CHSIZE(character_size);
-    sercom_instance->SPI.BAUD.reg = spi_clock_source_freq / spi_bus_frequency / 2;
+#ifdef __SAMD51__
+    /* Four 8-bit characters per DATA access, this quarters the amount of register accesses per transfer */
+    spi_host_data32[spi_peripheral_num] = (character_size == 0)
+                                          && !BITMASK_COMPARE(spi_extra_configuration_opt, SPI_BUS_OPT_DATA32_DISABLE);
+    sercom_instance->SPI.CTRLC.reg = spi_host_data32[spi_peripheral_num] ? SERCOM_SPI_CTRLC_DATA32B : 0;
+#endif
+    sercom_instance->SPI.BAUD.reg = get_baud_register_val(sercom_clk_freq, spi_bus_frequency);
+    spi_host_bus_freq[spi_peripheral_num] = spi_bus_frequency;
+    spi_host_clk_freq[spi_peripheral_num] = sercom_clk_freq;
+    spi_host_fast_clk_gen[spi_peripheral_num] = (spi_clock_source != SPI_CLK_SOURCE_USE_DEFAULT) ? get_fast_clk_gen_val(spi_clock_source) : 0;
+    spi_host_retune_pending[spi_peripheral_num] = false;
+#ifdef UHAL_LOW_POWER_WAIT
+    spi_host_sleep_wait[spi_peripheral_num] = (spi_bus_frequency <= SPI_HOST_LOW_POWER_WAIT_MAX_FREQ);
+#endif
 //    sercom_instance->SPI.INTENSET.reg = SERCOM_SPI_INTENSET_RXC | SERCOM_SPI_INTENSET_TXC | SERCOM_SPI_INTENSET_SSL;
     sercom_instance->SPI.CTRLA.reg |= SERCOM_SPI_CTRLA_ENABLE;
     sercom_instance->SPI.CTRLB.reg |= SERCOM_SPI_CTRLB_RXEN;
     spi_wait_for_sync(sercom_instance, SERCOM_SPI_SYNCBUSY_ENABLE);
-    const enum IRQn irq_type = (SERCOM0_IRQn + spi_peripheral_num);
-    enable_irq_handler(irq_type, 2);
+    enable_irq_handlers(SERCOM_FIRST_IRQn(spi_peripheral_num), SERCOM_IRQ_LINES, 2);
     sercom_bustrans_buffer[spi_peripheral_num].transaction_type = SERCOMACT_IDLE_SPI_HOST;
+    UHAL_OS_BUS_INIT(UHAL_OS_BUS_SERCOM(spi_peripheral_num));
     return UHAL_STATUS_OK;
 }
 
@@ -150,7 +225,17 @@ uhal_status_t spi_host_deinit(const spi_host_inst_t spi_peripheral_num) {
 
 uhal_status_t spi_host_start_transaction(const spi_host_inst_t spi_peripheral_num, const gpio_pin_t chip_select_pin,
                                          const spi_extra_dev_opt_t device_specific_config_opt) {
+    /* The bus is owned by the calling task until spi_host_end_transaction */
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_SERCOM(spi_peripheral_num));
     Sercom *sercom_instance = get_sercom_inst(spi_peripheral_num);
+    if (spi_host_retune_pending[spi_peripheral_num]) {
+        /* Transaction boundary: the BAUD register can only be written while the SERCOM is disabled */
+        spi_host_retune_pending[spi_peripheral_num] = false;
+        sercom_instance->SPI.CTRLA.reg &= ~(SERCOM_SPI_CTRLA_ENABLE);
+        spi_wait_for_sync(sercom_instance, SERCOM_SPI_SYNCBUSY_ENABLE);
+        sercom_instance->SPI.BAUD.reg = get_baud_register_val(spi_host_clk_freq[spi_peripheral_num],
+                                                              spi_host_bus_freq[spi_peripheral_num]);
+    }
     gpio_set_pin_lvl(chip_select_pin, GPIO_LOW);
     sercom_instance->SPI.CTRLA.reg |= (SERCOM_SPI_CTRLA_ENABLE);
     spi_wait_for_sync(sercom_instance, SERCOM_SPI_SYNCBUSY_ENABLE);
@@ -162,6 +247,7 @@ uhal_status_t spi_host_end_transaction(const spi_host_inst_t spi_peripheral_num,
     sercom_instance->SPI.CTRLA.reg &= ~(SERCOM_SPI_CTRLA_ENABLE);
     spi_wait_for_sync(sercom_instance, SERCOM_SPI_SYNCBUSY_ENABLE);
     gpio_set_pin_lvl(chip_select_pin, GPIO_HIGH);
+    UHAL_OS_BUS_UNLOCK(UHAL_OS_BUS_SERCOM(spi_peripheral_num));
     return UHAL_STATUS_OK;
 }
 
@@ -173,21 +259,59 @@ spi_host_write_blocking(const spi_host_inst_t spi_peripheral_num, const unsigned
     return UHAL_STATUS_OK;
 }
 
-uint8_t transferdata(Sercom *sercom, uint8_t data) {
+uint8_t transferdata(Sercom *sercom, uint8_t data, const bool sleep) {
     sercom->SPI.DATA.bit.DATA = data; // Writing data into Data register
 
-    while (sercom->SPI.INTFLAG.bit.RXC == 0) {
-        // Waiting Complete Reception
-    }
+    spi_wait_for_rxc(sercom, sleep);
 
     return sercom->SPI.DATA.bit.DATA;  // Reading data
 }
 
+#ifdef __SAMD51__
+/**
+ * @brief Helper function which transfers a buffer 4 bytes per DATA access, the least significant byte of a word is shifted first.
+ *        LENGTH holds the amount of bytes of the chunk, so the SERCOM only shifts the valid bytes of the last word.
+ * @param write_buff The bytes to write, NULL to write zeros
+ * @param read_buff The buffer for the received bytes, NULL to discard them
+ */
+static void spi_host_transfer_data32(Sercom *sercom, const unsigned char *write_buff, unsigned char *read_buff, size_t size,
+                                     const bool sleep) {
+    while (size > 0) {
+        const uint8_t chunk = (size > SPI_HOST_DATA32_MAX_CHUNK) ? SPI_HOST_DATA32_MAX_CHUNK : size;
+        sercom->SPI.LENGTH.reg = SERCOM_SPI_LENGTH_LENEN | SERCOM_SPI_LENGTH_LEN(chunk);
+        spi_wait_for_sync(sercom, SERCOM_SPI_SYNCBUSY_LENGTH);
+        for (uint8_t offset = 0; offset < chunk; offset += 4) {
+            const uint8_t word_bytes = (chunk - offset < 4) ? (chunk - offset) : 4;
+            uint32_t word = 0;
+            for (uint8_t byte = 0; write_buff != NULL && byte < word_bytes; byte++) {
+                word |= (uint32_t) write_buff[offset + byte] << (8 * byte);
+            }
+            sercom->SPI.DATA.reg = word;
+            spi_wait_for_rxc(sercom, sleep);
+            word = sercom->SPI.DATA.reg;
+            for (uint8_t byte = 0; read_buff != NULL && byte < word_bytes; byte++) {
+                read_buff[offset + byte] = (word >> (8 * byte)) & 0xFF;
+            }
+        }
+        write_buff = (write_buff != NULL) ? write_buff + chunk : NULL;
+        read_buff = (read_buff != NULL) ? read_buff + chunk : NULL;
+        size -= chunk;
+    }
+}
+#endif
+
 uhal_status_t spi_host_write_non_blocking(const spi_host_inst_t spi_peripheral_num, const unsigned char *write_buff,
                                           const size_t size) {
     Sercom *sercom_instance = get_sercom_inst(spi_peripheral_num);
+    const bool sleep = get_sleep_wait(spi_peripheral_num);
+#ifdef __SAMD51__
+    if (spi_host_data32[spi_peripheral_num]) {
+        spi_host_transfer_data32(sercom_instance, write_buff, NULL, size, sleep);
+        return UHAL_STATUS_OK;
+    }
+#endif
     for (uint8_t i = 0; i < size; i++) {
-        transferdata(sercom_instance, write_buff[i]);
+        transferdata(sercom_instance, write_buff[i], sleep);
     }
     return UHAL_STATUS_OK;
 }
@@ -202,8 +326,15 @@ spi_host_read_blocking(const spi_host_inst_t spi_peripheral_num, unsigned char *
 uhal_status_t
 spi_host_read_non_blocking(const spi_host_inst_t spi_peripheral_num, unsigned char *read_buff, size_t amount_of_bytes) {
     Sercom *sercom_instance = get_sercom_inst(spi_peripheral_num);
+    const bool sleep = get_sleep_wait(spi_peripheral_num);
+#ifdef __SAMD51__
+    if (spi_host_data32[spi_peripheral_num]) {
+        spi_host_transfer_data32(sercom_instance, NULL, read_buff, amount_of_bytes, sleep);
+        return UHAL_STATUS_OK;
+    }
+#endif
     for (uint8_t i = 0; i < amount_of_bytes; i++) {
-        read_buff[i] = transferdata(sercom_instance, 0x00);
+        read_buff[i] = transferdata(sercom_instance, 0x00, sleep);
     }
     return UHAL_STATUS_OK;
 }
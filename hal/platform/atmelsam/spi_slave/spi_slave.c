@@ -24,6 +24,7 @@
 
 #ifndef DISABLE_SPI_SLAVE_MODULE
 
+#include <stdbool.h>
 #include "bit_manipulation.h"
 #include "hal_gpio.h"
 #include "hal_spi_slave.h"
@@ -83,32 +84,10 @@ static inline uint8_t get_dipo_pad_from_bus_opt(const spi_bus_opt_t bus_opt) {
 uhal_status_t spi_slave_init(const spi_slave_inst_t spi_peripheral_num, const uint32_t spi_clock_source,
                              const spi_bus_opt_t spi_extra_configuration_opt) {
     // Set the clock system
-#ifdef __SAMD51__
-
-#else
-    PM->APBCMASK.reg |= 1 << (PM_APBCMASK_SERCOM0_Pos + spi_peripheral_num);
-    if (spi_clock_source != SPI_CLK_SOURCE_USE_DEFAULT) {
-        const uint8_t clk_gen_slow = get_slow_clk_gen_val(spi_clock_source);
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = get_fast_clk_gen_val(spi_clock_source);
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + spi_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    } else {
-        const uint8_t clk_gen_slow = 3;
-        GCLK->CLKCTRL.reg = GCLK_CLKCTRL_GEN(clk_gen_slow) | GCLK_CLKCTRL_ID_SERCOMX_SLOW | GCLK_CLKCTRL_CLKEN;
-        while (GCLK->STATUS.bit.SYNCBUSY);
-        const uint8_t clk_gen_fast = 0;
-        GCLK->CLKCTRL.reg =
-                GCLK_CLKCTRL_GEN(clk_gen_fast) |
-                ((GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + spi_peripheral_num) << GCLK_CLKCTRL_ID_Pos) | GCLK_CLKCTRL_CLKEN;
-        GCLK->GENDIV.reg = GCLK_GENDIV_DIV(0x01) | GCLK_GENDIV_ID(clk_gen_fast);
-        while (GCLK->STATUS.bit.SYNCBUSY);
-    }
-#endif
+    const bool default_clocks = (spi_clock_source == SPI_CLK_SOURCE_USE_DEFAULT);
+    const clk_gen_num_t clk_gen_fast = default_clocks ? CLKGEN_0 : get_fast_clk_gen_val(spi_clock_source);
+    const clk_gen_num_t clk_gen_slow = default_clocks ? CLKGEN_3 : get_slow_clk_gen_val(spi_clock_source);
+    clk_enable_sercom_clocks(spi_peripheral_num, clk_gen_fast, clk_gen_slow);
     Sercom *sercom_instance = get_sercom_inst(spi_peripheral_num);
     const uint8_t dopo_pad = get_dopo_pad_from_bus_opt(spi_extra_configuration_opt);
     const uint8_t dipo_pad = get_dipo_pad_from_bus_opt(spi_extra_configuration_opt);
@@ -120,20 +99,19 @@ uhal_status_t spi_slave_init(const spi_slave_inst_t spi_peripheral_num, const ui
     sercom_instance->SPI.CTRLA.reg = sercom_instance->SPI.CTRLA.reg =
             SERCOM_SPI_CTRLA_MODE_SPI_SLAVE | (clock_polarity << SERCOM_SPI_CTRLA_CPHA_Pos)
             | (data_order << SERCOM_SPI_CTRLA_CPOL_Pos) | (SERCOM_SPI_CTRLA_DIPO(dipo_pad))
-            | (SERCOM_SPI_CTRLA_DOPO(dopo_pad));
+            | (SERCOM_SPI_CTRLA_DOPO(dopo_pad))
+            | (BITMASK_COMPARE(spi_extra_configuration_opt, SPI_BUS_OPT_RUN_IN_STANDBY) ? SERCOM_SPI_CTRLA_RUNSTDBY : 0);
     sercom_instance->SPI.CTRLB.reg = SERCOM_SPI_CTRLB_PLOADEN | SERCOM_SPI_CTRLB_CHSIZE(character_size);
     sercom_instance->SPI.INTENSET.reg = SERCOM_SPI_INTENSET_RXC | SERCOM_SPI_INTENSET_TXC | SERCOM_SPI_INTENSET_SSL;
     sercom_instance->SPI.CTRLA.reg |= SERCOM_SPI_CTRLA_ENABLE;
     spi_wait_for_sync(sercom_instance, SERCOM_SPI_SYNCBUSY_ENABLE);
-    const enum IRQn irq_type = (SERCOM0_IRQn + spi_peripheral_num);
-    enable_irq_handler(irq_type, 2);
+    enable_irq_handlers(SERCOM_FIRST_IRQn(spi_peripheral_num), SERCOM_IRQ_LINES, 2);
     sercom_bustrans_buffer[spi_peripheral_num].transaction_type = SERCOMACT_IDLE_SPI_SLAVE;
     return UHAL_STATUS_OK;
 }
 
 uhal_status_t spi_slave_deinit(const spi_slave_inst_t spi_peripheral_num) {
-    const enum IRQn irq_type = (SERCOM0_IRQn + spi_peripheral_num);
-    NVIC_DisableIRQ(irq_type);
+    disable_irq_handlers(SERCOM_FIRST_IRQn(spi_peripheral_num), SERCOM_IRQ_LINES);
     return UHAL_STATUS_OK;
 }
 
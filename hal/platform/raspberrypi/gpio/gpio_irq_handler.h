@@ -0,0 +1,57 @@
+/**
+* \file            gpio_irq_handler.h
+* \brief           Header file which implements the default GPIO IRQ Handler
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef GPIO_IRQ_HANDLER_H
+#define GPIO_IRQ_HANDLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hardware/structs/iobank0.h"
+
+/**
+ * @brief Default GPIO irq handler, runs the callbacks of the pins with a pending interrupt.
+ *        Only the set bits of the masked status (INTS) of the calling core are visited, so the cost depends on the amount of pending pins
+ *        instead of the amount of pins. Edge events are acknowledged before the callback runs, so an edge during the callback is not lost.
+ * @note Level events can't be acknowledged, the callback has to remove the condition or disable the interrupt.
+ */
+void __not_in_flash_func(gpio_irq_handler)(const void *const hw) {
+    iobank0_hw_t *bank = (iobank0_hw_t *) hw;
+    io_irq_ctrl_hw_t *irq_ctrl = get_core_num() ? &bank->proc1_irq_ctrl : &bank->proc0_irq_ctrl;
+    for (uint8_t reg_num = 0; reg_num <= GPIO_IRQ_REG_NUM(GPIO_NUM_PINS - 1); reg_num++) {
+        uint32_t pending = irq_ctrl->ints[reg_num];
+        while (pending) {
+            const uint8_t event_shift = __builtin_ctz(pending) & ~0x3u;
+            const uint32_t events = (pending >> event_shift) & GPIO_IRQ_EVENT_MASK;
+            const gpio_pin_t pin = {.pin_num = reg_num * GPIO_IRQ_PINS_PER_REG + event_shift / 4};
+            bank->intr[reg_num] = (events & GPIO_IRQ_EDGE_EVENTS) << event_shift;
+            pending &= ~(GPIO_IRQ_EVENT_MASK << event_shift);
+            const gpio_irq_callback_t callback = gpio_irq_callbacks[pin.pin_num];
+            if (callback != NULL) {
+                callback(pin, events);
+            }
+        }
+    }
+}
+
+#endif
@@ -29,6 +29,10 @@
 extern "C" {
 #endif /* __cplusplus */
 
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
 /**
  * @brief The SAMD series support two GPIO levels,
  *        LOW AND HIGH... Use this when using the
@@ -56,7 +60,7 @@ typedef enum {
     GPIO_MODE_F9,
     GPIO_MODE_INPUT,
     GPIO_MODE_OUTPUT,
-    GPIO_MODE_NULL = 0x1F;
+    GPIO_MODE_NULL = 0x1F
 } gpio_mode_t;
 
 /**
@@ -137,18 +141,61 @@ typedef enum {
 } gpio_irq_extra_opt_t;
 
 /**
- * @brief The options which need to be set to get gpio interrupts working on the SAMD series:
- *        irq_channel: The channel which belongs to the input pin
- *        irq_condition: The condition to trigger the IRQ on
- *        irq_extra_opt: Extra options which the SAMD controller supports.
- * @note For minimal functionality at least set the irq_channel and irq_condition options.
+ * @brief The events reported to a GPIO irq callback, these match the four IO_BANK0 INTR bits of a pin.
+ *        More than one event can be reported at once, for example when both edges happened before the IRQ was served.
+ */
+#define GPIO_IRQ_EVENT_LOW_LVL      0x1
+#define GPIO_IRQ_EVENT_HIGH_LVL     0x2
+#define GPIO_IRQ_EVENT_FALLING_EDGE 0x4
+#define GPIO_IRQ_EVENT_RISING_EDGE  0x8
+
+/**
+ * @brief Callback which is run from the IO_BANK0 IRQ when an interrupt on the pin fires.
+ * @param pin The pin on which the interrupt fired
+ * @param events The GPIO_IRQ_EVENT_x bits which were pending
+ */
+typedef void (*gpio_irq_callback_t)(const gpio_pin_t pin, const uint32_t events);
+
+/**
+ * @brief The options which need to be set to get gpio interrupts working on the RPI pico:
+ *        irq_channel: Not used, every pin on the RP2040 has its own interrupt bits
+ *        irq_condition: The condition to trigger the IRQ on, GPIO_IRQ_NONE disables the interrupt
+ *        irq_extra_opt: GPIO_IRQ_WAKE_FROM_SLEEP also enables the pin as dormant wake source, the other extra options are not supported
+ *        irq_callback: The function to run when the interrupt fires (optional when gpio_irq_handler is overridden)
+ * @note For minimal functionality at least set the irq_condition and irq_callback options.
  */
 typedef struct {
     gpio_irq_channel_t   irq_channel;
     gpio_irq_condition_t irq_condition;
     gpio_irq_extra_opt_t irq_extra_opt;
+    gpio_irq_callback_t  irq_callback;
 } gpio_irq_opt_t;
 
+/**
+ * @brief A pin is a struct on the RP2040, so it can't be checked with a static_assert.
+ *        The pin number is checked at runtime instead.
+ */
+#define GPIO_NUM_PINS 30
+
+#define GPIO_PIN_PARAMETER_CHECK(pin) \
+do {                                  \
+}while(0);
+
+#define GPIO_PIN_MODE_PARAMETER_CHECK(pin_mode) \
+do {                                                          \
+static_assert(pin_mode <= GPIO_MODE_OUTPUT, "Selected pin mode not supported!");   \
+}while(0);
+
+#define GPIO_PIN_LEVEL_PARAMETER_CHECK(level) \
+do {                                                          \
+static_assert(level <= GPIO_HIGH, "Selected pin level not supported!");   \
+}while(0);
+
+#define GPIO_PIN_OPTIONS_PARAMETER_CHECK(options) \
+do {                                              \
+static_assert(((options & GPIO_OPT_PULL_UP) && (options & GPIO_OPT_PULL_DOWN)) == 0, "Pull-up and Pull-down functionality on the same pin is not allowed!" );    \
+}while(0);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
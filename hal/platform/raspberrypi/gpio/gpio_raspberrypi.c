@@ -21,14 +21,15 @@
 *
 * Author:          Victor Hogeweij <hogeweyv@gmail.com>
 */
-#include <gpio.h>
+#include "hardware/gpio.h"
 #include "bit_manipulation.h"
-#include "gpio_platform_specific.h"
+#include "gpio/gpio_platform_specific.h"
 #include "hal_gpio.h"
 #include "hardware/sync.h"
 
 #include "hardware/irq.h"
 #include "hardware/structs/iobank0.h"
+#include "pico/platform.h"
 
 #if LIB_PICO_BINARY_INFO
 #include "pico/binary_info.h"
@@ -41,31 +42,73 @@
 
 #define REMOVE_IO_OFFSET(x)             (x - GPIO_MODE_INPUT)
 
-void gpio_set_pin_lvl(const gpio_pin_t pin, gpio_level_t level) {
+/**
+ * @brief Every INTR/INTE register of IO_BANK0 holds the four event bits of 8 pins.
+ */
+#define GPIO_IRQ_PINS_PER_REG           8
+#define GPIO_IRQ_REG_NUM(pin_num)       ((pin_num) / GPIO_IRQ_PINS_PER_REG)
+#define GPIO_IRQ_EVENT_SHIFT(pin_num)   (4 * ((pin_num) % GPIO_IRQ_PINS_PER_REG))
+#define GPIO_IRQ_EVENT_MASK             0xF
+#define GPIO_IRQ_EDGE_EVENTS            (GPIO_IRQ_EVENT_FALLING_EDGE | GPIO_IRQ_EVENT_RISING_EDGE)
+
+/**
+ * @brief The callbacks given to gpio_set_interrupt_on_pin, indexed by pin number.
+ */
+static volatile gpio_irq_callback_t gpio_irq_callbacks[GPIO_NUM_PINS];
+
+/**
+ * @brief Whether the IO_BANK0 handler is installed on core 0 and core 1.
+ */
+static bool gpio_irq_handler_installed[2];
+
+/**
+ * @brief Translation of gpio_irq_condition_t to the IO_BANK0 event bit of the pin.
+ */
+static const uint8_t gpio_irq_condition_to_event[] = {
+    [GPIO_IRQ_NONE] = 0,
+    [GPIO_IRQ_COND_RISING_EDGE] = GPIO_IRQ_EVENT_RISING_EDGE,
+    [GPIO_IRQ_COND_FALLING_EDGE] = GPIO_IRQ_EVENT_FALLING_EDGE,
+    [GPIO_IRQ_COND_HIGH_LVL] = GPIO_IRQ_EVENT_HIGH_LVL,
+    [GPIO_IRQ_COND_LOW_LVL] = GPIO_IRQ_EVENT_LOW_LVL
+};
+
+#include "gpio/gpio_irq_handler.h"
+
+static void __not_in_flash_func(gpio_bank0_irq_handler)(void) {
+    gpio_irq_handler(iobank0_hw);
+}
+
+uhal_status_t gpio_set_pin_lvl(const gpio_pin_t pin, gpio_level_t level) {
     gpio_put(pin.pin_num, level);
+    return UHAL_STATUS_OK;
 }
 
-void gpio_toggle_pin_output(const gpio_pin_t pin) {
+uhal_status_t gpio_toggle_pin_output(const gpio_pin_t pin) {
     const uint32_t mask = 1ul << pin.pin_num;
     gpio_xor_mask(mask);
+    return UHAL_STATUS_OK;
 }
 
-gpio_level_t gpio_get_pin_level(const gpio_pin_t pin) {
+gpio_level_t gpio_get_pin_lvl(const gpio_pin_t pin) {
     return gpio_get(pin.pin_num);
 }
 
-void gpio_set_pin_mode(const gpio_pin_t pin, gpio_mode_t pin_mode) {
+uhal_status_t gpio_set_pin_mode(const gpio_pin_t pin, gpio_mode_t pin_mode) {
+    if (pin.pin_num >= GPIO_NUM_PINS) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
     //invalid_params_if(GPIO, ((uint32_t)fn << IO_BANK0_GPIO0_CTRL_FUNCSEL_LSB) & ~IO_BANK0_GPIO0_CTRL_FUNCSEL_BITS);
     // Set input enable on, output disable off
     hw_write_masked(&padsbank0_hw->io[pin.pin_num], PADS_BANK0_GPIO0_IE_BITS, PADS_BANK0_GPIO0_IE_BITS | PADS_BANK0_GPIO0_OD_BITS);
     // Zero all fields apart from fsel; we want this IO to do what the peripheral tells it.
     // This doesn't affect e.g. pullup/pulldown, as these are in pad controls.
-    if (BITMASK_COMPARE(pin_mode, GPIO_MODE_INPUT) || BITMASK_COMPARE(pin_mode, GPIO_MODE_OUTPUT)) {
+    if (pin_mode == GPIO_MODE_INPUT || pin_mode == GPIO_MODE_OUTPUT) {
         iobank0_hw->io[pin.pin_num].ctrl = GPIO_MODE_F5 << IO_BANK0_GPIO0_CTRL_FUNCSEL_LSB;
         gpio_set_dir(pin.pin_num, REMOVE_IO_OFFSET(pin_mode));
     } else {
         iobank0_hw->io[pin.pin_num].ctrl = pin_mode << IO_BANK0_GPIO0_CTRL_FUNCSEL_LSB;
     }
+    return UHAL_STATUS_OK;
 }
 
 gpio_mode_t gpio_get_pin_mode(const gpio_pin_t pin) {
@@ -80,7 +123,7 @@ gpio_mode_t gpio_get_pin_mode(const gpio_pin_t pin) {
     }
 }
 
-void gpio_set_pin_options(const gpio_pin_t pin, const gpio_opt_t opt) {
+uhal_status_t gpio_set_pin_options(const gpio_pin_t pin, const gpio_opt_t opt) {
     const uint8_t driver_mask_cmp_val = GPIO_OPT_DRIVE_STRENGTH_HIGH | GPIO_OPT_DRIVE_STRENGTH_MEDIUM 
                                         | GPIO_OPT_DRIVE_STRENGTH_LOW | GPIO_OPT_DRIVE_STRENGTH_VLOW;
 
@@ -111,12 +154,13 @@ void gpio_set_pin_options(const gpio_pin_t pin, const gpio_opt_t opt) {
         }
     }
 
-    const uint8_t pullup_en = BITMASK_COMPARE(pin.pin_num, GPIO_OPT_PULL_UP);
-    const uint8_t pulldown_en = BITMASK_COMPARE(pin.pin_num, GPIO_OPT_PULL_DOWN); 
+    const bool pullup_en = BITMASK_COMPARE(opt, GPIO_OPT_PULL_UP);
+    const bool pulldown_en = BITMASK_COMPARE(opt, GPIO_OPT_PULL_DOWN);
     gpio_set_pulls(pin.pin_num, pullup_en, pulldown_en);
 
     const uint8_t slew_rate_val = BITMASK_COMPARE(opt, GPIO_OPT_SLEW_RATE_HIGH) ? GPIO_SLEW_RATE_FAST : GPIO_SLEW_RATE_SLOW;
     gpio_set_slew_rate(pin.pin_num, slew_rate_val);
+    return UHAL_STATUS_OK;
 }
 
 gpio_opt_t gpio_get_pin_options(const gpio_pin_t pin) {
@@ -128,5 +172,51 @@ gpio_opt_t gpio_get_pin_options(const gpio_pin_t pin) {
     return options;
 }
 
-void gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq_opt) {
+uhal_status_t gpio_set_interrupt_on_pin(const gpio_pin_t pin, gpio_irq_opt_t irq_opt) {
+    if (pin.pin_num >= GPIO_NUM_PINS || irq_opt.irq_condition > GPIO_IRQ_COND_LOW_LVL
+        || (irq_opt.irq_extra_opt != GPIO_IRQ_EXTRA_NONE && irq_opt.irq_extra_opt != GPIO_IRQ_WAKE_FROM_SLEEP)) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+
+    /*
+     * The interrupt is enabled on the core which calls this function, so the IRQ is served by that core.
+     */
+    const uint core_num = get_core_num();
+    io_irq_ctrl_hw_t *irq_ctrl = core_num ? &iobank0_hw->proc1_irq_ctrl : &iobank0_hw->proc0_irq_ctrl;
+    const uint8_t reg_num = GPIO_IRQ_REG_NUM(pin.pin_num);
+    const uint32_t pin_event_mask = GPIO_IRQ_EVENT_MASK << GPIO_IRQ_EVENT_SHIFT(pin.pin_num);
+    const uint32_t event = (uint32_t) gpio_irq_condition_to_event[irq_opt.irq_condition] << GPIO_IRQ_EVENT_SHIFT(pin.pin_num);
+
+    hw_clear_bits(&irq_ctrl->inte[reg_num], pin_event_mask);
+    hw_clear_bits(&iobank0_hw->dormant_wake_inte[reg_num], pin_event_mask);
+    if (irq_opt.irq_condition == GPIO_IRQ_NONE) {
+        gpio_irq_callbacks[pin.pin_num] = NULL;
+        return UHAL_STATUS_OK;
+    }
+
+    /*
+     * Check whether pin given is set as output or input. If set as output, make it an input.
+     */
+    if (gpio_get_dir(pin.pin_num)) {
+        gpio_set_dir(pin.pin_num, false);
+    }
+    gpio_set_input_enabled(pin.pin_num, true);
+
+    gpio_irq_callbacks[pin.pin_num] = irq_opt.irq_callback;
+
+    /*
+     * Clear edges which were latched before the interrupt got enabled, writes to the level bits are ignored.
+     */
+    iobank0_hw->intr[reg_num] = pin_event_mask;
+    hw_set_bits(&irq_ctrl->inte[reg_num], event);
+    if (irq_opt.irq_extra_opt == GPIO_IRQ_WAKE_FROM_SLEEP) {
+        hw_set_bits(&iobank0_hw->dormant_wake_inte[reg_num], event);
+    }
+
+    if (!gpio_irq_handler_installed[core_num]) {
+        gpio_irq_handler_installed[core_num] = true;
+        irq_add_shared_handler(IO_IRQ_BANK0, gpio_bank0_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+    return UHAL_STATUS_OK;
 }
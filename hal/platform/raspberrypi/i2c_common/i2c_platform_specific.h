@@ -0,0 +1,221 @@
+/**
+* \file            i2c_platform_specific.h
+* \brief           Include file with platform specific options for the I2C module
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef I2C_MASTER_PLATFORM_SPECIFIC
+#define I2C_MASTER_PLATFORM_SPECIFIC
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "error_handling.h"
+#include "hardware/i2c.h"
+#include "irq/bustransaction.h"
+#include "gpio/gpio_platform_specific.h"
+
+typedef enum {
+    I2C_PERIPHERAL_0,
+    I2C_PERIPHERAL_1
+} i2c_periph_inst_t;
+
+#define I2C_INST_NUM 2
+
+/**
+ * @brief The DW_apb_i2c blocks on the RP2040 are always clocked by clk_sys,
+ *        the SCL timing is calculated from the frequency reported by the clock driver of the pico-sdk.
+ */
+typedef enum {
+    I2C_CLK_SOURCE_USE_DEFAULT = 0x00,
+    I2C_CLK_SOURCE_CLK_SYS = 0x01
+} i2c_clock_sources_t;
+
+/**
+ * @brief I2C_EXTRA_OPT_NO_DMA feeds every transaction through the FIFOs using the CPU,
+ *        which leaves the three DMA channels otherwise claimed by i2c_host_init free for other drivers.
+ */
+typedef enum {
+    I2C_EXTRA_OPT_NONE = 0,
+    I2C_EXTRA_OPT_NO_DMA = 0x01
+} i2c_extra_opt_t;
+
+/**
+ * @brief Helpers for 10-bit addressing. Addresses above 0x7F are always sent as 10-bit addresses,
+ *        I2C_ADDR_10BIT can be used to send a 10-bit address in the range 0x000-0x07F.
+ */
+#define I2C_ADDR_10BIT_FLAG    0x8000
+#define I2C_ADDR_10BIT(addr)   ((addr) | I2C_ADDR_10BIT_FLAG)
+#define I2C_ADDR_VALUE(addr)   ((addr) & 0x3FF)
+#define I2C_ADDR_IS_10BIT(addr) (((addr) & I2C_ADDR_10BIT_FLAG) || I2C_ADDR_VALUE(addr) > 0x7F)
+
+/**
+ * @brief The depth of the TX (command) and RX FIFO of the DW_apb_i2c.
+ *        Transactions up to this size are queued in the FIFO at once, longer writes and reads are moved by DMA.
+ *        Writes are copied into a command staging buffer of I2C_HOST_DMA_STAGING_SIZE commands,
+ *        two buffers per peripheral are used so the next chunk is prepared while the previous chunk is sent.
+ */
+#define I2C_HOST_FIFO_DEPTH 16
+
+#ifndef I2C_HOST_DMA_STAGING_SIZE
+#define I2C_HOST_DMA_STAGING_SIZE 64
+#endif
+
+/**
+ * @brief A transaction fails with UHAL_STATUS_I2C_TIMEOUT when it doesn't finish within
+ *        I2C_HOST_TIMEOUT_BASE_US plus I2C_HOST_TIMEOUT_SCL_PERIODS_PER_BYTE SCL periods for every byte (which leaves room for clock stretching).
+ */
+#ifndef I2C_HOST_TIMEOUT_BASE_US
+#define I2C_HOST_TIMEOUT_BASE_US 1000
+#endif
+#ifndef I2C_HOST_TIMEOUT_SCL_PERIODS_PER_BYTE
+#define I2C_HOST_TIMEOUT_SCL_PERIODS_PER_BYTE 20
+#endif
+
+/**
+ * @brief The amount of devices for which a separate retry policy can be set using i2c_host_set_device_retry_policy.
+ */
+#define I2C_HOST_MAX_DEVICE_RETRY_POLICIES 4
+
+/**
+ * @brief The retry policies of a peripheral. Retries are done by the blocking functions,
+ *        waiting backoff_scl_periods SCL periods before the first retry and doubling the backoff every retry.
+ */
+typedef struct {
+    uint8_t max_retries;
+    uint8_t retry_on;
+    uint16_t backoff_scl_periods;
+} i2c_host_retry_policy_t;
+
+typedef struct {
+    uint8_t in_use;
+    uint16_t addr;
+    i2c_host_retry_policy_t policy;
+} i2c_host_device_retry_policy_t;
+
+typedef struct {
+    i2c_host_retry_policy_t default_policy;
+    i2c_host_device_retry_policy_t device_policies[I2C_HOST_MAX_DEVICE_RETRY_POLICIES];
+} i2c_host_retry_state_t;
+
+extern volatile i2c_host_retry_state_t i2c_host_retry_states[I2C_INST_NUM];
+
+/**
+ * @brief The range of addresses probed by i2c_host_scan.
+ */
+#define I2C_HOST_SCAN_FIRST_ADDR 0x08
+#define I2C_HOST_SCAN_LAST_ADDR  0x77
+
+/**
+ * @brief The device-presence cache of a peripheral, bit (addr % 32) of word (addr / 32) is set
+ *        in probed when the address was probed by a scan and in present when a device answered.
+ */
+typedef struct {
+    uint32_t probed[4];
+    uint32_t present[4];
+    uint8_t scanning;
+} i2c_host_presence_t;
+
+extern volatile i2c_host_presence_t i2c_host_presence[I2C_INST_NUM];
+
+#define I2C_HOST_INIT_FUNC_PARAMETER_CHECK(i2c_peripheral_num, clock_sources, periph_clk_freq, baud_rate_freq, extra_configuration_options)          \
+    do {                                                                                                                                             \
+        const uint32_t max_freq = 133000000;                                                                                                         \
+        const uint32_t max_supported_baud_rate = 1000000;                                                                                            \
+        const uint32_t min_supported_baud_rate = 10000;                                                                                              \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert(clock_sources <= I2C_CLK_SOURCE_CLK_SYS && clock_sources >= I2C_CLK_SOURCE_USE_DEFAULT,                                        \
+                      "Invalid clock-source used for the i2c host driver!");                                                                         \
+        static_assert(periph_clk_freq <= max_freq, "I2C peripheral clock frequency higher than maximum allowed frequency");                          \
+        static_assert(baud_rate_freq <= max_supported_baud_rate && baud_rate_freq >= min_supported_baud_rate,                                        \
+                      "Unsupported baud rate option set on I2C host driver!");                                                                       \
+        static_assert((extra_configuration_options & ~I2C_EXTRA_OPT_NO_DMA) == 0,                                                                    \
+                      "Unsupported extra configurations options set on I2C host driver!");                                                           \
+    } while (0);
+
+#define I2C_HOST_DEINIT_FUNC_PARAMETER_CHECK(i2c_peripheral_num)                                                                                     \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+    } while (0);
+
+#define I2C_HOST_SET_BUS_RECOVERY_PINS_FUNC_PARAMETER_CHECK(i2c_peripheral_num, scl_pin, sda_pin)                                                   \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+    } while (0);
+
+#define I2C_HOST_RECOVER_BUS_FUNC_PARAMETER_CHECK(i2c_peripheral_num)                                                                            \
+    do {                                                                                                                                         \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                          \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                           \
+    } while (0);
+
+#define I2C_HOST_WRITE_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, write_buff, size, stop_bit)                                                    \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                            \
+        static_assert(write_buff != NULL && sizeof(write_buff) >= size, "writebuffer is equal to NULL or buffer overflow!");                         \
+        static_assert(size > 0, "The DW_apb_i2c can't send an address-only write!");                                                                \
+        static_assert(stop_bit <= 1, "Stop-bit can't have a higher value than 1!");                                                                  \
+    } while (0);
+
+#define I2C_HOST_READ_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, read_buff, size)                                                                \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                            \
+        static_assert(read_buff != NULL && sizeof(read_buff) >= size, "readbuffer is equal to NULL or buffer overflow!");                            \
+        static_assert(size > 0, "Can't read zero bytes!");                                                                                           \
+    } while (0);
+
+#define I2C_HOST_SET_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on)                               \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+        static_assert(max_retries <= 0xFF && backoff_scl_periods <= 0xFFFF, "Retry count or backoff out of range!");                                \
+        static_assert((retry_on & ~(I2C_ERROR_FLAG_ADDR_NACK | I2C_ERROR_FLAG_DATA_NACK | I2C_ERROR_FLAG_ARBLOST)) == 0,                             \
+                      "Only NACKs and arbitration loss can be retried!");                                                                            \
+    } while (0);
+
+#define I2C_HOST_SET_DEVICE_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, addr, max_retries, backoff_scl_periods, retry_on)                  \
+    do {                                                                                                                                             \
+        I2C_HOST_SET_RETRY_POLICY_FUNC_PARAMETER_CHECK(i2c_peripheral_num, max_retries, backoff_scl_periods, retry_on);                              \
+        static_assert((addr & ~I2C_ADDR_10BIT_FLAG) <= 1023 && I2C_ADDR_VALUE(addr) > 0, "Invalid I2C address given!");                            \
+    } while (0);
+
+#define I2C_HOST_SCAN_FUNC_PARAMETER_CHECK(i2c_peripheral_num)                                                                                       \
+    do {                                                                                                                                             \
+        static_assert(i2c_peripheral_num <= I2C_PERIPHERAL_1 && i2c_peripheral_num >= I2C_PERIPHERAL_0,                                              \
+                      "Invalid i2c peripheral instance number given to host driver!");                                                               \
+    } while (0);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,849 @@
+/**
+* \file            i2c.c
+* \brief           Source file which implements the standard I2C API functions
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef DISABLE_I2C_HOST_MODULE
+
+#include <hal_i2c_host.h>
+#include <hal_gpio.h>
+#include <stdbool.h>
+#include "error_handling.h"
+#include "bit_manipulation.h"
+#include "hal_os.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/timer.h"
+
+static i2c_inst_t *const i2c_host_peripheral_mapping_table[I2C_INST_NUM] = {i2c0, i2c1};
+
+/**
+ * @brief The pins used for bus recovery on each peripheral, set using i2c_host_set_bus_recovery_pins.
+ */
+typedef struct {
+    uint8_t configured;
+    gpio_pin_t scl_pin;
+    gpio_pin_t sda_pin;
+} i2c_bus_recovery_pins_t;
+
+static i2c_bus_recovery_pins_t i2c_host_recovery_pins[I2C_INST_NUM];
+
+/**
+ * @brief The baud rate achieved by i2c_host_init, used for the timeouts and the backoff of the retries.
+ */
+static uint32_t i2c_host_baud_rate_freq[I2C_INST_NUM];
+
+/**
+ * @brief The state of the command stream of each peripheral.
+ *        Every byte of a transaction is a command in the TX FIFO of the DW_apb_i2c (a data byte to send or a read request),
+ *        the RESTART and STOP bits of a command make the controller send a repeated start before or a stop after that byte.
+ *        restart_on_next is set when the last transaction ended without a stop, so the first command of the next transaction
+ *        gets a RESTART and a write without stop followed by a read becomes one transfer with a repeated start.
+ */
+typedef struct {
+    bool target_valid;
+    uint16_t target_addr;
+    bool restart_on_next;
+    bool restart_first;
+    bool stop;
+    bool pending;
+    bool notify_done;
+    bool use_dma;
+    bool dma_claimed;
+    bool rx_dma_running;
+    uint tx_dma_channel;
+    uint stop_dma_channel;
+    uint rx_dma_channel;
+    const uint8_t *write_buffer;
+    size_t write_size;
+    size_t read_size;
+    size_t cmds_issued;
+    uint16_t last_read_cmd;
+    uint64_t deadline;
+} i2c_host_state_t;
+
+static i2c_host_state_t i2c_host_states[I2C_INST_NUM];
+
+/**
+ * @brief The double-buffered command staging buffers of the DMA writes,
+ *        a narrow write to IC_DATA_CMD would also write the command bits so every command is written as a 16-bit word.
+ */
+static uint16_t i2c_host_dma_staging[I2C_INST_NUM][2][I2C_HOST_DMA_STAGING_SIZE];
+
+/**
+ * @brief The read request sent by the TX DMA channel for every byte of a DMA read (except the first and the last).
+ */
+static const uint16_t i2c_host_read_cmd = I2C_IC_DATA_CMD_CMD_BITS;
+
+static volatile bustransaction_t i2c_host_transactions[I2C_INST_NUM];
+
+/**
+ * @brief The callbacks set with i2c_host_set_transaction_done_callback.
+ */
+static i2c_host_transaction_done_cb_t i2c_host_transaction_done_callbacks[I2C_INST_NUM];
+
+volatile i2c_host_retry_state_t i2c_host_retry_states[I2C_INST_NUM];
+
+volatile i2c_host_presence_t i2c_host_presence[I2C_INST_NUM];
+
+/**
+ * @brief The bus recovery is clocked at 100KHz, the standard-mode speed every client device supports.
+ */
+#define I2C_RECOVERY_SCL_FREQ                     100000
+#define I2C_RECOVERY_CLOCK_PULSES                 9
+
+/**
+ * @brief The maximum time to wait for the controller to send a stop after a transaction was aborted.
+ */
+#define I2C_ABORT_TIMEOUT_US                      1000
+
+static inline i2c_hw_t *get_i2c_hw(const i2c_periph_inst_t i2c_peripheral_num) {
+    return i2c_get_hw(i2c_host_peripheral_mapping_table[i2c_peripheral_num]);
+}
+
+/**
+ * @brief Helper function which returns the command for a byte of the running transaction,
+ *        the write bytes come first followed by the read requests.
+ */
+static inline uint16_t get_command(const i2c_host_state_t *state, const size_t index) {
+    const size_t amount_of_cmds = state->write_size + state->read_size;
+    uint16_t cmd = (index < state->write_size) ? state->write_buffer[index] : I2C_IC_DATA_CMD_CMD_BITS;
+    /* The first read after the write bytes gets a restart, which also turns the direction of a 10-bit transfer */
+    if ((index == 0 && state->restart_first) || (index == state->write_size && index != 0)) {
+        cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+    }
+    if (index == amount_of_cmds - 1 && state->stop) {
+        cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+    }
+    return cmd;
+}
+
+static inline bool transaction_aborted(const i2c_hw_t *hw) {
+    return hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+}
+
+static inline bool deadline_passed(const i2c_host_state_t *state) {
+    return time_us_64() > state->deadline;
+}
+
+static inline uint64_t get_deadline(const i2c_periph_inst_t i2c_peripheral_num, const size_t amount_of_bytes) {
+    const uint64_t scl_periods = (uint64_t) (amount_of_bytes + 1) * I2C_HOST_TIMEOUT_SCL_PERIODS_PER_BYTE;
+    return time_us_64() + I2C_HOST_TIMEOUT_BASE_US + (scl_periods * 1000000) / i2c_host_baud_rate_freq[i2c_peripheral_num];
+}
+
+/**
+ * @brief Helper function which records an error in the transaction info,
+ *        the status holds the first error of the current attempt while first_error holds the first error of the transaction.
+ */
+static void record_error(volatile bustransaction_t *transaction, const uhal_status_t error, const uint8_t error_flag) {
+    transaction->error_mask |= error_flag;
+    transaction->last_error = error;
+    if (transaction->first_error == UHAL_STATUS_OK) {
+        transaction->first_error = error;
+    }
+    if (transaction->status == UHAL_STATUS_OK) {
+        transaction->status = error;
+    }
+}
+
+static inline void reset_transaction_info(volatile bustransaction_t *transaction) {
+    transaction->status = UHAL_STATUS_OK;
+    transaction->first_error = UHAL_STATUS_OK;
+    transaction->last_error = UHAL_STATUS_OK;
+    transaction->error_mask = 0;
+    transaction->nack_offset = 0;
+    transaction->retry_cnt = 0;
+}
+
+/**
+ * @brief Helper function which checks the presence cache, an address is only known to be absent after a scan probed it.
+ */
+static inline bool device_known_absent(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr) {
+    if (I2C_ADDR_IS_10BIT(addr)) {
+        return false;
+    }
+    const volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    const uint16_t addr_val = I2C_ADDR_VALUE(addr);
+    const uint32_t addr_bit = 1ul << (addr_val % 32);
+    return (presence->probed[addr_val / 32] & addr_bit) && !(presence->present[addr_val / 32] & addr_bit);
+}
+
+static i2c_host_retry_policy_t get_retry_policy(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr) {
+    const volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[i2c_peripheral_num];
+    const volatile i2c_host_retry_policy_t *policy = &retry_state->default_policy;
+    for (uint8_t slot = 0; slot < I2C_HOST_MAX_DEVICE_RETRY_POLICIES; slot++) {
+        if (retry_state->device_policies[slot].in_use && retry_state->device_policies[slot].addr == addr) {
+            policy = &retry_state->device_policies[slot].policy;
+            break;
+        }
+    }
+    const i2c_host_retry_policy_t active_policy = {
+            .max_retries = policy->max_retries,
+            .retry_on = policy->retry_on,
+            .backoff_scl_periods = policy->backoff_scl_periods
+    };
+    return active_policy;
+}
+
+/**
+ * @brief Helper function which sets the target address. TAR and the 10-bit addressing bit of IC_CON can only be written
+ *        while the controller is disabled, so they are only rewritten when the address differs from the last transaction.
+ */
+static void set_target_addr(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr) {
+    i2c_host_state_t *state = &i2c_host_states[i2c_peripheral_num];
+    if (state->target_valid && state->target_addr == addr) {
+        return;
+    }
+    i2c_hw_t *hw = get_i2c_hw(i2c_peripheral_num);
+    hw->enable = 0;
+    hw->tar = I2C_ADDR_VALUE(addr);
+    if (I2C_ADDR_IS_10BIT(addr)) {
+        hw->con |= I2C_IC_CON_IC_10BITADDR_MASTER_BITS;
+    } else {
+        hw->con &= ~I2C_IC_CON_IC_10BITADDR_MASTER_BITS;
+    }
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    state->target_addr = addr;
+    state->target_valid = true;
+    /* Disabling the controller ends a transfer which was held without a stop */
+    state->restart_on_next = false;
+}
+
+/**
+ * @brief Helper function which moves the received bytes from the RX FIFO to the read buffer, used when the read isn't done by DMA.
+ */
+static inline void drain_rx_fifo(i2c_hw_t *hw, volatile bustransaction_t *transaction) {
+    while (hw->rxflr && transaction->buf_cnt < transaction->buf_size) {
+        transaction->read_buffer[transaction->buf_cnt++] = (uint8_t) (hw->data_cmd & I2C_IC_DATA_CMD_DAT_BITS);
+    }
+}
+
+/**
+ * @brief Helper function which queues the next commands of the transaction using the CPU.
+ *        At most I2C_HOST_FIFO_DEPTH read requests are outstanding, so the RX FIFO can never overflow.
+ * @return false when the transaction was aborted or timed out while queueing
+ */
+static bool feed_commands(i2c_hw_t *hw, i2c_host_state_t *state, volatile bustransaction_t *transaction, const size_t amount_of_cmds) {
+    for (size_t cmd = 0; cmd < amount_of_cmds; cmd++) {
+        const bool read_request = state->cmds_issued >= state->write_size;
+        while (!(hw->status & I2C_IC_STATUS_TFNF_BITS)
+               || (read_request && !state->rx_dma_running
+                   && (state->cmds_issued - state->write_size) - transaction->buf_cnt >= I2C_HOST_FIFO_DEPTH)) {
+            if (!state->rx_dma_running) {
+                drain_rx_fifo(hw, transaction);
+            }
+            if (transaction_aborted(hw) || deadline_passed(state)) {
+                return false;
+            }
+        }
+        /* A command queued after an abort is flushed, checking first keeps the NACK offset exact */
+        if (transaction_aborted(hw)) {
+            return false;
+        }
+        hw->data_cmd = get_command(state, state->cmds_issued);
+        state->cmds_issued++;
+    }
+    return true;
+}
+
+static bool wait_for_dma_channel(const i2c_hw_t *hw, const i2c_host_state_t *state, const uint channel) {
+    while (dma_channel_is_busy(channel)) {
+        if (transaction_aborted(hw) || deadline_passed(state)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline dma_channel_config get_cmd_dma_config(const i2c_periph_inst_t i2c_peripheral_num, const uint channel, const bool read_increment) {
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, read_increment);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(i2c_host_peripheral_mapping_table[i2c_peripheral_num], true));
+    return config;
+}
+
+/**
+ * @brief Helper function which sends the write bytes using DMA. The commands are built in one staging buffer
+ *        while the other staging buffer is sent, the last chunk is left running.
+ * @return false when the transaction was aborted or timed out while sending
+ */
+static bool dma_write(const i2c_periph_inst_t i2c_peripheral_num, i2c_hw_t *hw, i2c_host_state_t *state) {
+    const dma_channel_config config = get_cmd_dma_config(i2c_peripheral_num, state->tx_dma_channel, true);
+    uint8_t staging_buffer = 0;
+    while (state->cmds_issued < state->write_size) {
+        const size_t remaining = state->write_size - state->cmds_issued;
+        const size_t chunk_size = (remaining < I2C_HOST_DMA_STAGING_SIZE) ? remaining : I2C_HOST_DMA_STAGING_SIZE;
+        uint16_t *staging = i2c_host_dma_staging[i2c_peripheral_num][staging_buffer];
+        for (size_t cmd = 0; cmd < chunk_size; cmd++) {
+            staging[cmd] = get_command(state, state->cmds_issued + cmd);
+        }
+        if (!wait_for_dma_channel(hw, state, state->tx_dma_channel)) {
+            return false;
+        }
+        dma_channel_configure(state->tx_dma_channel, &config, &hw->data_cmd, staging, chunk_size, true);
+        /* Counted as issued straight away, which makes the NACK offset of a DMA write an upper bound */
+        state->cmds_issued += chunk_size;
+        staging_buffer ^= 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Helper function which starts a DMA read. The RX channel copies the received bytes into the read buffer,
+ *        the first read request is queued by the CPU (it might need a restart), the TX channel queues the read requests in between
+ *        and is chained to the stop channel which queues the last read request (with the stop).
+ */
+static bool dma_read(const i2c_periph_inst_t i2c_peripheral_num, i2c_hw_t *hw, i2c_host_state_t *state, volatile bustransaction_t *transaction) {
+    i2c_inst_t *i2c_inst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    dma_channel_config rx_config = dma_channel_get_default_config(state->rx_dma_channel);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, true);
+    channel_config_set_dreq(&rx_config, i2c_get_dreq(i2c_inst, false));
+    dma_channel_configure(state->rx_dma_channel, &rx_config, transaction->read_buffer, &hw->data_cmd, state->read_size, true);
+    state->rx_dma_running = true;
+
+    if (!feed_commands(hw, state, transaction, 1)) {
+        return false;
+    }
+    state->last_read_cmd = get_command(state, state->write_size + state->read_size - 1);
+    const dma_channel_config stop_config = get_cmd_dma_config(i2c_peripheral_num, state->stop_dma_channel, false);
+    dma_channel_configure(state->stop_dma_channel, &stop_config, &hw->data_cmd, &state->last_read_cmd, 1, false);
+    dma_channel_config tx_config = get_cmd_dma_config(i2c_peripheral_num, state->tx_dma_channel, false);
+    channel_config_set_chain_to(&tx_config, state->stop_dma_channel);
+    dma_channel_configure(state->tx_dma_channel, &tx_config, &hw->data_cmd, &i2c_host_read_cmd, state->read_size - 2, true);
+    state->cmds_issued += state->read_size - 1;
+    return true;
+}
+
+static inline void abort_dma_channels(i2c_host_state_t *state) {
+    if (!state->use_dma) {
+        return;
+    }
+    /* The TX channel is aborted before the channel it is chained to */
+    dma_channel_abort(state->tx_dma_channel);
+    dma_channel_abort(state->stop_dma_channel);
+    dma_channel_abort(state->rx_dma_channel);
+    state->rx_dma_running = false;
+}
+
+static inline bool dma_channels_busy(const i2c_host_state_t *state) {
+    return state->use_dma
+           && (dma_channel_is_busy(state->tx_dma_channel) || dma_channel_is_busy(state->stop_dma_channel)
+               || dma_channel_is_busy(state->rx_dma_channel));
+}
+
+/**
+ * @brief Helper function which decodes the abort source of an aborted transaction. The controller flushes the TX FIFO
+ *        and sends a stop after an abort, TX_FLUSH_CNT holds the amount of commands it flushed.
+ */
+static void handle_abort(i2c_hw_t *hw, i2c_host_state_t *state, volatile bustransaction_t *transaction) {
+    const uint32_t abort_source = hw->tx_abrt_source;
+    abort_dma_channels(state);
+    (void) hw->clr_tx_abrt;
+    if (abort_source & (I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS | I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR1_NOACK_BITS
+                        | I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR2_NOACK_BITS)) {
+        record_error(transaction, UHAL_STATUS_I2C_NACK, I2C_ERROR_FLAG_ADDR_NACK);
+    } else if (abort_source & I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS) {
+        const size_t flushed_cmds = abort_source >> I2C_IC_TX_ABRT_SOURCE_TX_FLUSH_CNT_LSB;
+        transaction->nack_offset = (state->cmds_issued > flushed_cmds) ? state->cmds_issued - flushed_cmds - 1 : 0;
+        record_error(transaction, UHAL_STATUS_I2C_NACK, I2C_ERROR_FLAG_DATA_NACK);
+    } else if (abort_source & I2C_IC_TX_ABRT_SOURCE_ARB_LOST_BITS) {
+        record_error(transaction, UHAL_STATUS_I2C_ARBSTATE_LOST, I2C_ERROR_FLAG_ARBLOST);
+    } else {
+        record_error(transaction, UHAL_STATUS_I2C_BUSERR, I2C_ERROR_FLAG_BUSERR);
+    }
+}
+
+/**
+ * @brief Helper function which ends a transaction which didn't finish in time. The controller is told to abort the transfer,
+ *        when that doesn't work (e.g. SCL is held low) the controller is disabled and the bus is recovered when recovery pins are set.
+ */
+static void handle_timeout(const i2c_periph_inst_t i2c_peripheral_num, i2c_hw_t *hw, i2c_host_state_t *state,
+                           volatile bustransaction_t *transaction) {
+    abort_dma_channels(state);
+    hw->enable |= I2C_IC_ENABLE_ABORT_BITS;
+    const uint64_t abort_deadline = time_us_64() + I2C_ABORT_TIMEOUT_US;
+    while ((hw->enable & I2C_IC_ENABLE_ABORT_BITS) && time_us_64() < abort_deadline) {};
+    (void) hw->clr_tx_abrt;
+    record_error(transaction, UHAL_STATUS_I2C_TIMEOUT, I2C_ERROR_FLAG_TIMEOUT);
+    if (hw->enable & I2C_IC_ENABLE_ABORT_BITS) {
+        hw->enable = 0;
+        hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    }
+    if (i2c_host_recovery_pins[i2c_peripheral_num].configured) {
+        i2c_host_recover_bus(i2c_peripheral_num);
+    }
+}
+
+static inline bool command_stream_done(const i2c_hw_t *hw, const i2c_host_state_t *state) {
+    if (state->stop) {
+        return hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+    }
+    /* Without a stop the controller holds SCL low once the TX FIFO is empty and the last byte has been shifted out */
+    return hw->txflr == 0 && (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_EMPTY_BITS);
+}
+
+/**
+ * @brief Helper function which calls the transaction done callback of the peripheral (when set).
+ */
+static inline void notify_transaction_done(const i2c_periph_inst_t i2c_peripheral_num, const uhal_status_t status) {
+    const i2c_host_transaction_done_cb_t transaction_done_cb = i2c_host_transaction_done_callbacks[i2c_peripheral_num];
+    if (transaction_done_cb != NULL) {
+        transaction_done_cb(i2c_peripheral_num, status);
+    }
+}
+
+/**
+ * @brief Helper function which finishes the running transaction of a peripheral.
+ * @param wait Whether to wait for the transaction to finish or to return straight away when it is still running
+ * @return The status of the transaction, or UHAL_STATUS_PERIPHERAL_IN_USE_WARNING when it is still running
+ */
+static uhal_status_t finish_transaction(const i2c_periph_inst_t i2c_peripheral_num, const bool wait) {
+    i2c_host_state_t *state = &i2c_host_states[i2c_peripheral_num];
+    volatile bustransaction_t *transaction = &i2c_host_transactions[i2c_peripheral_num];
+    if (!state->pending) {
+        return (uhal_status_t) transaction->status;
+    }
+    i2c_hw_t *hw = get_i2c_hw(i2c_peripheral_num);
+    while (true) {
+        if (transaction_aborted(hw)) {
+            handle_abort(hw, state, transaction);
+            break;
+        }
+        if (!state->rx_dma_running) {
+            drain_rx_fifo(hw, transaction);
+        }
+        if (!dma_channels_busy(state) && command_stream_done(hw, state)) {
+            /* An abort at the last byte shows up together with the stop */
+            if (transaction_aborted(hw)) {
+                handle_abort(hw, state, transaction);
+            } else if (!state->rx_dma_running) {
+                drain_rx_fifo(hw, transaction);
+            } else {
+                transaction->buf_cnt = state->read_size;
+            }
+            break;
+        }
+        if (deadline_passed(state)) {
+            handle_timeout(i2c_peripheral_num, hw, state, transaction);
+            break;
+        }
+        if (!wait) {
+            return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+        }
+    }
+    (void) hw->clr_stop_det;
+    state->rx_dma_running = false;
+    state->restart_on_next = !state->stop && transaction->status == UHAL_STATUS_OK;
+    state->pending = false;
+    if (state->notify_done) {
+        state->notify_done = false;
+        notify_transaction_done(i2c_peripheral_num, (uhal_status_t) transaction->status);
+    }
+    return (uhal_status_t) transaction->status;
+}
+
+/**
+ * @brief Helper function which queues a transaction consisting of write bytes followed by read bytes (joined by a repeated start).
+ *        Transactions up to the FIFO depth are queued at once, longer transfers are moved by DMA.
+ *        Errors are picked up by finish_transaction.
+ */
+static void start_transaction(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                              const uint8_t *write_buff, const size_t write_size,
+                              uint8_t *read_buff, const size_t read_size, const bool stop) {
+    i2c_host_state_t *state = &i2c_host_states[i2c_peripheral_num];
+    volatile bustransaction_t *transaction = &i2c_host_transactions[i2c_peripheral_num];
+    i2c_hw_t *hw = get_i2c_hw(i2c_peripheral_num);
+    set_target_addr(i2c_peripheral_num, addr);
+    (void) hw->clr_stop_det;
+    (void) hw->clr_tx_abrt;
+    transaction->status = UHAL_STATUS_OK;
+    transaction->write_buffer = write_buff;
+    transaction->read_buffer = read_buff;
+    transaction->buf_size = read_size;
+    transaction->buf_cnt = 0;
+    state->write_buffer = write_buff;
+    state->write_size = write_size;
+    state->read_size = read_size;
+    state->restart_first = state->restart_on_next;
+    state->restart_on_next = false;
+    state->stop = stop;
+    state->cmds_issued = 0;
+    state->rx_dma_running = false;
+    state->deadline = get_deadline(i2c_peripheral_num, write_size + read_size);
+    state->pending = true;
+
+    bool queued;
+    if (write_size > I2C_HOST_FIFO_DEPTH && state->use_dma) {
+        queued = dma_write(i2c_peripheral_num, hw, state);
+        /* The read requests have to end up in the TX FIFO after the last write byte */
+        if (queued && read_size) {
+            queued = wait_for_dma_channel(hw, state, state->tx_dma_channel);
+        }
+    } else {
+        queued = feed_commands(hw, state, transaction, write_size);
+    }
+    if (!queued || !read_size) {
+        return;
+    }
+    if (read_size > I2C_HOST_FIFO_DEPTH && state->use_dma) {
+        dma_read(i2c_peripheral_num, hw, state, transaction);
+    } else {
+        feed_commands(hw, state, transaction, read_size);
+    }
+}
+
+/**
+ * @brief Helper function which runs a transaction to the end, retrying it according to the retry policy of the device.
+ *        The bus is owned by the calling task for the whole transaction, including the retries.
+ */
+static uhal_status_t run_blocking_transaction(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                              const uint8_t *write_buff, const size_t write_size,
+                                              uint8_t *read_buff, const size_t read_size, const bool stop) {
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_RP2040_I2C(i2c_peripheral_num));
+    finish_transaction(i2c_peripheral_num, true);
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        UHAL_OS_BUS_UNLOCK(UHAL_OS_BUS_RP2040_I2C(i2c_peripheral_num));
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    volatile bustransaction_t *transaction = &i2c_host_transactions[i2c_peripheral_num];
+    const i2c_host_retry_policy_t policy = get_retry_policy(i2c_peripheral_num, addr);
+    const uint32_t scl_period_us = 1000000 / i2c_host_baud_rate_freq[i2c_peripheral_num] + 1;
+    reset_transaction_info(transaction);
+    uint8_t retry_cnt = 0;
+    uhal_status_t status;
+    while (true) {
+        start_transaction(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size, stop);
+        status = finish_transaction(i2c_peripheral_num, true);
+        const uint8_t attempt_error = (status == UHAL_STATUS_I2C_NACK) ? (transaction->error_mask & (I2C_ERROR_FLAG_ADDR_NACK | I2C_ERROR_FLAG_DATA_NACK))
+                                                                       : (status == UHAL_STATUS_I2C_ARBSTATE_LOST) ? I2C_ERROR_FLAG_ARBLOST : 0;
+        if (status == UHAL_STATUS_OK || retry_cnt >= policy.max_retries || !(attempt_error & policy.retry_on)) {
+            break;
+        }
+        busy_wait_us((uint64_t) policy.backoff_scl_periods * scl_period_us << retry_cnt);
+        retry_cnt++;
+    }
+    transaction->retry_cnt = retry_cnt;
+    UHAL_OS_BUS_UNLOCK(UHAL_OS_BUS_RP2040_I2C(i2c_peripheral_num));
+    notify_transaction_done(i2c_peripheral_num, status);
+    return status;
+}
+
+uhal_status_t i2c_host_init(const i2c_periph_inst_t i2c_peripheral_num, const i2c_clock_sources_t clock_sources,
+                            const uint32_t periph_clk_freq, const uint32_t baud_rate_freq,
+                            const i2c_extra_opt_t extra_configuration_options) {
+    i2c_inst_t *i2c_inst = i2c_host_peripheral_mapping_table[i2c_peripheral_num];
+    i2c_host_state_t *state = &i2c_host_states[i2c_peripheral_num];
+    /* The pico-sdk calculates the SCL high/low counts and the SDA hold time from clk_sys */
+    i2c_host_baud_rate_freq[i2c_peripheral_num] = i2c_init(i2c_inst, baud_rate_freq);
+    i2c_hw_t *hw = i2c_get_hw(i2c_inst);
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    state->target_valid = false;
+    state->restart_on_next = false;
+    state->pending = false;
+    state->notify_done = false;
+    state->use_dma = !BITMASK_COMPARE(extra_configuration_options, I2C_EXTRA_OPT_NO_DMA);
+    if (state->use_dma && !state->dma_claimed) {
+        state->tx_dma_channel = dma_claim_unused_channel(true);
+        state->stop_dma_channel = dma_claim_unused_channel(true);
+        state->rx_dma_channel = dma_claim_unused_channel(true);
+        state->dma_claimed = true;
+    }
+    UHAL_OS_BUS_INIT(UHAL_OS_BUS_RP2040_I2C(i2c_peripheral_num));
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_deinit(const i2c_periph_inst_t i2c_peripheral_num) {
+    i2c_host_state_t *state = &i2c_host_states[i2c_peripheral_num];
+    finish_transaction(i2c_peripheral_num, true);
+    i2c_deinit(i2c_host_peripheral_mapping_table[i2c_peripheral_num]);
+    if (state->dma_claimed) {
+        dma_channel_unclaim(state->tx_dma_channel);
+        dma_channel_unclaim(state->stop_dma_channel);
+        dma_channel_unclaim(state->rx_dma_channel);
+        state->dma_claimed = false;
+    }
+    state->use_dma = false;
+    state->target_valid = false;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_write_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                          const uint16_t addr,
+                                          const uint8_t *write_buff,
+                                          const size_t size,
+                                          const i2c_stop_bit_t stop_bit) {
+    finish_transaction(i2c_peripheral_num, true);
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    if (size == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    reset_transaction_info(&i2c_host_transactions[i2c_peripheral_num]);
+    start_transaction(i2c_peripheral_num, addr, write_buff, size, NULL, 0, stop_bit == I2C_STOP_BIT);
+    i2c_host_states[i2c_peripheral_num].notify_done = true;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_write_blocking(const i2c_periph_inst_t i2c_peripheral_num, const uint16_t addr,
+                                      const uint8_t *write_buff, const size_t size,
+                                      const i2c_stop_bit_t stop_bit) {
+    if (size == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    return run_blocking_transaction(i2c_peripheral_num, addr, write_buff, size, NULL, 0, stop_bit == I2C_STOP_BIT);
+}
+
+uhal_status_t i2c_host_read_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                     const uint16_t addr, uint8_t *read_buff,
+                                     const size_t amount_of_bytes) {
+    if (amount_of_bytes == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    return run_blocking_transaction(i2c_peripheral_num, addr, NULL, 0, read_buff, amount_of_bytes, true);
+}
+
+uhal_status_t i2c_host_read_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                         const uint16_t addr, uint8_t *read_buff,
+                                         const size_t amount_of_bytes) {
+    finish_transaction(i2c_peripheral_num, true);
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    if (amount_of_bytes == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    reset_transaction_info(&i2c_host_transactions[i2c_peripheral_num]);
+    start_transaction(i2c_peripheral_num, addr, NULL, 0, read_buff, amount_of_bytes, true);
+    i2c_host_states[i2c_peripheral_num].notify_done = true;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_write_read_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                           const uint16_t addr,
+                                           const uint8_t *write_buff,
+                                           const size_t write_size,
+                                           uint8_t *read_buff,
+                                           const size_t read_size) {
+    if (write_size == 0 || read_size == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    return run_blocking_transaction(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size, true);
+}
+
+uhal_status_t i2c_host_write_read_non_blocking(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t *write_buff,
+                                               const size_t write_size,
+                                               uint8_t *read_buff,
+                                               const size_t read_size) {
+    finish_transaction(i2c_peripheral_num, true);
+    if (device_known_absent(i2c_peripheral_num, addr)) {
+        return UHAL_STATUS_I2C_DEVICE_NOT_PRESENT;
+    }
+    if (write_size == 0 || read_size == 0) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    reset_transaction_info(&i2c_host_transactions[i2c_peripheral_num]);
+    start_transaction(i2c_peripheral_num, addr, write_buff, write_size, read_buff, read_size, true);
+    i2c_host_states[i2c_peripheral_num].notify_done = true;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_set_transaction_done_callback(const i2c_periph_inst_t i2c_peripheral_num,
+                                                     const i2c_host_transaction_done_cb_t transaction_done_cb) {
+    i2c_host_transaction_done_callbacks[i2c_peripheral_num] = transaction_done_cb;
+    return UHAL_STATUS_OK;
+}
+
+i2c_transaction_info_t i2c_host_get_transaction_info(const i2c_periph_inst_t i2c_peripheral_num) {
+    /* A non-blocking transaction is finished here when it is done, which also copies the bytes of a FIFO read to the read buffer */
+    finish_transaction(i2c_peripheral_num, false);
+    const volatile bustransaction_t *transaction = &i2c_host_transactions[i2c_peripheral_num];
+    const i2c_transaction_info_t info = {
+            .status = (uhal_status_t) transaction->status,
+            .first_error = (uhal_status_t) transaction->first_error,
+            .last_error = (uhal_status_t) transaction->last_error,
+            .error_mask = transaction->error_mask,
+            .nack_offset = transaction->nack_offset,
+            .retry_cnt = transaction->retry_cnt
+    };
+    return info;
+}
+
+uhal_status_t i2c_host_set_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                        const uint8_t max_retries,
+                                        const uint16_t backoff_scl_periods,
+                                        const uint8_t retry_on) {
+    volatile i2c_host_retry_policy_t *policy = &i2c_host_retry_states[i2c_peripheral_num].default_policy;
+    policy->max_retries = max_retries;
+    policy->backoff_scl_periods = backoff_scl_periods;
+    policy->retry_on = retry_on;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_set_device_retry_policy(const i2c_periph_inst_t i2c_peripheral_num,
+                                               const uint16_t addr,
+                                               const uint8_t max_retries,
+                                               const uint16_t backoff_scl_periods,
+                                               const uint8_t retry_on) {
+    volatile i2c_host_retry_state_t *retry_state = &i2c_host_retry_states[i2c_peripheral_num];
+    volatile i2c_host_device_retry_policy_t *free_slot = NULL;
+    for (uint8_t slot = 0; slot < I2C_HOST_MAX_DEVICE_RETRY_POLICIES; slot++) {
+        volatile i2c_host_device_retry_policy_t *device_policy = &retry_state->device_policies[slot];
+        if (device_policy->in_use && device_policy->addr == addr) {
+            free_slot = device_policy;
+            break;
+        }
+        if (!device_policy->in_use && free_slot == NULL) {
+            free_slot = device_policy;
+        }
+    }
+    if (free_slot == NULL) {
+        return UHAL_STATUS_ERROR;
+    }
+    free_slot->addr = addr;
+    free_slot->policy.max_retries = max_retries;
+    free_slot->policy.backoff_scl_periods = backoff_scl_periods;
+    free_slot->policy.retry_on = retry_on;
+    free_slot->in_use = 1;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_scan(const i2c_periph_inst_t i2c_peripheral_num) {
+    finish_transaction(i2c_peripheral_num, true);
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t word = 0; word < 4; word++) {
+        presence->probed[word] = 0;
+        presence->present[word] = 0;
+    }
+    presence->scanning = 1;
+    /* The DW_apb_i2c can't send an address-only write, so every address is probed with a single byte read (never retried) */
+    uint8_t probe_byte;
+    uhal_status_t status = UHAL_STATUS_OK;
+    for (uint16_t addr = I2C_HOST_SCAN_FIRST_ADDR; addr <= I2C_HOST_SCAN_LAST_ADDR; addr++) {
+        reset_transaction_info(&i2c_host_transactions[i2c_peripheral_num]);
+        start_transaction(i2c_peripheral_num, addr, NULL, 0, &probe_byte, 1, true);
+        const uhal_status_t probe_status = finish_transaction(i2c_peripheral_num, true);
+        if (probe_status != UHAL_STATUS_OK && probe_status != UHAL_STATUS_I2C_NACK) {
+            status = probe_status;
+            break;
+        }
+        if (probe_status == UHAL_STATUS_OK) {
+            presence->present[addr / 32] |= 1ul << (addr % 32);
+        }
+        presence->probed[addr / 32] |= 1ul << (addr % 32);
+    }
+    presence->scanning = 0;
+    return status;
+}
+
+uhal_status_t i2c_host_get_scan_results(const i2c_periph_inst_t i2c_peripheral_num, uint8_t *presence_bitmap) {
+    const volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t byte = 0; byte < 16; byte++) {
+        presence_bitmap[byte] = (presence->present[byte / 4] >> ((byte % 4) * 8)) & 0xFF;
+    }
+    return presence->scanning ? UHAL_STATUS_PERIPHERAL_IN_USE_WARNING : UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_invalidate_presence_cache(const i2c_periph_inst_t i2c_peripheral_num) {
+    volatile i2c_host_presence_t *presence = &i2c_host_presence[i2c_peripheral_num];
+    for (uint8_t word = 0; word < 4; word++) {
+        presence->probed[word] = 0;
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t i2c_host_set_bus_recovery_pins(const i2c_periph_inst_t i2c_peripheral_num,
+                                             const gpio_pin_t scl_pin,
+                                             const gpio_pin_t sda_pin) {
+    i2c_bus_recovery_pins_t *recovery_pins = &i2c_host_recovery_pins[i2c_peripheral_num];
+    recovery_pins->scl_pin = scl_pin;
+    recovery_pins->sda_pin = sda_pin;
+    recovery_pins->configured = 1;
+    return UHAL_STATUS_OK;
+}
+
+/**
+ * @brief Helper functions which emulate an open-drain output using the GPIO direction.
+ */
+static inline void recovery_pull_line_low(const gpio_pin_t pin) {
+    gpio_set_pin_lvl(pin, GPIO_LOW);
+    gpio_set_pin_mode(pin, GPIO_MODE_OUTPUT);
+}
+
+static inline void recovery_release_line(const gpio_pin_t pin) {
+    gpio_set_pin_mode(pin, GPIO_MODE_INPUT);
+}
+
+static inline void recovery_half_period_delay(void) {
+    busy_wait_us_32(1000000 / (2 * I2C_RECOVERY_SCL_FREQ));
+}
+
+uhal_status_t i2c_host_recover_bus(const i2c_periph_inst_t i2c_peripheral_num) {
+    const i2c_bus_recovery_pins_t *recovery_pins = &i2c_host_recovery_pins[i2c_peripheral_num];
+    if (!recovery_pins->configured) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    i2c_hw_t *hw = get_i2c_hw(i2c_peripheral_num);
+    const gpio_pin_t scl_pin = recovery_pins->scl_pin;
+    const gpio_pin_t sda_pin = recovery_pins->sda_pin;
+    const gpio_mode_t scl_pin_mode = gpio_get_pin_mode(scl_pin);
+    const gpio_mode_t sda_pin_mode = gpio_get_pin_mode(sda_pin);
+
+    /* Take the pins from the I2C block and clock SCL until the stuck client releases SDA */
+    recovery_release_line(sda_pin);
+    recovery_release_line(scl_pin);
+    for (uint8_t pulse = 0; pulse < I2C_RECOVERY_CLOCK_PULSES && gpio_get_pin_lvl(sda_pin) == GPIO_LOW; pulse++) {
+        recovery_pull_line_low(scl_pin);
+        recovery_half_period_delay();
+        recovery_release_line(scl_pin);
+        recovery_half_period_delay();
+    }
+
+    /* Generate a STOP condition: SDA goes high while SCL is high */
+    recovery_pull_line_low(scl_pin);
+    recovery_half_period_delay();
+    recovery_pull_line_low(sda_pin);
+    recovery_half_period_delay();
+    recovery_release_line(scl_pin);
+    recovery_half_period_delay();
+    recovery_release_line(sda_pin);
+    recovery_half_period_delay();
+    const bool bus_released = (gpio_get_pin_lvl(sda_pin) == GPIO_HIGH && gpio_get_pin_lvl(scl_pin) == GPIO_HIGH);
+
+    /* Give the pins back to the I2C block and reset its state machine by disabling it */
+    gpio_set_pin_mode(scl_pin, scl_pin_mode);
+    gpio_set_pin_mode(sda_pin, sda_pin_mode);
+    hw->enable = 0;
+    (void) hw->clr_tx_abrt;
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    i2c_host_states[i2c_peripheral_num].restart_on_next = false;
+    return bus_released ? UHAL_STATUS_OK : UHAL_STATUS_I2C_TIMEOUT;
+}
+
+#endif /* DISABLE_I2C_HOST_MODULE */
@@ -1,6 +1,6 @@
 /**
-* \file            spi_platform_specific.h
-* \brief           Include file with platform specific options for the SPI module
+* \file            bustransaction.h
+* \brief           Include file with the transaction info shared by the bus drivers
 */
 /*
 *  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
@@ -22,37 +22,31 @@
 * Author:          Victor Hogeweij <hogeweyv@gmail.com>
 */
 
-#ifndef HAL_SPI_PLATFORM_SPECIFIC
-#define HAL_SPI_PLATFORM_SPECIFIC
-/* Extern c for compiling with c++*/
-#ifdef __cplusplus
-extern "C" {
-#endif /* __cplusplus */
 
-#include <stddef.h>
-#include <gpio_platform_specific.h>
-
-typedef enum { SPI_OPERATING_MODE_MASTER, SPI_OPERATING_MODE_SLAVE } spi_operating_mode_t;
-
-typedef struct {
-    spi_operating_mode_t operating_mode;
-} spi_periph_inst_t;
+#ifndef RP2040_BUSTRANSACTION_H
+#define RP2040_BUSTRANSACTION_H
 
-typedef struct {
-    spi_periph_inst_t* spi_peripheral;
-    gpio_pin_t cs_pin;
-} spi_dev_t;
+#include <stddef.h>
+#include <stdint.h>
 
+/**
+ * @brief Information about the transaction currently running on a bus peripheral.
+ *        status holds an uhal_status_t value. When an error occurs it holds the first error of the transaction,
+ *        the I2C host driver additionally collects every error seen during the transaction in error_mask.
+ */
 typedef struct {
     uint8_t transaction_type;
     uint8_t instance_num;
-    const uint8_t* write_buffer;
-    uint8_t* read_buffer;
-    uint8_t buf_size;
-    uint8_t buf_cnt;
+    const uint8_t *write_buffer;
+    uint8_t *read_buffer;
+    size_t buf_size;
+    size_t buf_cnt;
+    int8_t status;
+    uint8_t error_mask;
+    int8_t first_error;
+    int8_t last_error;
+    size_t nack_offset;
+    uint8_t retry_cnt;
 } bustransaction_t;
 
-#ifdef __cplusplus
-}
-#endif /* __cplusplus */
-#endif
+#endif /* RP2040_BUSTRANSACTION_H */
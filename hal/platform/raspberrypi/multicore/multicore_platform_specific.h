@@ -0,0 +1,62 @@
+/**
+* \file            multicore_platform_specific.h
+* \brief           Include file with platform specific options for the multicore service module
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_MULTICORE_PLATFORM_SPECIFIC
+#define HAL_MULTICORE_PLATFORM_SPECIFIC
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+/**
+ * @brief Work executed by the service core (core 1) and the done function called afterwards on core 0.
+ */
+typedef void (*multicore_work_func_t)(void *arg);
+typedef void (*multicore_done_func_t)(void *arg);
+
+/**
+ * @brief The amount of entries of the work ring (core 0 to core 1) and the completion ring (core 1 to core 0),
+ *        has to be a power of two.
+ */
+#ifndef MULTICORE_RING_SIZE
+#define MULTICORE_RING_SIZE 16
+#endif
+
+static_assert((MULTICORE_RING_SIZE & (MULTICORE_RING_SIZE - 1)) == 0 && MULTICORE_RING_SIZE >= 2,
+              "MULTICORE_RING_SIZE has to be a power of two!");
+
+#define MULTICORE_POST_WORK_PARAMETER_CHECK(work, arg, done)                                                                                         \
+    do {                                                                                                                                             \
+        static_assert(work != NULL, "MULTICORE_POST_WORK: No work function given!");                                                                 \
+    } while (0);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,207 @@
+/**
+* \file            multicore_service.c
+* \brief           Source file which implements the multicore service on the RP2040
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef DISABLE_MULTICORE_MODULE
+
+#include <stdbool.h>
+#include "hal_multicore.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/platform.h"
+
+/**
+ * @brief The core which runs the service loop.
+ */
+#define MULTICORE_SERVICE_CORE 1
+
+/**
+ * @brief The word pushed into the inter-core FIFO to wake up the service core. The work itself is passed through the ring,
+ *        so the FIFO only needs to hold one doorbell: when it is full the service core is already going to wake up.
+ */
+#define MULTICORE_DOORBELL     0x55484C00ul
+
+/**
+ * @brief An entry of the work and completion rings, finished is set by the service core for multicore_run_blocking.
+ */
+typedef struct {
+    multicore_work_func_t work;
+    multicore_done_func_t done;
+    void *arg;
+    volatile bool *finished;
+} multicore_item_t;
+
+/**
+ * @brief A single-producer single-consumer ring in (shared) main SRAM. The producer only writes head and the consumer only writes tail,
+ *        an entry is written before head is advanced (with a memory barrier in between) so no lock is needed between the cores.
+ *        head and tail run freely, the entry index is the counter modulo MULTICORE_RING_SIZE.
+ */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    multicore_item_t items[MULTICORE_RING_SIZE];
+} multicore_ring_t;
+
+static multicore_ring_t multicore_work_ring;
+static multicore_ring_t multicore_done_ring;
+static volatile bool multicore_service_running;
+
+static bool ring_push(multicore_ring_t *ring, const multicore_item_t *item) {
+    const uint32_t head = ring->head;
+    if (head - ring->tail >= MULTICORE_RING_SIZE) {
+        return false;
+    }
+    ring->items[head % MULTICORE_RING_SIZE] = *item;
+    __dmb();
+    ring->head = head + 1;
+    return true;
+}
+
+static bool ring_pop(multicore_ring_t *ring, multicore_item_t *item) {
+    const uint32_t tail = ring->tail;
+    if (ring->head == tail) {
+        return false;
+    }
+    __dmb();
+    *item = ring->items[tail % MULTICORE_RING_SIZE];
+    __dmb();
+    ring->tail = tail + 1;
+    return true;
+}
+
+/**
+ * @brief Helper function which pushes an item on a ring. Interrupts on the pushing core are masked during the push,
+ *        so an ISR and the thread of the same core can both post without breaking the single-producer rule.
+ */
+static bool ring_push_from_any_context(multicore_ring_t *ring, const multicore_item_t *item) {
+    const uint32_t irq_state = save_and_disable_interrupts();
+    const bool pushed = ring_push(ring, item);
+    restore_interrupts(irq_state);
+    return pushed;
+}
+
+/**
+ * @brief Helper function which executes an item on the service core and hands its completion back.
+ *        When the completion ring is full the service core waits until core 0 processes the completions.
+ */
+static void run_item(const multicore_item_t *item) {
+    item->work(item->arg);
+    if (item->finished != NULL) {
+        *item->finished = true;
+        __sev();
+    }
+    if (item->done != NULL) {
+        while (!ring_push_from_any_context(&multicore_done_ring, item)) {};
+    }
+}
+
+/**
+ * @brief The service loop of core 1, it sleeps in the FIFO pop (WFE) until core 0 rings the doorbell.
+ *        Interrupts enabled by work on this core are serviced while it sleeps.
+ */
+static void multicore_service_loop(void) {
+    while (true) {
+        multicore_item_t item;
+        while (ring_pop(&multicore_work_ring, &item)) {
+            run_item(&item);
+        }
+        (void) multicore_fifo_pop_blocking();
+    }
+}
+
+static uhal_status_t post_item(const multicore_item_t *item) {
+    if (!multicore_service_running) {
+        return UHAL_STATUS_ERROR;
+    }
+    if (get_core_num() == MULTICORE_SERVICE_CORE) {
+        run_item(item);
+        return UHAL_STATUS_OK;
+    }
+    if (!ring_push_from_any_context(&multicore_work_ring, item)) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(MULTICORE_DOORBELL);
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t multicore_service_init(void) {
+    if (multicore_service_running) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+    multicore_work_ring.head = multicore_work_ring.tail = 0;
+    multicore_done_ring.head = multicore_done_ring.tail = 0;
+    multicore_launch_core1(multicore_service_loop);
+    multicore_service_running = true;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t multicore_service_deinit(void) {
+    if (!multicore_service_running) {
+        return UHAL_STATUS_OK;
+    }
+    multicore_service_running = false;
+    multicore_reset_core1();
+    multicore_fifo_drain();
+    multicore_work_ring.head = multicore_work_ring.tail = 0;
+    multicore_done_ring.head = multicore_done_ring.tail = 0;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t multicore_post_work(const multicore_work_func_t work, void *arg, const multicore_done_func_t done) {
+    if (work == NULL) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const multicore_item_t item = {.work = work, .done = done, .arg = arg, .finished = NULL};
+    return post_item(&item);
+}
+
+uhal_status_t multicore_run_blocking(const multicore_work_func_t work, void *arg) {
+    if (work == NULL) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    volatile bool finished = false;
+    const multicore_item_t item = {.work = work, .done = NULL, .arg = arg, .finished = &finished};
+    const uhal_status_t status = post_item(&item);
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+    while (!finished) {
+        __wfe();
+    }
+    return UHAL_STATUS_OK;
+}
+
+size_t multicore_process_completions(void) {
+    size_t amount_of_completions = 0;
+    multicore_item_t item;
+    while (ring_pop(&multicore_done_ring, &item)) {
+        item.done(item.arg);
+        amount_of_completions++;
+    }
+    return amount_of_completions;
+}
+
+#endif /* DISABLE_MULTICORE_MODULE */
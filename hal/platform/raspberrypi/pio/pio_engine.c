@@ -0,0 +1,386 @@
+/**
+* \file            pio_engine.c
+* \brief           Source file which implements the PIO engine API functions
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef DISABLE_PIO_MODULE
+
+#include <stdbool.h>
+#include "hal_gpio.h"
+#include "hal_pio.h"
+#include "pio/pio_platform_specific.h"
+#include "pio/pio_programs.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+
+#define PIO_ENGINE_NO_DMA_CHANNEL (-1)
+#define PIO_ENGINE_NO_PROGRAM     (-1)
+#define PIO_ENGINE_MAX_CLKDIV     65536.0f
+
+/**
+ * @brief Everything needed to load and configure a program, cycles_per_unit is the amount of state machine cycles
+ *        per bit, byte or sample (the unit of the frequency given to pio_engine_init).
+ */
+typedef struct {
+    pio_program_t program;
+    uint8_t wrap_target;
+    uint8_t wrap;
+    uint8_t sideset_bits;
+    uint8_t cycles_per_unit;
+} pio_engine_program_desc_t;
+
+static const pio_engine_program_desc_t pio_engine_programs[PIO_ENGINE_PROGRAM_NUM] = {
+    [PIO_ENGINE_PROGRAM_WS2812] = {
+        .program = {.instructions = pio_engine_ws2812_program, .length = count_of(pio_engine_ws2812_program), .origin = -1},
+        .wrap_target = PIO_ENGINE_WS2812_WRAP_TARGET, .wrap = PIO_ENGINE_WS2812_WRAP,
+        .sideset_bits = 1, .cycles_per_unit = PIO_ENGINE_WS2812_CYCLES_PER_BIT
+    },
+    [PIO_ENGINE_PROGRAM_SPI] = {
+        .program = {.instructions = pio_engine_spi_program, .length = count_of(pio_engine_spi_program), .origin = -1},
+        .wrap_target = PIO_ENGINE_SPI_WRAP_TARGET, .wrap = PIO_ENGINE_SPI_WRAP,
+        .sideset_bits = 1, .cycles_per_unit = PIO_ENGINE_SPI_CYCLES_PER_BIT
+    },
+    [PIO_ENGINE_PROGRAM_PARALLEL_8BIT] = {
+        .program = {.instructions = pio_engine_parallel_8bit_program, .length = count_of(pio_engine_parallel_8bit_program), .origin = -1},
+        .wrap_target = PIO_ENGINE_PARALLEL_8BIT_WRAP_TARGET, .wrap = PIO_ENGINE_PARALLEL_8BIT_WRAP,
+        .sideset_bits = 1, .cycles_per_unit = PIO_ENGINE_PARALLEL_8BIT_CYCLES_PER_BYTE
+    },
+    [PIO_ENGINE_PROGRAM_QUADRATURE] = {
+        .program = {.instructions = pio_engine_quadrature_program, .length = count_of(pio_engine_quadrature_program), .origin = 0},
+        .wrap_target = PIO_ENGINE_QUADRATURE_WRAP_TARGET, .wrap = PIO_ENGINE_QUADRATURE_WRAP,
+        .sideset_bits = 0, .cycles_per_unit = PIO_ENGINE_QUADRATURE_CYCLES_PER_SAMPLE
+    },
+};
+
+/**
+ * @brief The load offset of every program in PIO0 and PIO1 and the amount of state machines running it.
+ *        A program is removed from the instruction memory when its last state machine is stopped.
+ */
+static int8_t pio_engine_program_offset[2][PIO_ENGINE_PROGRAM_NUM] = {
+    {PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM},
+    {PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM}
+};
+static uint8_t pio_engine_program_users[2][PIO_ENGINE_PROGRAM_NUM];
+
+static int8_t pio_engine_running_program[PIO_ENGINE_INST_NUM] = {
+    PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM,
+    PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM, PIO_ENGINE_NO_PROGRAM
+};
+
+/**
+ * @brief The DMA channels claimed by pio_engine_init, the RX channel is only claimed for the SPI program.
+ */
+static int pio_engine_dma_tx_channel[PIO_ENGINE_INST_NUM] = {
+    PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL,
+    PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL
+};
+static int pio_engine_dma_rx_channel[PIO_ENGINE_INST_NUM] = {
+    PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL,
+    PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL, PIO_ENGINE_NO_DMA_CHANNEL
+};
+
+static const uint8_t pio_engine_dummy_tx = 0x00;
+static uint8_t pio_engine_dummy_rx;
+
+static inline PIO get_pio_inst(const pio_engine_inst_t pio_engine_num) {
+    return (pio_engine_num < PIO_ENGINE_SM_PER_BLOCK) ? pio0 : pio1;
+}
+
+static inline uint8_t get_pio_block_num(const pio_engine_inst_t pio_engine_num) {
+    return pio_engine_num / PIO_ENGINE_SM_PER_BLOCK;
+}
+
+static inline uint get_sm_num(const pio_engine_inst_t pio_engine_num) {
+    return pio_engine_num % PIO_ENGINE_SM_PER_BLOCK;
+}
+
+/**
+ * @brief Helper function which waits till a DMA transfer started by pio_engine_write_non_blocking is finished.
+ */
+static inline void pio_engine_wait_for_dma(const pio_engine_inst_t pio_engine_num) {
+    if (pio_engine_dma_rx_channel[pio_engine_num] != PIO_ENGINE_NO_DMA_CHANNEL) {
+        dma_channel_wait_for_finish_blocking(pio_engine_dma_rx_channel[pio_engine_num]);
+    }
+    if (pio_engine_dma_tx_channel[pio_engine_num] != PIO_ENGINE_NO_DMA_CHANNEL) {
+        dma_channel_wait_for_finish_blocking(pio_engine_dma_tx_channel[pio_engine_num]);
+    }
+}
+
+/**
+ * @brief Helper function which configures a DMA channel paced by the TX or RX DREQ of the state machine.
+ *        When no buffer is given to a transfer the channel reads the dummy byte or writes into the dummy sink without incrementing.
+ */
+static void pio_engine_configure_dma(const uint channel, const PIO pio, const uint sm, const bool is_tx, const void *buff,
+                                     const size_t size) {
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_dreq(&config, pio_get_dreq(pio, sm, is_tx));
+    if (is_tx) {
+        /* An 8-bit write is replicated over the 32-bit FIFO, so the byte ends up in the bits shifted out first */
+        channel_config_set_read_increment(&config, buff != NULL);
+        channel_config_set_write_increment(&config, false);
+        dma_channel_configure(channel, &config, &pio->txf[sm], (buff != NULL) ? buff : &pio_engine_dummy_tx, size, false);
+    } else {
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, buff != NULL);
+        dma_channel_configure(channel, &config, (buff != NULL) ? (void *) buff : &pio_engine_dummy_rx, &pio->rxf[sm], size, false);
+    }
+}
+
+/**
+ * @brief Helper function which streams a buffer through the state machine, for the SPI program the received bytes are taken as well.
+ * @param write_buff The bytes to write, NULL to write zeros
+ * @param read_buff The buffer for the received bytes, NULL to discard them (only used by the SPI program)
+ * @return true when the transfer is still running on the DMA channels
+ */
+static bool pio_engine_transfer(const pio_engine_inst_t pio_engine_num, const unsigned char *write_buff, unsigned char *read_buff,
+                                const size_t size) {
+    const PIO pio = get_pio_inst(pio_engine_num);
+    const uint sm = get_sm_num(pio_engine_num);
+    const bool has_rx = pio_engine_running_program[pio_engine_num] == PIO_ENGINE_PROGRAM_SPI;
+    pio_engine_wait_for_dma(pio_engine_num);
+
+    if (pio_engine_dma_tx_channel[pio_engine_num] != PIO_ENGINE_NO_DMA_CHANNEL) {
+        uint32_t channel_mask = 1u << pio_engine_dma_tx_channel[pio_engine_num];
+        pio_engine_configure_dma(pio_engine_dma_tx_channel[pio_engine_num], pio, sm, true, write_buff, size);
+        if (has_rx) {
+            pio_engine_configure_dma(pio_engine_dma_rx_channel[pio_engine_num], pio, sm, false, read_buff, size);
+            channel_mask |= 1u << pio_engine_dma_rx_channel[pio_engine_num];
+        }
+        dma_start_channel_mask(channel_mask);
+        return true;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        pio_sm_put_blocking(pio, sm, (uint32_t) ((write_buff != NULL) ? write_buff[i] : 0x00) << 24);
+        if (has_rx) {
+            const uint8_t data = (uint8_t) pio_sm_get_blocking(pio, sm);
+            if (read_buff != NULL) {
+                read_buff[i] = data;
+            }
+        }
+    }
+    return false;
+}
+
+uhal_status_t pio_engine_init(const pio_engine_inst_t pio_engine_num, const pio_engine_program_t program, const pio_engine_pins_t pins,
+                              const uint32_t frequency, const pio_engine_opt_t pio_engine_opt) {
+    if (pio_engine_num >= PIO_ENGINE_INST_NUM || program >= PIO_ENGINE_PROGRAM_NUM
+        || (program == PIO_ENGINE_PROGRAM_SPI && (pio_engine_opt & PIO_ENGINE_OPT_JOIN_FIFO))) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const pio_engine_program_desc_t *desc = &pio_engine_programs[program];
+    float clkdiv = 1.0f;
+    if (frequency != 0) {
+        clkdiv = (float) clock_get_hz(clk_sys) / ((float) frequency * desc->cycles_per_unit);
+        if (clkdiv < 1.0f || clkdiv > PIO_ENGINE_MAX_CLKDIV) {
+            return UHAL_STATUS_INVALID_PARAMETERS;
+        }
+    }
+
+    pio_engine_deinit(pio_engine_num);
+    const PIO pio = get_pio_inst(pio_engine_num);
+    const uint8_t block_num = get_pio_block_num(pio_engine_num);
+    const uint sm = get_sm_num(pio_engine_num);
+    if (pio_sm_is_claimed(pio, sm)) {
+        return UHAL_STATUS_PERIPHERAL_IN_USE_WARNING;
+    }
+
+    /*
+     * Load the program when no other state machine of the PIO block is running it yet.
+     */
+    if (pio_engine_program_offset[block_num][program] == PIO_ENGINE_NO_PROGRAM) {
+        if (!pio_can_add_program(pio, &desc->program)) {
+            return UHAL_STATUS_ERROR;
+        }
+        pio_engine_program_offset[block_num][program] = (int8_t) pio_add_program(pio, &desc->program);
+    }
+    pio_engine_program_users[block_num][program]++;
+    pio_sm_claim(pio, sm);
+    const uint offset = pio_engine_program_offset[block_num][program];
+
+    pio_sm_config config = pio_get_default_sm_config();
+    sm_config_set_wrap(&config, offset + desc->wrap_target, offset + desc->wrap);
+    sm_config_set_clkdiv(&config, clkdiv);
+    if (desc->sideset_bits) {
+        sm_config_set_sideset(&config, desc->sideset_bits, false, false);
+        sm_config_set_sideset_pins(&config, pins.sideset_pin.pin_num);
+        pio_gpio_init(pio, pins.sideset_pin.pin_num);
+        pio_sm_set_consecutive_pindirs(pio, sm, pins.sideset_pin.pin_num, desc->sideset_bits, true);
+    }
+
+    switch (program) {
+        case PIO_ENGINE_PROGRAM_SPI: {
+            sm_config_set_out_pins(&config, pins.out_pin.pin_num, 1);
+            sm_config_set_in_pins(&config, pins.in_pin.pin_num);
+            sm_config_set_out_shift(&config, false, true, 8);
+            sm_config_set_in_shift(&config, false, true, 8);
+            pio_gpio_init(pio, pins.out_pin.pin_num);
+            pio_gpio_init(pio, pins.in_pin.pin_num);
+            pio_sm_set_consecutive_pindirs(pio, sm, pins.out_pin.pin_num, 1, true);
+            pio_sm_set_consecutive_pindirs(pio, sm, pins.in_pin.pin_num, 1, false);
+            break;
+        }
+        case PIO_ENGINE_PROGRAM_PARALLEL_8BIT: {
+            sm_config_set_out_pins(&config, pins.out_pin.pin_num, 8);
+            sm_config_set_out_shift(&config, false, true, 8);
+            for (uint8_t i = 0; i < 8; i++) {
+                pio_gpio_init(pio, pins.out_pin.pin_num + i);
+            }
+            pio_sm_set_consecutive_pindirs(pio, sm, pins.out_pin.pin_num, 8, true);
+            break;
+        }
+        case PIO_ENGINE_PROGRAM_QUADRATURE: {
+            sm_config_set_in_pins(&config, pins.in_pin.pin_num);
+            sm_config_set_in_shift(&config, false, false, 32);
+            pio_sm_set_consecutive_pindirs(pio, sm, pins.in_pin.pin_num, 2, false);
+            break;
+        }
+        default: {
+            /* WS2812: the data bits are shifted out MSB first from the byte in the top of the OSR */
+            sm_config_set_out_shift(&config, false, true, 8);
+            break;
+        }
+    }
+
+    if (pio_engine_opt & PIO_ENGINE_OPT_JOIN_FIFO) {
+        sm_config_set_fifo_join(&config, (program == PIO_ENGINE_PROGRAM_QUADRATURE) ? PIO_FIFO_JOIN_RX : PIO_FIFO_JOIN_TX);
+    }
+
+    /*
+     * The quadrature program is read by the CPU, the other programs are fed through DMA when channels are free.
+     */
+    if (!(pio_engine_opt & PIO_ENGINE_OPT_NO_DMA) && program != PIO_ENGINE_PROGRAM_QUADRATURE) {
+        const int tx_channel = dma_claim_unused_channel(false);
+        const int rx_channel = (program == PIO_ENGINE_PROGRAM_SPI) ? dma_claim_unused_channel(false) : PIO_ENGINE_NO_DMA_CHANNEL;
+        if (tx_channel >= 0 && (program != PIO_ENGINE_PROGRAM_SPI || rx_channel >= 0)) {
+            pio_engine_dma_tx_channel[pio_engine_num] = tx_channel;
+            pio_engine_dma_rx_channel[pio_engine_num] = rx_channel;
+        } else {
+            /* Not enough free channels, the CPU feeds the FIFOs */
+            if (tx_channel >= 0) {
+                dma_channel_unclaim(tx_channel);
+            }
+            if (rx_channel >= 0) {
+                dma_channel_unclaim(rx_channel);
+            }
+        }
+    }
+
+    pio_engine_running_program[pio_engine_num] = program;
+    pio_sm_init(pio, sm, offset, &config);
+    if (program == PIO_ENGINE_PROGRAM_QUADRATURE) {
+        /* y and the OSR keep their value from the previous program, so start at 0 from the current A/B state */
+        pio_sm_exec(pio, sm, pio_encode_set(pio_y, 0));
+        pio_sm_exec(pio, sm, pio_encode_mov(pio_isr, pio_null));
+        pio_sm_exec(pio, sm, pio_encode_in(pio_pins, 2));
+        pio_sm_exec(pio, sm, pio_encode_mov(pio_osr, pio_isr));
+    }
+    pio_sm_set_enabled(pio, sm, true);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t pio_engine_deinit(const pio_engine_inst_t pio_engine_num) {
+    if (pio_engine_num >= PIO_ENGINE_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const int8_t program = pio_engine_running_program[pio_engine_num];
+    if (program == PIO_ENGINE_NO_PROGRAM) {
+        return UHAL_STATUS_OK;
+    }
+    const PIO pio = get_pio_inst(pio_engine_num);
+    const uint8_t block_num = get_pio_block_num(pio_engine_num);
+    const uint sm = get_sm_num(pio_engine_num);
+
+    pio_engine_wait_for_dma(pio_engine_num);
+    if (pio_engine_dma_tx_channel[pio_engine_num] != PIO_ENGINE_NO_DMA_CHANNEL) {
+        dma_channel_unclaim(pio_engine_dma_tx_channel[pio_engine_num]);
+        pio_engine_dma_tx_channel[pio_engine_num] = PIO_ENGINE_NO_DMA_CHANNEL;
+    }
+    if (pio_engine_dma_rx_channel[pio_engine_num] != PIO_ENGINE_NO_DMA_CHANNEL) {
+        dma_channel_unclaim(pio_engine_dma_rx_channel[pio_engine_num]);
+        pio_engine_dma_rx_channel[pio_engine_num] = PIO_ENGINE_NO_DMA_CHANNEL;
+    }
+
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_unclaim(pio, sm);
+    if (--pio_engine_program_users[block_num][program] == 0) {
+        pio_remove_program(pio, &pio_engine_programs[program].program, pio_engine_program_offset[block_num][program]);
+        pio_engine_program_offset[block_num][program] = PIO_ENGINE_NO_PROGRAM;
+    }
+    pio_engine_running_program[pio_engine_num] = PIO_ENGINE_NO_PROGRAM;
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t pio_engine_write_blocking(const pio_engine_inst_t pio_engine_num, const unsigned char *write_buff, const size_t size) {
+    const uhal_status_t status = pio_engine_write_non_blocking(pio_engine_num, write_buff, size);
+    if (status != UHAL_STATUS_OK) {
+        return status;
+    }
+    pio_engine_wait_for_dma(pio_engine_num);
+    const PIO pio = get_pio_inst(pio_engine_num);
+    while (!pio_sm_is_tx_fifo_empty(pio, get_sm_num(pio_engine_num))) { ;
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t pio_engine_write_non_blocking(const pio_engine_inst_t pio_engine_num, const unsigned char *write_buff, const size_t size) {
+    if (pio_engine_num >= PIO_ENGINE_INST_NUM || pio_engine_running_program[pio_engine_num] == PIO_ENGINE_NO_PROGRAM
+        || pio_engine_running_program[pio_engine_num] == PIO_ENGINE_PROGRAM_QUADRATURE) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    pio_engine_transfer(pio_engine_num, write_buff, NULL, size);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t pio_engine_read_blocking(const pio_engine_inst_t pio_engine_num, unsigned char *read_buff, const size_t amount_of_bytes) {
+    if (pio_engine_num >= PIO_ENGINE_INST_NUM || pio_engine_running_program[pio_engine_num] != PIO_ENGINE_PROGRAM_SPI) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (pio_engine_transfer(pio_engine_num, NULL, read_buff, amount_of_bytes)) {
+        pio_engine_wait_for_dma(pio_engine_num);
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t pio_engine_quadrature_get_position(const pio_engine_inst_t pio_engine_num, int32_t *position) {
+    if (pio_engine_num >= PIO_ENGINE_INST_NUM || pio_engine_running_program[pio_engine_num] != PIO_ENGINE_PROGRAM_QUADRATURE) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    const PIO pio = get_pio_inst(pio_engine_num);
+    const uint sm = get_sm_num(pio_engine_num);
+    /*
+     * A full FIFO drops the newest counts, so the queued ones are stale. Drain them and wait for the next sample,
+     * which takes at most 10 state machine cycles.
+     */
+    uint32_t count = 0;
+    for (uint level = pio_sm_get_rx_fifo_level(pio, sm) + 1; level > 0; level--) {
+        count = pio_sm_get_blocking(pio, sm);
+    }
+    /* y counts down when A leads B */
+    *position = (int32_t) (0u - count);
+    return UHAL_STATUS_OK;
+}
+
+#endif /* DISABLE_PIO_MODULE */
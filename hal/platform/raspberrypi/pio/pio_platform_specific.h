@@ -0,0 +1,115 @@
+/**
+* \file            pio_platform_specific.h
+* \brief           Include file with platform specific options for the PIO engine module
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_PIO_PLATFORM_SPECIFIC
+#define HAL_PIO_PLATFORM_SPECIFIC
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "gpio/gpio_platform_specific.h"
+
+/**
+ * @brief Every PIO engine instance is one state machine, PIO_ENGINE_0...3 are on PIO0 and PIO_ENGINE_4...7 on PIO1.
+ */
+typedef enum {
+    PIO_ENGINE_0,
+    PIO_ENGINE_1,
+    PIO_ENGINE_2,
+    PIO_ENGINE_3,
+    PIO_ENGINE_4,
+    PIO_ENGINE_5,
+    PIO_ENGINE_6,
+    PIO_ENGINE_7
+} pio_engine_inst_t;
+
+#define PIO_ENGINE_INST_NUM     8
+#define PIO_ENGINE_SM_PER_BLOCK 4
+
+/**
+ * @brief The programs which can be loaded on a state machine:
+ *        PIO_ENGINE_PROGRAM_WS2812: WS2812 LED data on sideset_pin, frequency is the bit rate (800 KHz), bytes are sent in GRB order
+ *        PIO_ENGINE_PROGRAM_SPI: SPI host mode 0 with SCK on sideset_pin, MOSI on out_pin and MISO on in_pin, frequency is the bus frequency
+ *        PIO_ENGINE_PROGRAM_PARALLEL_8BIT: 8-bit bus on out_pin...out_pin + 7 with a write strobe on sideset_pin, the bus latches on the rising edge
+ *        PIO_ENGINE_PROGRAM_QUADRATURE: Quadrature encoder with A on in_pin and B on in_pin + 1, frequency is the sample rate
+ */
+typedef enum {
+    PIO_ENGINE_PROGRAM_WS2812,
+    PIO_ENGINE_PROGRAM_SPI,
+    PIO_ENGINE_PROGRAM_PARALLEL_8BIT,
+    PIO_ENGINE_PROGRAM_QUADRATURE,
+    PIO_ENGINE_PROGRAM_NUM
+} pio_engine_program_t;
+
+/**
+ * @brief The pins used by a program, pins which aren't used by the selected program are ignored.
+ */
+typedef struct {
+    gpio_pin_t out_pin;
+    gpio_pin_t in_pin;
+    gpio_pin_t sideset_pin;
+} pio_engine_pins_t;
+
+/**
+ * @brief Extra options of the PIO engine:
+ *        PIO_ENGINE_OPT_JOIN_FIFO: Joins the TX and RX FIFO into one 8-entry FIFO in the direction the program uses (not for the SPI program)
+ *        PIO_ENGINE_OPT_NO_DMA: Don't claim a DMA channel, the CPU writes and reads the FIFOs
+ */
+typedef enum {
+    PIO_ENGINE_OPT_USE_DEFAULT = 0,
+    PIO_ENGINE_OPT_JOIN_FIFO = 0x01,
+    PIO_ENGINE_OPT_NO_DMA = 0x02
+} pio_engine_opt_t;
+
+#define PIO_ENGINE_INIT_PARAMETER_CHECK(pio_engine_num, program, frequency, pio_engine_opt)                                                         \
+    do {                                                                                                                                             \
+        static_assert(pio_engine_num <= PIO_ENGINE_7 && pio_engine_num >= PIO_ENGINE_0, "PIO_ENGINE_INIT: Invalid state machine!");                  \
+        static_assert(program < PIO_ENGINE_PROGRAM_NUM && program >= PIO_ENGINE_PROGRAM_WS2812, "PIO_ENGINE_INIT: Invalid program!");                \
+        static_assert(pio_engine_opt <= (PIO_ENGINE_OPT_JOIN_FIFO | PIO_ENGINE_OPT_NO_DMA), "PIO_ENGINE_INIT: Unsupported options set!");            \
+        static_assert(!(program == PIO_ENGINE_PROGRAM_SPI && (pio_engine_opt & PIO_ENGINE_OPT_JOIN_FIFO)),                                           \
+                      "PIO_ENGINE_INIT: The SPI program uses both FIFOs, they can't be joined!");                                                    \
+    } while (0);
+
+#define PIO_ENGINE_DEINIT_PARAMETER_CHECK(pio_engine_num)                                                                                            \
+    do {                                                                                                                                             \
+        static_assert(pio_engine_num <= PIO_ENGINE_7 && pio_engine_num >= PIO_ENGINE_0, "PIO_ENGINE_DEINIT: Invalid state machine!");                \
+    } while (0);
+
+#define PIO_ENGINE_WRITE_PARAMETER_CHECK(pio_engine_num, write_buffer, buffer_size)                                                                  \
+    do {                                                                                                                                             \
+    } while (0);
+
+#define PIO_ENGINE_READ_PARAMETER_CHECK(pio_engine_num, read_buffer, size)                                                                           \
+    do {                                                                                                                                             \
+    } while (0);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,120 @@
+/**
+* \file            pio_programs.h
+* \brief           Hand-assembled PIO programs of the PIO engine module
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+
+#ifndef HAL_PIO_PROGRAMS_H
+#define HAL_PIO_PROGRAMS_H
+
+#include <stdint.h>
+
+/**
+ * @brief The programs are assembled by hand so the HAL doesn't depend on pioasm, the source is listed above each program.
+ *        JMP targets are relative to the start of the program, pio_add_program relocates them to the load offset.
+ */
+
+/*
+ * .side_set 1
+ * .wrap_target
+ * bitloop:
+ *     out x, 1        side 0 [2]
+ *     jmp !x do_zero  side 1 [1]
+ * do_one:
+ *     jmp bitloop     side 1 [4]
+ * do_zero:
+ *     nop             side 0 [4]
+ * .wrap
+ */
+static const uint16_t pio_engine_ws2812_program[] = {0x6221, 0x1123, 0x1400, 0xa442};
+#define PIO_ENGINE_WS2812_WRAP_TARGET     0
+#define PIO_ENGINE_WS2812_WRAP            3
+#define PIO_ENGINE_WS2812_CYCLES_PER_BIT  10
+
+/*
+ * .side_set 1
+ * .wrap_target
+ *     out pins, 1     side 0 [1]    ; stalls with SCK low when the TX FIFO is empty
+ *     in pins, 1      side 1 [1]
+ * .wrap
+ */
+static const uint16_t pio_engine_spi_program[] = {0x6101, 0x5101};
+#define PIO_ENGINE_SPI_WRAP_TARGET        0
+#define PIO_ENGINE_SPI_WRAP               1
+#define PIO_ENGINE_SPI_CYCLES_PER_BIT     4
+
+/*
+ * .side_set 1
+ * .wrap_target
+ *     out pins, 8     side 0        ; stalls with the strobe low when the TX FIFO is empty
+ *     nop             side 1
+ * .wrap
+ */
+static const uint16_t pio_engine_parallel_8bit_program[] = {0x6008, 0xb042};
+#define PIO_ENGINE_PARALLEL_8BIT_WRAP_TARGET    0
+#define PIO_ENGINE_PARALLEL_8BIT_WRAP           1
+#define PIO_ENGINE_PARALLEL_8BIT_CYCLES_PER_BYTE 2
+
+/*
+ * Keeps the position in y, so no transition is lost when the CPU doesn't read the FIFO in time. The previous A/B state
+ * and the new one form a 4-bit index in the ISR, MOV PC jumps to the action for it. The count is pushed on every sample,
+ * a full FIFO drops the new count instead of stalling the sampling. A (bit 0) leading B decrements y.
+ * .origin 0                  ; the computed jump needs the program at offset 0
+ *     jmp update             ; 00 -> 00
+ *     jmp decrement          ; 00 -> 01
+ *     jmp increment          ; 00 -> 10
+ *     jmp update             ; 00 -> 11
+ *     jmp increment          ; 01 -> 00
+ *     jmp update             ; 01 -> 01
+ *     jmp update             ; 01 -> 10
+ *     jmp decrement          ; 01 -> 11
+ *     jmp decrement          ; 10 -> 00
+ *     jmp update             ; 10 -> 01
+ *     jmp update             ; 10 -> 10
+ *     jmp increment          ; 10 -> 11
+ *     jmp update             ; 11 -> 00
+ *     jmp increment          ; 11 -> 01
+ * decrement:
+ *     jmp y--, update        ; 11 -> 10, the target is the next instruction so this only decrements y
+ * .wrap_target
+ * update:
+ *     mov isr, y             ; 11 -> 11
+ *     push noblock
+ *     out isr, 2             ; the new state of the last sample becomes the previous state
+ *     in pins, 2
+ *     mov osr, isr
+ *     mov pc, isr
+ * increment:
+ *     mov y, ~y              ; there is no increment, so negate, decrement and negate
+ *     jmp y--, increment_cont
+ * increment_cont:
+ *     mov y, ~y
+ * .wrap
+ */
+static const uint16_t pio_engine_quadrature_program[] = {0x000f, 0x000e, 0x0015, 0x000f, 0x0015, 0x000f, 0x000f, 0x000e,
+                                                         0x000e, 0x000f, 0x000f, 0x0015, 0x000f, 0x0015, 0x008f, 0xa0c2,
+                                                         0x8000, 0x60c2, 0x4002, 0xa0e6, 0xa0a6, 0xa04a, 0x0097, 0xa04a};
+#define PIO_ENGINE_QUADRATURE_WRAP_TARGET 15
+#define PIO_ENGINE_QUADRATURE_WRAP        23
+#define PIO_ENGINE_QUADRATURE_CYCLES_PER_SAMPLE 7    /* while the state doesn't change, a count takes up to 10 */
+
+#endif /* HAL_PIO_PROGRAMS_H */
@@ -0,0 +1,125 @@
+/**
+* \file            spi_platform_specific.h
+* \brief           Include file with platform specific options for the SPI module
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef HAL_SPI_PLATFORM_SPECIFIC
+#define HAL_SPI_PLATFORM_SPECIFIC
+/* Extern c for compiling with c++*/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include "hardware/spi.h"
+#include "irq/bustransaction.h"
+
+typedef enum {
+    SPI_PERIPHERAL_0,
+    SPI_PERIPHERAL_1
+} spi_host_inst_t;
+
+typedef spi_host_inst_t spi_slave_inst_t;
+
+#define SPI_INST_NUM 2
+
+/**
+ * @brief The PL022 on the RP2040 is always clocked by clk_peri.
+ *        When the clock frequency passed to spi_host_init is 0 the frequency is read from the clock driver of the pico-sdk.
+ */
+typedef enum {
+    SPI_CLK_SOURCE_USE_DEFAULT = 0x00,
+    SPI_CLK_SOURCE_CLK_PERI = 0x01
+} spi_clock_sources_t;
+
+typedef enum {
+    SPI_BUS_OPT_USE_DEFAULT = 0,
+    SPI_BUS_OPT_CLOCK_POLARITY_SCK_HIGH = 0x01,
+    SPI_BUS_OPT_CLOCK_PHASE_TRAILING_EDGE = 0x02,
+    SPI_BUS_OPT_NO_DMA = 0x04
+} spi_bus_opt_t;
+
+typedef enum {
+    SPI_EXTRA_OPT_USE_DEFAULT = 0,
+    SPI_EXTRA_OPT_CLOCK_POLARITY_SCK_HIGH = 0x01,
+    SPI_EXTRA_OPT_CLOCK_PHASE_TRAILING_EDGE = 0x02
+} spi_extra_dev_opt_t;
+
+/**
+ * @brief Transfers of at least SPI_HOST_DMA_THRESHOLD bytes are moved by a pair of DMA channels,
+ *        shorter transfers are pushed through the 8-entry TX/RX FIFOs of the PL022 by the CPU.
+ */
+#ifndef SPI_HOST_DMA_THRESHOLD
+#define SPI_HOST_DMA_THRESHOLD 8
+#endif
+
+#define SPI_HOST_FIFO_DEPTH 8
+
+/**
+ * @brief Baud rate check of the SPI host, the macros can be used in static_asserts when their arguments are constants.
+ *        fsck = fref / (CPSDVSR * (1 + SCR)), CPSDVSR is even and in the range 2-254, SCR is in the range 0-255.
+ */
+#define SPI_HOST_BAUD_FITS(clk_freq, baud_freq) ((baud_freq) <= (clk_freq) / 2 && (baud_freq) >= (clk_freq) / (254ul * 256ul))
+
+#define SPI_HOST_INIT_PARAMETER_CHECK(spi_peripheral_num, peripheral_clock_source, peripheral_clock_freq, spi_bus_frequency, \
+                                      spi_extra_configuration_opt)                                                                                   \
+    do {                                                                                                                                             \
+        const uint32_t max_freq = 133000000;                                                                                                         \
+        const uint32_t max_supported_baud_rate = 62500000;                                                                                           \
+        static_assert((spi_peripheral_num <= SPI_INST_NUM - 1 && spi_peripheral_num >= 0), "SPI_HOST_INIT: Invalid peripheral!");                    \
+        static_assert(peripheral_clock_source <= SPI_CLK_SOURCE_CLK_PERI && peripheral_clock_source >= SPI_CLK_SOURCE_USE_DEFAULT,                   \
+                      "SPI_HOST_INIT: Invalid clock-source!");                                                                                       \
+        static_assert(peripheral_clock_freq <= max_freq, "SPI_HOST_INIT: Peripheral clock frequency too high!");                                     \
+        static_assert(spi_bus_frequency <= max_supported_baud_rate, "SPI_HOST_INIT: Unsupported bus frequency option set!");                         \
+        static_assert(peripheral_clock_freq == 0 || SPI_HOST_BAUD_FITS(peripheral_clock_freq, spi_bus_frequency),                                    \
+                      "SPI_HOST_INIT: The bus frequency can't be generated from this peripheral clock frequency!");                                  \
+        static_assert(spi_extra_configuration_opt <= (SPI_BUS_OPT_CLOCK_POLARITY_SCK_HIGH | SPI_BUS_OPT_CLOCK_PHASE_TRAILING_EDGE |                  \
+                                                      SPI_BUS_OPT_NO_DMA),                                                                           \
+                      "SPI_HOST_INIT: Unsupported extra configuration options set!");                                                                \
+    } while (0);
+
+#define SPI_HOST_DEINIT_PARAMETER_CHECK(spi_peripheral_num)                                                                                          \
+    do {                                                                                                                                             \
+    } while (0);
+
+#define SPI_HOST_START_TRANSACTION_PARAMETER_CHECK(spi_peripheral_num, chip_select_pin, device_specific_config_opt)                                  \
+    do {                                                                                                                                             \
+    } while (0);
+
+#define SPI_HOST_END_TRANSACTION_PARAMETER_CHECK(spi_peripheral_num, chip_select_pin)                                                                \
+    do {                                                                                                                                             \
+    } while (0);
+
+#define SPI_HOST_WRITE_PARAMETER_CHECK(spi_peripheral_num, write_buffer, buffer_size)                                                                \
+    do {                                                                                                                                             \
+    } while (0);
+
+#define SPI_HOST_READ_PARAMETER_CHECK(spi_peripheral_num, read_buffer, size)                                                                         \
+    do {                                                                                                                                             \
+    } while (0);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,272 @@
+/**
+* \file            spi_host.c
+* \brief           Source file which implements the standard SPI API functions
+*/
+/*
+*  Copyright 2023 (C) Victor Hogeweij <hogeweyv@gmail.com>
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*  http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+* This file is part of the Universal Hal Framework.
+*
+* Author:          Victor Hogeweij <hogeweyv@gmail.com>
+*/
+
+#ifndef DISABLE_SPI_HOST_MODULE
+
+#include <stdbool.h>
+#include "hal_gpio.h"
+#include "hal_os.h"
+#include "hal_spi_host.h"
+#include "spi_common/spi_platform_specific.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/spi.h"
+
+#define SPI_HOST_NO_DMA_CHANNEL (-1)
+
+static spi_inst_t *const spi_peripheral_mapping_table[SPI_INST_NUM] = {spi0, spi1};
+
+/**
+ * @brief The DMA channels claimed by spi_host_init, SPI_HOST_NO_DMA_CHANNEL when the FIFOs are always used.
+ *        A transfer started with the non-blocking functions keeps running on these channels until the next call on the same peripheral.
+ */
+static int spi_host_dma_tx_channel[SPI_INST_NUM] = {SPI_HOST_NO_DMA_CHANNEL, SPI_HOST_NO_DMA_CHANNEL};
+static int spi_host_dma_rx_channel[SPI_INST_NUM] = {SPI_HOST_NO_DMA_CHANNEL, SPI_HOST_NO_DMA_CHANNEL};
+
+/**
+ * @brief The bus format given to spi_host_init, used when a device doesn't specify its own CPOL/CPHA.
+ */
+static spi_bus_opt_t spi_host_bus_opt[SPI_INST_NUM];
+
+/**
+ * @brief Source of the dummy bytes shifted out on a read and sink of the bytes received on a write.
+ */
+static const uint8_t spi_host_dummy_tx = 0x00;
+static uint8_t spi_host_dummy_rx;
+
+static inline spi_inst_t *get_spi_inst(const spi_host_inst_t peripheral_inst_num) {
+    return spi_peripheral_mapping_table[peripheral_inst_num];
+}
+
+static inline spi_cpol_t get_clock_polarity(const uint32_t opt) {
+    return (opt & SPI_BUS_OPT_CLOCK_POLARITY_SCK_HIGH) ? SPI_CPOL_1 : SPI_CPOL_0;
+}
+
+static inline spi_cpha_t get_clock_phase(const uint32_t opt) {
+    return (opt & SPI_BUS_OPT_CLOCK_PHASE_TRAILING_EDGE) ? SPI_CPHA_1 : SPI_CPHA_0;
+}
+
+/**
+ * @brief Helper function which waits till a DMA transfer started by the non-blocking functions is finished.
+ *        The RX channel finishes last, as it takes the byte received after the last byte is shifted out.
+ */
+static inline void spi_host_wait_for_dma(const spi_host_inst_t spi_peripheral_num) {
+    if (spi_host_dma_rx_channel[spi_peripheral_num] != SPI_HOST_NO_DMA_CHANNEL) {
+        dma_channel_wait_for_finish_blocking(spi_host_dma_rx_channel[spi_peripheral_num]);
+    }
+}
+
+/**
+ * @brief Helper function which transfers a buffer through the 8-entry TX/RX FIFOs.
+ *        New bytes are pushed while the TX FIFO has room and less than a FIFO worth of bytes is in flight,
+ *        so the RX FIFO can never overflow while the received bytes are drained.
+ * @param write_buff The bytes to write, NULL to write zeros
+ * @param read_buff The buffer for the received bytes, NULL to discard them
+ */
+static void spi_host_transfer_fifo(spi_inst_t *spi, const unsigned char *write_buff, unsigned char *read_buff, const size_t size) {
+    spi_hw_t *hw = spi_get_hw(spi);
+    size_t tx_remaining = size;
+    size_t rx_remaining = size;
+    while (tx_remaining || rx_remaining) {
+        if (tx_remaining && spi_is_writable(spi) && rx_remaining - tx_remaining < SPI_HOST_FIFO_DEPTH) {
+            hw->dr = (write_buff != NULL) ? write_buff[size - tx_remaining] : 0x00;
+            tx_remaining--;
+        }
+        if (rx_remaining && spi_is_readable(spi)) {
+            const uint8_t data = (uint8_t) hw->dr;
+            if (read_buff != NULL) {
+                read_buff[size - rx_remaining] = data;
+            }
+            rx_remaining--;
+        }
+    }
+}
+
+/**
+ * @brief Helper function which starts a transfer on the paired DMA channels of the peripheral.
+ *        The TX channel is paced by the TX DREQ and the RX channel by the RX DREQ, both are started at the same moment.
+ *        When no buffer is given the channel reads the dummy byte or writes into the dummy sink without incrementing.
+ */
+static void spi_host_transfer_dma(const spi_host_inst_t spi_peripheral_num, const unsigned char *write_buff,
+                                  unsigned char *read_buff, const size_t size) {
+    spi_inst_t *spi = get_spi_inst(spi_peripheral_num);
+    const uint tx_channel = spi_host_dma_tx_channel[spi_peripheral_num];
+    const uint rx_channel = spi_host_dma_rx_channel[spi_peripheral_num];
+
+    dma_channel_config tx_config = dma_channel_get_default_config(tx_channel);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
+    channel_config_set_dreq(&tx_config, spi_get_dreq(spi, true));
+    channel_config_set_read_increment(&tx_config, write_buff != NULL);
+    channel_config_set_write_increment(&tx_config, false);
+    dma_channel_configure(tx_channel, &tx_config, &spi_get_hw(spi)->dr,
+                          (write_buff != NULL) ? write_buff : &spi_host_dummy_tx, size, false);
+
+    dma_channel_config rx_config = dma_channel_get_default_config(rx_channel);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_dreq(&rx_config, spi_get_dreq(spi, false));
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, read_buff != NULL);
+    dma_channel_configure(rx_channel, &rx_config, (read_buff != NULL) ? read_buff : &spi_host_dummy_rx,
+                          &spi_get_hw(spi)->dr, size, false);
+
+    dma_start_channel_mask((1u << tx_channel) | (1u << rx_channel));
+}
+
+/**
+ * @brief Helper function which picks the FIFO or DMA path for a transfer.
+ *        A previous DMA transfer is always finished first, so transfers on a peripheral never overlap.
+ * @return true when the transfer is still running on the DMA channels
+ */
+static bool spi_host_transfer(const spi_host_inst_t spi_peripheral_num, const unsigned char *write_buff,
+                              unsigned char *read_buff, const size_t size) {
+    spi_host_wait_for_dma(spi_peripheral_num);
+    if (spi_host_dma_rx_channel[spi_peripheral_num] != SPI_HOST_NO_DMA_CHANNEL && size >= SPI_HOST_DMA_THRESHOLD) {
+        spi_host_transfer_dma(spi_peripheral_num, write_buff, read_buff, size);
+        return true;
+    }
+    spi_host_transfer_fifo(get_spi_inst(spi_peripheral_num), write_buff, read_buff, size);
+    return false;
+}
+
+uhal_status_t spi_host_init(const spi_host_inst_t spi_peripheral_num, const uint32_t spi_clock_source,
+                            const uint32_t spi_clock_source_freq,
+                            const unsigned long spi_bus_frequency, const spi_bus_opt_t spi_extra_configuration_opt) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    spi_inst_t *spi = get_spi_inst(spi_peripheral_num);
+    /* The PL022 is always clocked by clk_peri, a given frequency is only used for the parameter check */
+    (void) spi_clock_source;
+    (void) spi_clock_source_freq;
+    spi_init(spi, spi_bus_frequency);
+    spi_set_format(spi, 8, get_clock_polarity(spi_extra_configuration_opt), get_clock_phase(spi_extra_configuration_opt),
+                   SPI_MSB_FIRST);
+    spi_host_bus_opt[spi_peripheral_num] = spi_extra_configuration_opt;
+
+    if (!(spi_extra_configuration_opt & SPI_BUS_OPT_NO_DMA) && spi_host_dma_rx_channel[spi_peripheral_num] == SPI_HOST_NO_DMA_CHANNEL) {
+        const int tx_channel = dma_claim_unused_channel(false);
+        const int rx_channel = dma_claim_unused_channel(false);
+        if (tx_channel >= 0 && rx_channel >= 0) {
+            spi_host_dma_tx_channel[spi_peripheral_num] = tx_channel;
+            spi_host_dma_rx_channel[spi_peripheral_num] = rx_channel;
+        } else {
+            /* Not enough free channels, all transfers go through the FIFOs */
+            if (tx_channel >= 0) {
+                dma_channel_unclaim(tx_channel);
+            }
+            if (rx_channel >= 0) {
+                dma_channel_unclaim(rx_channel);
+            }
+        }
+    }
+    UHAL_OS_BUS_INIT(UHAL_OS_BUS_RP2040_SPI(spi_peripheral_num));
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t spi_host_deinit(const spi_host_inst_t spi_peripheral_num) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    spi_host_wait_for_dma(spi_peripheral_num);
+    if (spi_host_dma_rx_channel[spi_peripheral_num] != SPI_HOST_NO_DMA_CHANNEL) {
+        dma_channel_unclaim(spi_host_dma_tx_channel[spi_peripheral_num]);
+        dma_channel_unclaim(spi_host_dma_rx_channel[spi_peripheral_num]);
+        spi_host_dma_tx_channel[spi_peripheral_num] = SPI_HOST_NO_DMA_CHANNEL;
+        spi_host_dma_rx_channel[spi_peripheral_num] = SPI_HOST_NO_DMA_CHANNEL;
+    }
+    spi_deinit(get_spi_inst(spi_peripheral_num));
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t spi_host_start_transaction(const spi_host_inst_t spi_peripheral_num, const gpio_pin_t chip_select_pin,
+                                         const spi_extra_dev_opt_t device_specific_config_opt) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    /* The bus is owned by the calling task until spi_host_end_transaction */
+    UHAL_OS_BUS_LOCK(UHAL_OS_BUS_RP2040_SPI(spi_peripheral_num));
+    spi_inst_t *spi = get_spi_inst(spi_peripheral_num);
+    spi_host_wait_for_dma(spi_peripheral_num);
+    const uint32_t format_opt = (device_specific_config_opt != SPI_EXTRA_OPT_USE_DEFAULT) ? device_specific_config_opt
+                                                                                          : spi_host_bus_opt[spi_peripheral_num];
+    spi_set_format(spi, 8, get_clock_polarity(format_opt), get_clock_phase(format_opt), SPI_MSB_FIRST);
+    gpio_set_pin_lvl(chip_select_pin, GPIO_LOW);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t spi_host_end_transaction(const spi_host_inst_t spi_peripheral_num, const gpio_pin_t chip_select_pin) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    spi_inst_t *spi = get_spi_inst(spi_peripheral_num);
+    spi_host_wait_for_dma(spi_peripheral_num);
+    /* The last byte can still be in the shift register after the FIFOs are empty */
+    while (spi_is_busy(spi)) { ;
+    }
+    gpio_set_pin_lvl(chip_select_pin, GPIO_HIGH);
+    UHAL_OS_BUS_UNLOCK(UHAL_OS_BUS_RP2040_SPI(spi_peripheral_num));
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t
+spi_host_write_blocking(const spi_host_inst_t spi_peripheral_num, const unsigned char *write_buff, const size_t size) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (spi_host_transfer(spi_peripheral_num, write_buff, NULL, size)) {
+        spi_host_wait_for_dma(spi_peripheral_num);
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t spi_host_write_non_blocking(const spi_host_inst_t spi_peripheral_num, const unsigned char *write_buff,
+                                          const size_t size) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    spi_host_transfer(spi_peripheral_num, write_buff, NULL, size);
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t
+spi_host_read_blocking(const spi_host_inst_t spi_peripheral_num, unsigned char *read_buff, size_t amount_of_bytes) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    if (spi_host_transfer(spi_peripheral_num, NULL, read_buff, amount_of_bytes)) {
+        spi_host_wait_for_dma(spi_peripheral_num);
+    }
+    return UHAL_STATUS_OK;
+}
+
+uhal_status_t
+spi_host_read_non_blocking(const spi_host_inst_t spi_peripheral_num, unsigned char *read_buff, size_t amount_of_bytes) {
+    if (spi_peripheral_num >= SPI_INST_NUM) {
+        return UHAL_STATUS_INVALID_PARAMETERS;
+    }
+    spi_host_transfer(spi_peripheral_num, NULL, read_buff, amount_of_bytes);
+    return UHAL_STATUS_OK;
+}
+
+#endif /* DISABLE_SPI_HOST_MODULE */